@@ -1,25 +1,34 @@
 #include <zephyr/kernel.h>
+#include <zephyr/init.h>
 #include <zephyr/drivers/adc.h>
 #include <zephyr/logging/log.h>
-#include <zephyr/drivers/adc.h>
 #include <zephyr/bluetooth/services/bas.h>
+#include <stdlib.h>
 #include "battery_level.h"
 
 LOG_MODULE_REGISTER(battery_level, CONFIG_BATTERY_LEVEL_LOG_LEVEL);
 
 static const struct adc_dt_spec adc_channel = ADC_DT_SPEC_GET(DT_PATH(zephyr_user));
 
+#define BATTERY_PERIOD K_SECONDS(CONFIG_BATTERY_LEVEL_INTERVAL_S)
 
 int16_t buf;
 struct adc_sequence sequence = {
     .buffer = &buf,
     /* buffer size in bytes, not number of samples */
     .buffer_size = sizeof(buf),
-    //Optional
-    //.calibrate = true,
+    /* 2^N samples averaged in hardware. With a single channel the SAADC
+     * driver also enables burst mode, so one read is one conversion burst. */
+    .oversampling = CONFIG_BATTERY_LEVEL_OVERSAMPLING,
+    /* Offset calibration on the first read only */
+    .calibrate = true,
 };
 
-uint32_t count = 0;
+static int last_percentage = -1;
+static int64_t last_sample_ms;
+
+static void battery_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(battery_work, battery_work_handler);
 
 int battery_level_init(void)
 {
@@ -42,6 +51,9 @@ int battery_level_init(void)
         LOG_ERR("Could not initalize sequnce");
         return -1;
     }
+    /* adc_sequence_init_dt() resets the sequence options */
+    sequence.oversampling = CONFIG_BATTERY_LEVEL_OVERSAMPLING;
+    sequence.calibrate = true;
 
     return 0;
 }
@@ -70,6 +82,7 @@ int battery_level_get(void)
         LOG_ERR("Could not read ADC (%d)", err);
         return err;
     }
+    sequence.calibrate = false;
 
     /* Get raw ADC reading */
     val_mv = (int)buf;
@@ -91,21 +104,51 @@ int battery_level_get(void)
     return battery_percentage;
 }
 
-static int battery_level_thread(struct k_work *work)
+static void battery_work_handler(struct k_work *work)
+{
+    int ret = battery_level_get();
+
+    last_sample_ms = k_uptime_get();
+
+    if (ret < 0) {
+        LOG_ERR("Battery level error: %d", ret);
+    } else if (last_percentage < 0 ||
+               abs(ret - last_percentage) >= CONFIG_BATTERY_LEVEL_HYSTERESIS) {
+        // BAS notifies subscribers on every set, so only report real changes
+        last_percentage = ret;
+        bt_bas_set_battery_level((uint8_t)ret);
+        LOG_INF("Battery level %d%%", ret);
+    }
+
+#ifdef CONFIG_BATTERY_LEVEL_RADIO_ALIGN
+    // Fallback for when no radio event comes in
+    k_work_schedule(&battery_work, K_SECONDS(CONFIG_BATTERY_LEVEL_INTERVAL_S * 2));
+#else
+    k_work_schedule(&battery_work, BATTERY_PERIOD);
+#endif // CONFIG_BATTERY_LEVEL_RADIO_ALIGN
+}
+
+void battery_level_radio_event(void)
+{
+#ifdef CONFIG_BATTERY_LEVEL_RADIO_ALIGN
+    if (k_uptime_get() - last_sample_ms < CONFIG_BATTERY_LEVEL_INTERVAL_S * MSEC_PER_SEC) {
+        return;
+    }
+
+    // Sample once the new payload has been on air, with the cell still loaded
+    k_work_reschedule(&battery_work, K_MSEC(CONFIG_BATTERY_LEVEL_RADIO_DELAY_MS));
+#endif // CONFIG_BATTERY_LEVEL_RADIO_ALIGN
+}
+
+static int battery_level_start(void)
 {
     if (battery_level_init() != 0) {
         LOG_ERR("Failed to Init Battery Level");
         return -1;
     }
-    while(1) {
-     
-        int ret = battery_level_get();
-        if (ret >= 0) {
-            bt_bas_set_battery_level((uint8_t)ret);
-        } else {
-            LOG_ERR("Battery level error: %d", ret);
-        }
-        k_sleep(K_SECONDS(60));
-    }     
+
+    k_work_schedule(&battery_work, K_NO_WAIT);
+    return 0;
 }
-K_THREAD_DEFINE(battery_level_thread_id, 1024, battery_level_thread, NULL, NULL, NULL, K_LOWEST_THREAD_PRIO, 0, 0);
\ No newline at end of file
+
+SYS_INIT(battery_level_start, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
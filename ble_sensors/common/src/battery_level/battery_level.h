@@ -2,15 +2,22 @@
 #define BATTERY_LEVEL_H
 
 /**
- * @brief Get the battery voltage in millivolts.
+ * @brief Get the battery level in percent.
  *
- * This function reads the internal voltage using the ADC and converts it
- * to battery voltage using the nRF52 series formula:
- * battery_voltage (mV) = ((600 * 6) * sample) / (1 << 12)
+ * This function reads the VDD voltage using the ADC with hardware
+ * oversampling and converts it to a percentage of BATTERY_FULL_MV.
  *
- * @return int Battery voltage in mV on success, or a negative error code on failure.
+ * @return int Battery level (0-100) on success, or a negative error code on failure.
  */
 int battery_level_get(void);
 int battery_level_init(void);
 
+/**
+ * @brief Tell the monitor the radio just transmitted.
+ *
+ * With CONFIG_BATTERY_LEVEL_RADIO_ALIGN the periodic measurement is taken
+ * shortly after this call, so every reading sees the same load.
+ */
+void battery_level_radio_event(void);
+
 #endif /* BATTERY_LEVEL_H */
@@ -0,0 +1,424 @@
+#include "sensor_auth.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/bluetooth/crypto.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include <stdlib.h>
+#if defined(CONFIG_SENSOR_AUTH_SEAL) || defined(CONFIG_SENSOR_AUTH_VERIFY)
+#include <zephyr/settings/settings.h>
+#endif // CONFIG_SENSOR_AUTH_SEAL || CONFIG_SENSOR_AUTH_VERIFY
+
+LOG_MODULE_REGISTER(sensor_auth, CONFIG_SENSOR_AUTH_LOG_LEVEL);
+
+#define NONCE_LEN 13
+#define BODY_MAX_LEN SENSOR_ADV_EXT_MAX_LEN
+
+// Crypto timing, one set for sealing and one for opening
+struct auth_stats {
+    const char *name;
+    uint32_t count;
+    uint32_t cyc_sum;
+    uint32_t cyc_max;
+};
+
+static void stats_add(struct auth_stats *stats, uint32_t cyc) {
+    if (CONFIG_SENSOR_AUTH_STATS_INTERVAL == 0) {
+        return;
+    }
+
+    stats->count++;
+    stats->cyc_sum += cyc;
+    stats->cyc_max = MAX(stats->cyc_max, cyc);
+
+    if (stats->count >= CONFIG_SENSOR_AUTH_STATS_INTERVAL) {
+        LOG_INF("%s: avg %u us max %u us over %u frames", stats->name,
+                k_cyc_to_us_floor32(stats->cyc_sum / stats->count),
+                k_cyc_to_us_floor32(stats->cyc_max), stats->count);
+        stats->count = 0;
+        stats->cyc_sum = stats->cyc_max = 0;
+    }
+}
+
+static int parse_key(const char *hex, uint8_t key[SENSOR_AUTH_KEY_LEN]) {
+    if (hex2bin(hex, strlen(hex), key, SENSOR_AUTH_KEY_LEN) != SENSOR_AUTH_KEY_LEN) {
+        LOG_ERR("Key must be %d hex digits", SENSOR_AUTH_KEY_LEN * 2);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// Unique per node key as long as (epoch, counter) never repeats
+static void build_nonce(uint8_t nonce[NONCE_LEN], const uint8_t *header) {
+    memset(nonce, 0, NONCE_LEN);
+    nonce[0] = header[3];                   // Key ID
+    memcpy(&nonce[1], &header[4], 6);       // Epoch + counter
+    memcpy(&nonce[7], &header[0], 2);       // Company ID
+}
+
+#ifdef CONFIG_SENSOR_AUTH_SEAL
+
+static uint8_t node_key[SENSOR_AUTH_KEY_LEN];
+static uint16_t epoch;
+static uint32_t last_counter;
+static bool seal_ready;
+static struct auth_stats seal_stats = { .name = "seal" };
+
+static int auth_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+
+    if (!settings_name_steq(name, "epoch", &next) || next) {
+        return -ENOENT;
+    }
+    if (len != sizeof(epoch)) {
+        return -EINVAL;
+    }
+
+    return MIN(read_cb(cb_arg, &epoch, sizeof(epoch)), 0);
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(sensor_auth, "sensor_auth", NULL, auth_settings_set, NULL, NULL);
+
+// A new epoch per boot keeps the nonce unique although the counter restarts
+static int seal_init(void) {
+    int err = parse_key(CONFIG_SENSOR_AUTH_NODE_KEY, node_key);
+    if (err) {
+        return err;
+    }
+
+    err = settings_subsys_init();
+    if (err) {
+        LOG_ERR("Settings init failed (err %d)", err);
+        return err;
+    }
+    settings_load_subtree("sensor_auth");
+
+    epoch++;
+    err = settings_save_one("sensor_auth/epoch", &epoch, sizeof(epoch));
+    if (err) {
+        // Sealing with a reused epoch would repeat nonces
+        LOG_ERR("Failed to store epoch (err %d), sealing disabled", err);
+        return err;
+    }
+
+    seal_ready = true;
+    LOG_INF("Sealing as key %d, epoch %u", CONFIG_SENSOR_AUTH_KEY_ID, epoch);
+    return 0;
+}
+
+int sensor_auth_seal(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size) {
+    uint8_t body[BODY_MAX_LEN];
+    uint8_t nonce[NONCE_LEN];
+    size_t body_len;
+    uint32_t counter;
+    uint32_t start;
+    int err;
+
+    if (!seal_ready) {
+        return -EACCES;
+    }
+    if (len < SENSOR_DATA_HEADER_LEN) {
+        return -EINVAL;
+    }
+
+    body_len = len - SENSOR_DATA_HEADER_LEN + 2;
+    if (SENSOR_AUTH_HEADER_LEN + body_len + SENSOR_AUTH_MIC_LEN > out_size) {
+        return -ENOSPC;
+    }
+
+    // The timestamp, but strictly increasing so no two frames share a nonce
+    counter = MAX(sys_get_le32(&frame[4]), last_counter + 1);
+    last_counter = counter;
+
+    out[0] = frame[0];
+    out[1] = frame[1];
+    out[2] = SENSOR_TYPE_SECURE;
+    out[3] = CONFIG_SENSOR_AUTH_KEY_ID;
+    sys_put_le16(epoch, &out[4]);
+    sys_put_le32(counter, &out[6]);
+
+    body[0] = frame[2];     // Plain type
+    body[1] = frame[3];     // Padding or composite record count
+    memcpy(&body[2], &frame[SENSOR_DATA_HEADER_LEN], len - SENSOR_DATA_HEADER_LEN);
+
+    build_nonce(nonce, out);
+
+    start = k_cycle_get_32();
+    err = bt_ccm_encrypt(node_key, nonce, body, body_len, out, SENSOR_AUTH_HEADER_LEN,
+                         &out[SENSOR_AUTH_HEADER_LEN], SENSOR_AUTH_MIC_LEN);
+    stats_add(&seal_stats, k_cycle_get_32() - start);
+    if (err) {
+        LOG_ERR("Encryption failed (err %d)", err);
+        return err;
+    }
+
+    return SENSOR_AUTH_HEADER_LEN + body_len + SENSOR_AUTH_MIC_LEN;
+}
+
+#else
+
+int sensor_auth_seal(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size) {
+    return -ENOTSUP;
+}
+
+#endif // CONFIG_SENSOR_AUTH_SEAL
+
+#ifdef CONFIG_SENSOR_AUTH_VERIFY
+
+// Last accepted (epoch, counter) and derived key per node. The epoch is kept
+// in settings, so frames of an older epoch stay rejected after a reboot.
+struct replay_entry {
+    bool used;
+    bool key_ready;
+    uint8_t key_id;
+    uint16_t epoch;
+    uint32_t counter;
+    uint8_t key[SENSOR_AUTH_KEY_LEN];
+};
+
+static uint8_t master_key[SENSOR_AUTH_KEY_LEN];
+static bool verify_ready;
+// Never evicted, a node that took over an entry would reset its epoch
+static struct replay_entry replay[CONFIG_SENSOR_AUTH_MAX_NODES];
+static ATOMIC_DEFINE(epoch_dirty, CONFIG_SENSOR_AUTH_MAX_NODES);
+static bool table_full_logged;
+static struct auth_stats open_stats = { .name = "open" };
+
+static void epoch_save_work_fn(struct k_work *work);
+static K_WORK_DEFINE(epoch_save_work, epoch_save_work_fn);
+
+static struct replay_entry *replay_find(uint8_t key_id) {
+    for (size_t i = 0; i < ARRAY_SIZE(replay); i++) {
+        if (replay[i].used && replay[i].key_id == key_id) {
+            return &replay[i];
+        }
+    }
+    return NULL;
+}
+
+// Free entry for a new node, NULL once CONFIG_SENSOR_AUTH_MAX_NODES are tracked
+static struct replay_entry *replay_free(uint8_t key_id) {
+    for (size_t i = 0; i < ARRAY_SIZE(replay); i++) {
+        if (!replay[i].used) {
+            return &replay[i];
+        }
+    }
+
+    if (!table_full_logged) {
+        LOG_WRN("Replay table full (%d nodes), key %u and later new nodes dropped",
+                CONFIG_SENSOR_AUTH_MAX_NODES, key_id);
+        table_full_logged = true;
+    }
+    return NULL;
+}
+
+static void replay_init(struct replay_entry *entry, uint8_t key_id) {
+    memset(entry, 0, sizeof(*entry));
+    entry->used = true;
+    entry->key_id = key_id;
+}
+
+// Highest epoch accepted per key ID, "sensor_auth_rx/<key ID>"
+static int replay_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    struct replay_entry *entry;
+    unsigned long key_id;
+    uint16_t stored;
+    char *end;
+    int rc;
+
+    key_id = strtoul(name, &end, 10);
+    if (end == name || *end != '\0' || key_id > UINT8_MAX || len != sizeof(stored)) {
+        return -EINVAL;
+    }
+
+    rc = read_cb(cb_arg, &stored, sizeof(stored));
+    if (rc < 0) {
+        return rc;
+    }
+
+    entry = replay_find(key_id);
+    if (!entry) {
+        entry = replay_free(key_id);
+        if (!entry) {
+            return 0;
+        }
+        replay_init(entry, key_id);
+    }
+    entry->epoch = MAX(entry->epoch, stored);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(sensor_auth_rx, "sensor_auth_rx", NULL, replay_settings_set,
+                               NULL, NULL);
+
+// Flash writes stay out of the scan callback
+static void epoch_save_work_fn(struct k_work *work) {
+    char name[sizeof("sensor_auth_rx/255")];
+
+    for (size_t i = 0; i < ARRAY_SIZE(replay); i++) {
+        if (!atomic_test_and_clear_bit(epoch_dirty, i)) {
+            continue;
+        }
+
+        uint16_t epoch = replay[i].epoch;
+
+        snprintk(name, sizeof(name), "sensor_auth_rx/%u", replay[i].key_id);
+        int err = settings_save_one(name, &epoch, sizeof(epoch));
+        if (err) {
+            LOG_ERR("Failed to store epoch of key %u (err %d)", replay[i].key_id, err);
+        }
+    }
+}
+
+// Node key = AES(master key, key ID), the same as scripts/sensor_auth_key.py
+static int derive_key(uint8_t key_id, uint8_t key[SENSOR_AUTH_KEY_LEN]) {
+    uint8_t block[16] = { key_id };
+
+    return bt_encrypt_be(master_key, block, key);
+}
+
+int sensor_auth_open(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size) {
+    uint8_t body[BODY_MAX_LEN];
+    uint8_t nonce[NONCE_LEN];
+    uint8_t new_key[SENSOR_AUTH_KEY_LEN];
+    const uint8_t *key;
+    struct replay_entry *entry;
+    size_t body_len;
+    uint16_t frame_epoch;
+    uint32_t counter;
+    uint32_t start;
+    int err;
+
+    if (!verify_ready) {
+        return -EACCES;
+    }
+    if (len < SENSOR_AUTH_HEADER_LEN + 2 + SENSOR_AUTH_MIC_LEN || frame[2] != SENSOR_TYPE_SECURE) {
+        return -EINVAL;
+    }
+
+    body_len = len - SENSOR_AUTH_HEADER_LEN - SENSOR_AUTH_MIC_LEN;
+    if (body_len > sizeof(body) || body_len - 2 + SENSOR_DATA_HEADER_LEN > out_size) {
+        return -ENOSPC;
+    }
+
+    frame_epoch = sys_get_le16(&frame[4]);
+    counter = sys_get_le32(&frame[6]);
+
+    // Advertisements repeat, so check the counter before paying for AES
+    entry = replay_find(frame[3]);
+    if (entry && !entry->key_ready) {
+        // Epoch loaded from settings, no frame seen since boot
+        err = derive_key(entry->key_id, entry->key);
+        if (err) {
+            return err;
+        }
+        entry->key_ready = true;
+    }
+    if (entry) {
+        if (frame_epoch == entry->epoch && counter == entry->counter) {
+            return -EALREADY;
+        }
+        if (frame_epoch < entry->epoch ||
+            (frame_epoch == entry->epoch && counter < entry->counter)) {
+            LOG_WRN("Replayed frame from key %u (epoch %u counter %u)",
+                    frame[3], frame_epoch, counter);
+            return -EPERM;
+        }
+        key = entry->key;
+    } else {
+        // No room to track its counter, so it cannot be accepted
+        if (!replay_free(frame[3])) {
+            return -ENOMEM;
+        }
+        err = derive_key(frame[3], new_key);
+        if (err) {
+            return err;
+        }
+        key = new_key;
+    }
+
+    build_nonce(nonce, frame);
+
+    start = k_cycle_get_32();
+    err = bt_ccm_decrypt(key, nonce, &frame[SENSOR_AUTH_HEADER_LEN], body_len,
+                         frame, SENSOR_AUTH_HEADER_LEN, body, SENSOR_AUTH_MIC_LEN);
+    stats_add(&open_stats, k_cycle_get_32() - start);
+    if (err) {
+        LOG_WRN("MIC check failed for key %u", frame[3]);
+        return -EBADMSG;
+    }
+
+    // Only authentic frames move the replay window
+    bool new_epoch = !entry || frame_epoch > entry->epoch;
+
+    if (!entry) {
+        entry = replay_free(frame[3]);
+        if (!entry) {
+            return -ENOMEM;
+        }
+        replay_init(entry, frame[3]);
+        memcpy(entry->key, new_key, sizeof(entry->key));
+        entry->key_ready = true;
+    }
+    entry->epoch = frame_epoch;
+    entry->counter = counter;
+
+    // Once per node boot, older epochs stay rejected after our own reboot
+    if (new_epoch) {
+        atomic_set_bit(epoch_dirty, entry - replay);
+        k_work_submit(&epoch_save_work);
+    }
+
+    // Rebuild the plain frame, the counter stands in for the timestamp
+    out[0] = frame[0];
+    out[1] = frame[1];
+    out[2] = body[0];
+    out[3] = body[1];
+    sys_put_le32(counter, &out[4]);
+    memcpy(&out[SENSOR_DATA_HEADER_LEN], &body[2], body_len - 2);
+
+    return SENSOR_DATA_HEADER_LEN + body_len - 2;
+}
+
+#else
+
+int sensor_auth_open(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size) {
+    return -ENOTSUP;
+}
+
+#endif // CONFIG_SENSOR_AUTH_VERIFY
+
+int sensor_auth_init(void) {
+    int err = 0;
+
+#ifdef CONFIG_SENSOR_AUTH_SEAL
+    err = seal_init();
+    if (err) {
+        return err;
+    }
+#endif // CONFIG_SENSOR_AUTH_SEAL
+
+#ifdef CONFIG_SENSOR_AUTH_VERIFY
+    err = parse_key(CONFIG_SENSOR_AUTH_MASTER_KEY, master_key);
+    if (err) {
+        return err;
+    }
+
+    err = settings_subsys_init();
+    if (err) {
+        // Without the stored epochs any earlier recorded frame would pass
+        LOG_ERR("Settings init failed (err %d), verification disabled", err);
+        return err;
+    }
+    settings_load_subtree("sensor_auth_rx");
+
+    verify_ready = true;
+    LOG_INF("Verifying sealed payloads%s",
+            IS_ENABLED(CONFIG_SENSOR_AUTH_REQUIRED) ? ", unsealed ones dropped" : "");
+#endif // CONFIG_SENSOR_AUTH_VERIFY
+
+    return err;
+}
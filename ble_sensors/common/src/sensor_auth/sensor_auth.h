@@ -0,0 +1,51 @@
+#ifndef SENSOR_AUTH_H
+#define SENSOR_AUTH_H
+
+#include <zephyr/kernel.h>
+#include "sensor_common.h"
+
+/*
+ * SENSOR_TYPE_SECURE frame:
+ *   company_id (2) | type (1) | key_id (1) | epoch (2) | counter (4)
+ *   | encrypted [type][padding][values] of the plain frame | MIC (4)
+ *
+ * The header is authenticated but readable. The counter replaces the plain
+ * timestamp and is the replay counter, the epoch is bumped on every boot.
+ */
+#define SENSOR_AUTH_HEADER_LEN  10
+#define SENSOR_AUTH_MIC_LEN     4
+#define SENSOR_AUTH_KEY_LEN     16
+
+// Bytes a sealed frame adds to the plain one
+#define SENSOR_AUTH_OVERHEAD    (SENSOR_AUTH_HEADER_LEN - SENSOR_DATA_HEADER_LEN + \
+                                 2 + SENSOR_AUTH_MIC_LEN)
+
+/**
+ * @brief Load the keys and, when sealing, start a new epoch.
+ */
+int sensor_auth_init(void);
+
+/**
+ * @brief Seal a plain frame (plain or composite) into a SENSOR_TYPE_SECURE frame.
+ *
+ * @return Length of the sealed frame, or a negative error code.
+ */
+int sensor_auth_seal(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size);
+
+/**
+ * @brief Verify and decrypt a SENSOR_TYPE_SECURE frame back into the plain frame.
+ *
+ * @p out may be @p frame, the plain frame is 8 bytes shorter.
+ *
+ * Nodes are tracked by key ID, the highest epoch of each is kept in settings
+ * so an older epoch stays rejected across reboots.
+ *
+ * @return Length of the plain frame, -EALREADY for a repeat of the last
+ *         frame from that node, -EBADMSG when the MIC does not match,
+ *         -EPERM for a replayed counter, -ENOMEM for a new node once
+ *         CONFIG_SENSOR_AUTH_MAX_NODES are tracked, or another negative
+ *         error code.
+ */
+int sensor_auth_open(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size);
+
+#endif // SENSOR_AUTH_H
@@ -5,28 +5,61 @@
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/hci.h>
+#include <string.h>
+#ifdef CONFIG_BT_CTLR_TX_PWR_DYNAMIC_CONTROL
+#include <zephyr/bluetooth/hci_vs.h>
+#include <zephyr/sys/byteorder.h>
+#endif // CONFIG_BT_CTLR_TX_PWR_DYNAMIC_CONTROL
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+#include "sensor_ble_service.h"
+#endif // CONFIG_SENSOR_BLE_SERVICE
+#ifdef CONFIG_SENSOR_AUTH
+#include "sensor_auth.h"
+#endif // CONFIG_SENSOR_AUTH
+#ifdef CONFIG_BATTERY_LEVEL
+#include "battery_level.h"
+#endif // CONFIG_BATTERY_LEVEL
 
 LOG_MODULE_REGISTER(sensor_ble, LOG_LEVEL_INF);
 
-uint8_t mfg_data[sizeof(sensor_data_t)];
+// Double-buffered manufacturer data. Writers fill the spare buffer and swap
+// it in, so the advertisement never points at a half-written payload.
+static uint8_t mfg_data[2][SENSOR_ADV_LEGACY_MAX_LEN];
+static size_t mfg_data_len[2] = { SENSOR_ADV_LEGACY_MAX_LEN, 0 };
+static atomic_t mfg_active;         // Index of the advertised buffer
+static K_MUTEX_DEFINE(mfg_lock);    // One writer at a time
 #define DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
 
-
-
-// BLE Advertising Data
-const struct bt_data sensor_ad[] = {
-    BT_DATA_BYTES(BT_DATA_FLAGS, BT_LE_AD_NO_BREDR),  // Add the No BR/EDR flag
-    BT_DATA(BT_DATA_MANUFACTURER_DATA, mfg_data, sizeof(mfg_data)),  // Add manufacturer data
+// Advertising data in use, its manufacturer data entry follows the active buffer
+static struct bt_data adv_data[] = {
+    BT_DATA_BYTES(BT_DATA_FLAGS, BT_LE_AD_NO_BREDR),
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, mfg_data[0], SENSOR_ADV_LEGACY_MAX_LEN),
 };
+#define ADV_DATA_MFG 1
 
 // Scan Response Data
 const struct bt_data sd[] = {
     BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
 };
 
+// Advertising parameters, same defaults as BT_LE_ADV_CONN / BT_LE_ADV_NCONN_IDENTITY
+#ifdef CONFIG_BT_PERIPHERAL
+#define SENSOR_ADV_OPTIONS BT_LE_ADV_OPT_CONNECTABLE
+#else
+#define SENSOR_ADV_OPTIONS BT_LE_ADV_OPT_USE_IDENTITY
+#endif // CONFIG_BT_PERIPHERAL
+
+static struct bt_le_adv_param adv_param = BT_LE_ADV_PARAM_INIT(SENSOR_ADV_OPTIONS,
+                                                               BT_GAP_ADV_FAST_INT_MIN_2,
+                                                               BT_GAP_ADV_FAST_INT_MAX_2,
+                                                               NULL);
+
 #ifdef CONFIG_BT_PERIPHERAL
 
+// Set when an interval change had to stop advertising during a connection
+static bool adv_restart_pending;
+
 static void update_data_length(struct bt_conn *conn)
 {
     int err;
@@ -40,6 +73,23 @@ static void update_data_length(struct bt_conn *conn)
     }
 }
 
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+// 2M PHY halves the airtime of each packet, the central may still refuse it
+static void update_phy(struct bt_conn *conn)
+{
+    int err;
+    const struct bt_conn_le_phy_param preferred_phy = {
+        .options = BT_CONN_LE_PHY_OPT_NONE,
+        .pref_rx_phy = BT_GAP_LE_PHY_2M,
+        .pref_tx_phy = BT_GAP_LE_PHY_2M,
+    };
+    err = bt_conn_le_phy_update(conn, &preferred_phy);
+    if (err) {
+        LOG_ERR("bt_conn_le_phy_update failed (err %d)", err);
+    }
+}
+#endif // CONFIG_BT_USER_PHY_UPDATE
+
 static struct bt_gatt_exchange_params exchange_params;
 
 static void exchange_func(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_exchange_params *params);
@@ -79,6 +129,9 @@ static void connected(struct bt_conn *conn, uint8_t err)
     }   
  	update_data_length(conn);
     update_mtu(conn);
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+    update_phy(conn);
+#endif // CONFIG_BT_USER_PHY_UPDATE
 }
 
 
@@ -88,6 +141,22 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     // Additional disconnection handling code
 }
 
+// The connection object is free again, advertising can be restarted
+static void recycled(void)
+{
+    if (!adv_restart_pending) {
+        return;
+    }
+    adv_restart_pending = false;
+
+    k_mutex_lock(&mfg_lock, K_FOREVER);
+    int err = bt_le_adv_start(&adv_param, adv_data, ARRAY_SIZE(adv_data), sd, ARRAY_SIZE(sd));
+    k_mutex_unlock(&mfg_lock);
+    if (err) {
+        LOG_ERR("Failed to restart advertising (err %d)", err);
+    }
+}
+
 
 
 void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
@@ -107,6 +176,15 @@ void on_le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_inf
     LOG_INF("Data length updated. Length %d/%d bytes, time %d/%d us", tx_len, rx_len, tx_time, rx_time);
 }
 
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+void on_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    LOG_INF("PHY updated. TX %s, RX %s",
+            param->tx_phy == BT_GAP_LE_PHY_2M ? "2M" : "1M",
+            param->rx_phy == BT_GAP_LE_PHY_2M ? "2M" : "1M");
+}
+#endif // CONFIG_BT_USER_PHY_UPDATE
+
 #ifdef CONFIG_BT_SMP
 
 #define FIXED_PASSKEY 123456
@@ -130,8 +208,12 @@ static void on_security_changed(struct bt_conn *conn, bt_security_t level,
 static struct bt_conn_cb conn_callbacks = {
     .connected = connected,
     .disconnected = disconnected,
+    .recycled = recycled,
     .le_param_updated = on_le_param_updated,
     .le_data_len_updated    = on_le_data_len_updated,
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+    .le_phy_updated = on_le_phy_updated,
+#endif // CONFIG_BT_USER_PHY_UPDATE
 #ifdef CONFIG_BT_SMP
     .security_changed = on_security_changed,
 #endif // CONFIG_BT_SMP
@@ -185,12 +267,21 @@ void bt_ready(int err) {
 
     LOG_INF("Bluetooth initialized");
 
-    // Start connectable advertising
-#ifdef CONFIG_BT_PERIPHERAL
-    bt_le_adv_start(BT_LE_ADV_CONN, sensor_ad, ARRAY_SIZE(sensor_ad), sd, ARRAY_SIZE(sd));
-#else
-    bt_le_adv_start(BT_LE_ADV_NCONN_IDENTITY, sensor_ad, ARRAY_SIZE(sensor_ad), sd, ARRAY_SIZE(sd));
-#endif
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+    // Advertise with the stored configuration from the first packet
+    struct sensor_config cfg;
+
+    sensor_config_get(&cfg);
+    adv_param.interval_min = cfg.adv_interval_min_ms * 8 / 5;
+    adv_param.interval_max = cfg.adv_interval_max_ms * 8 / 5;
+    sensor_ble_set_tx_power(cfg.tx_power_dbm);
+#endif // CONFIG_SENSOR_BLE_SERVICE
+
+    // Start advertising (connectable if CONFIG_BT_PERIPHERAL), with the
+    // latest payload in case it was set before Bluetooth was ready
+    k_mutex_lock(&mfg_lock, K_FOREVER);
+    bt_le_adv_start(&adv_param, adv_data, ARRAY_SIZE(adv_data), sd, ARRAY_SIZE(sd));
+    k_mutex_unlock(&mfg_lock);
 
     // Retrieve and log the Bluetooth address
     bt_id_get(&addr, &count);
@@ -228,51 +319,212 @@ int init_ble(void) {
     if (err) {
         LOG_ERR("Bluetooth init failed (err %d)\n", err);
     }
+
+#ifdef CONFIG_SENSOR_AUTH_SEAL
+    // Payloads are not advertised until sealing is ready
+    int auth_err = sensor_auth_init();
+    if (auth_err) {
+        LOG_ERR("Sensor auth init failed (err %d)", auth_err);
+    }
+#endif // CONFIG_SENSOR_AUTH_SEAL
     return err; // Always return the error code from bt_enable to use on bt_ready // load_settings fix!
 }
 
+#ifdef CONFIG_SENSOR_AUTH_SEAL
+// Plain frames are built here and sealed into the spare buffer on commit
+#define ADV_PAYLOAD_MAX_LEN (SENSOR_ADV_LEGACY_MAX_LEN - SENSOR_AUTH_OVERHEAD)
+static uint8_t plain_data[2][ADV_PAYLOAD_MAX_LEN];
+static size_t plain_data_len[2];
+static int plain_active;
+#else
+#define ADV_PAYLOAD_MAX_LEN SENSOR_ADV_LEGACY_MAX_LEN
+#endif // CONFIG_SENSOR_AUTH_SEAL
+
+// Take the writer lock and return the buffer to build a payload in
+static uint8_t *adv_payload_begin(void) {
+    k_mutex_lock(&mfg_lock, K_FOREVER);
+#ifdef CONFIG_SENSOR_AUTH_SEAL
+    return plain_data[!plain_active];
+#else
+    return mfg_data[!atomic_get(&mfg_active)];
+#endif // CONFIG_SENSOR_AUTH_SEAL
+}
+
+static void adv_payload_abort(void) {
+    k_mutex_unlock(&mfg_lock);
+}
+
+// Swap the spare buffer in and push it to the controller, unless it matches
+// what is already on air
+static void adv_payload_commit(size_t len) {
+    int active = atomic_get(&mfg_active);
+    int spare = !active;
+
+#ifdef CONFIG_SENSOR_AUTH_SEAL
+    // Sealed bytes differ on every call, so compare the plain frames
+    if (len == plain_data_len[plain_active] &&
+        memcmp(plain_data[!plain_active], plain_data[plain_active], len) == 0) {
+        LOG_DBG("Advertising data unchanged, update skipped");
+        k_mutex_unlock(&mfg_lock);
+        return;
+    }
+
+    int sealed = sensor_auth_seal(plain_data[!plain_active], len,
+                                  mfg_data[spare], sizeof(mfg_data[spare]));
+    if (sealed < 0) {
+        LOG_ERR("Failed to seal advertising data (err %d)", sealed);
+        k_mutex_unlock(&mfg_lock);
+        return;
+    }
+    plain_active = !plain_active;
+    plain_data_len[plain_active] = len;
+    len = sealed;
+#else
+    if (len == mfg_data_len[active] && memcmp(mfg_data[spare], mfg_data[active], len) == 0) {
+        LOG_DBG("Advertising data unchanged, update skipped");
+        k_mutex_unlock(&mfg_lock);
+        return;
+    }
+#endif // CONFIG_SENSOR_AUTH_SEAL
+
+    mfg_data_len[spare] = len;
+    adv_data[ADV_DATA_MFG].data = mfg_data[spare];
+    adv_data[ADV_DATA_MFG].data_len = len;
+    atomic_set(&mfg_active, spare);
+
+    // Swapped even on failure, a later (re)start picks the payload up
+    int err = bt_le_adv_update_data(adv_data, ARRAY_SIZE(adv_data), sd, ARRAY_SIZE(sd));
+    if (err && err != -EAGAIN) {
+        LOG_ERR("Failed to update advertising data (err %d)", err);
+    }
+
+    // Log the manufacturer data for debugging
+    LOG_HEXDUMP_DBG(mfg_data[spare], len, "Manufacturer Data:");
+
+    k_mutex_unlock(&mfg_lock);
+
+#ifdef CONFIG_BATTERY_LEVEL
+    battery_level_radio_event();
+#endif // CONFIG_BATTERY_LEVEL
+}
+
 // Update Advertising Data with Sensor Data
 void sensor_data_adv_update(const sensor_data_t *data) {
-    size_t payload_size = 8;  // Fixed header size (company_id, type, padding, timestamp)
-
-    // Add the size of the values based on the sensor type
-    switch (data->type) {
-        case SENSOR_TYPE_TEMP:
-        case SENSOR_TYPE_PRESSURE:
-        case SENSOR_TYPE_LIGHT:
-            payload_size += 2;
-            break;
-        case SENSOR_TYPE_ENVIRONMENTAL:
-        case SENSOR_TYPE_MOTION:
-            // Double value sensors 2 values × 2 bytes = 4 bytes
-            payload_size += 4;
-            break;
-        case SENSOR_TYPE_ACCEL:
-        case SENSOR_TYPE_GYRO:
-            // Triple value sensors: 3 values × 2 bytes = 6 bytes
-            payload_size += 6;
-            break;
-        case SENSOR_TYPE_GNSS:
-            // GNSS: fix type (1 byte) + padding (1 byte) + latitude (4 bytes) + longitude (4 bytes) + altitude (4 bytes) = 14 bytes
-            payload_size += 14;
-            break;
-        default:
-            LOG_ERR("Unknown sensor type. Cannot update advertising data.");
-            return;
+    int values_len = sensor_data_values_len(data->type);
+
+    if (values_len < 0) {
+        LOG_ERR("Unknown sensor type. Cannot update advertising data.");
+        return;
     }
 
-    // Copy only the relevant part of the sensor data into mfg_data
-    memcpy(mfg_data, data, payload_size);
+    // Copy only the relevant part of the sensor data into the payload
+    // Fixed header size (company_id, type, padding, timestamp) + values
+    size_t len = SENSOR_DATA_HEADER_LEN + values_len;
+    if (len > ADV_PAYLOAD_MAX_LEN) {
+        LOG_ERR("Sensor type %d does not fit in the advertising data", data->type);
+        return;
+    }
+    memcpy(adv_payload_begin(), data, len);
 
-    // Define the advertising data dynamically
-    const struct bt_data test_ad[] = {
-        BT_DATA_BYTES(BT_DATA_FLAGS, BT_LE_AD_NO_BREDR),  // Advertising flags (3 bytes)
-        BT_DATA(BT_DATA_MANUFACTURER_DATA, mfg_data, payload_size),  // Manufacturer data with dynamic size
-    };
+    adv_payload_commit(len);
+}
 
-    // Update the advertising data
-    bt_le_adv_update_data(test_ad, ARRAY_SIZE(test_ad), sd, ARRAY_SIZE(sd));
+// Update Advertising Data with several readings at once
+int sensor_data_adv_update_multi(const sensor_data_t *readings, size_t count) {
+    size_t packed;
+    int len;
 
-    // Log the manufacturer data for debugging
-    LOG_HEXDUMP_DBG(mfg_data, payload_size, "Manufacturer Data:");
-}
\ No newline at end of file
+    if (count == 0) {
+        return -EINVAL;
+    }
+
+    // A single reading keeps the plain frame every scanner already understands
+    if (count == 1) {
+        sensor_data_adv_update(&readings[0]);
+        return 1;
+    }
+
+    len = sensor_composite_encode(readings, count, adv_payload_begin(),
+                                  ADV_PAYLOAD_MAX_LEN, &packed);
+    if (len < 0) {
+        adv_payload_abort();
+        LOG_ERR("Failed to pack composite advertising data (err %d)", len);
+        return len;
+    }
+
+    adv_payload_commit(len);
+
+    return packed;
+}
+
+// Change the advertising interval, e.g. to slow down while the sensor is idle
+int sensor_ble_adv_set_interval(uint16_t min_ms, uint16_t max_ms) {
+    int err;
+
+    // Advertising interval units are 0.625 ms
+    adv_param.interval_min = min_ms * 8 / 5;
+    adv_param.interval_max = max_ms * 8 / 5;
+
+    // Hold the writer lock so the restart carries a complete payload
+    k_mutex_lock(&mfg_lock, K_FOREVER);
+
+    err = bt_le_adv_stop();
+    if (err) {
+        k_mutex_unlock(&mfg_lock);
+        LOG_ERR("Failed to stop advertising (err %d)", err);
+        return err;
+    }
+
+    err = bt_le_adv_start(&adv_param, adv_data, ARRAY_SIZE(adv_data), sd, ARRAY_SIZE(sd));
+    k_mutex_unlock(&mfg_lock);
+#ifdef CONFIG_BT_PERIPHERAL
+    if (err == -ENOMEM) {
+        // No free connection slot, restart once the current link is gone
+        adv_restart_pending = true;
+        LOG_INF("Advertising interval %u-%u ms applies after disconnect", min_ms, max_ms);
+        return 0;
+    }
+#endif // CONFIG_BT_PERIPHERAL
+    if (err) {
+        LOG_ERR("Failed to restart advertising (err %d)", err);
+        return err;
+    }
+
+    LOG_INF("Advertising interval set to %u-%u ms", min_ms, max_ms);
+    return 0;
+}
+
+// Set the advertising TX power through the Zephyr vendor HCI command
+int sensor_ble_set_tx_power(int8_t dbm) {
+#ifdef CONFIG_BT_CTLR_TX_PWR_DYNAMIC_CONTROL
+    struct bt_hci_cp_vs_write_tx_power_level *cp;
+    struct bt_hci_rp_vs_write_tx_power_level *rp;
+    struct net_buf *buf, *rsp = NULL;
+    int err;
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle_type = BT_HCI_VS_LL_HANDLE_TYPE_ADV;
+    cp->handle = sys_cpu_to_le16(0);
+    cp->tx_power_level = dbm;
+
+    err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, buf, &rsp);
+    if (err) {
+        LOG_ERR("Failed to set TX power (err %d)", err);
+        return err;
+    }
+
+    rp = (void *)rsp->data;
+    LOG_INF("TX power set to %d dBm", rp->selected_tx_power);
+    net_buf_unref(rsp);
+    return 0;
+#else
+    ARG_UNUSED(dbm);
+    LOG_DBG("TX power control not enabled");
+    return -ENOTSUP;
+#endif // CONFIG_BT_CTLR_TX_PWR_DYNAMIC_CONTROL
+}
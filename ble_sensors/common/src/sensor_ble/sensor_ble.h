@@ -7,8 +7,7 @@
 #include <zephyr/logging/log.h>
 #include "sensor_common.h"
 
-// BLE Advertising Data
-extern const struct bt_data sensor_ad[];
+// Scan Response Data
 extern const struct bt_data sd[];
 
 // BLE Functions
@@ -16,4 +15,36 @@ void bt_ready(int err);
 int init_ble(void);
 void sensor_data_adv_update(const sensor_data_t *data);
 
+/**
+ * @brief Advertise several readings in one SENSOR_TYPE_COMPOSITE payload.
+ *
+ * A single reading is advertised as a plain frame. Readings that do not fit
+ * in a legacy advertisement are left out, starting from the end, and readings
+ * of a type that cannot be packed are skipped.
+ *
+ * @return Number of readings consumed, skipped ones included, or a negative
+ *         error code.
+ */
+int sensor_data_adv_update_multi(const sensor_data_t *readings, size_t count);
+
+/**
+ * @brief Restart advertising with a new interval, keeping the current payload.
+ *
+ * @param min_ms Minimum advertising interval in milliseconds
+ * @param max_ms Maximum advertising interval in milliseconds
+ *
+ * @return 0 on success or a negative error code.
+ */
+int sensor_ble_adv_set_interval(uint16_t min_ms, uint16_t max_ms);
+
+/**
+ * @brief Set the advertising TX power.
+ *
+ * @param dbm Requested power, the controller picks the nearest level it supports
+ *
+ * @return 0 on success, -ENOTSUP without CONFIG_BT_CTLR_TX_PWR_DYNAMIC_CONTROL
+ *         or another negative error code.
+ */
+int sensor_ble_set_tx_power(int8_t dbm);
+
 #endif // SENSOR_BLE_H
\ No newline at end of file
@@ -2,6 +2,11 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/init.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include "sensor_ble.h"
 
 LOG_MODULE_REGISTER(sensor_ble_service, CONFIG_SENSOR_BLE_SERVICE_LOG_LEVEL);
 
@@ -17,7 +22,124 @@ static void sensor_data_ccc_change(const struct bt_gatt_attr *attr, uint16_t val
     LOG_INF("Sensor Data notifications %s", sensor_data_notify_enabled ? "enabled" : "disabled");
 }
 
-uint8_t sensor_interval_var = 10;
+// Current configuration, written from the BT RX thread and read by the application
+static struct sensor_config config = {
+    .version = SENSOR_CONFIG_VERSION,
+    .sample_period_ms = CONFIG_SENSOR_BLE_SERVICE_SAMPLE_PERIOD_MS,
+    .adv_interval_min_ms = CONFIG_SENSOR_BLE_SERVICE_ADV_INTERVAL_MIN_MS,
+    .adv_interval_max_ms = CONFIG_SENSOR_BLE_SERVICE_ADV_INTERVAL_MAX_MS,
+    .deadband = 0,
+    .tx_power_dbm = CONFIG_SENSOR_BLE_SERVICE_TX_POWER_DBM,
+};
+static struct k_spinlock config_lock;
+static sensor_config_cb_t config_cb;
+
+// Radio settings changed by the last writes, applied by the work item
+#define CONFIG_CHANGED_ADV  BIT(0)
+#define CONFIG_CHANGED_TX   BIT(1)
+static atomic_t config_changed;
+
+static void config_apply_handler(struct k_work *work);
+static K_WORK_DEFINE(config_apply_work, config_apply_handler);
+
+void sensor_config_get(struct sensor_config *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&config_lock);
+    *out = config;
+    k_spin_unlock(&config_lock, key);
+}
+
+uint32_t sensor_config_sample_period_ms(void)
+{
+    struct sensor_config cfg;
+
+    sensor_config_get(&cfg);
+    return cfg.sample_period_ms;
+}
+
+void sensor_config_set_callback(sensor_config_cb_t cb)
+{
+    config_cb = cb;
+}
+
+static bool config_is_valid(const struct sensor_config *cfg)
+{
+    return cfg->version == SENSOR_CONFIG_VERSION &&
+           IN_RANGE(cfg->sample_period_ms, SENSOR_CONFIG_PERIOD_MIN_MS, SENSOR_CONFIG_PERIOD_MAX_MS) &&
+           IN_RANGE(cfg->adv_interval_min_ms, SENSOR_CONFIG_ADV_MIN_MS, SENSOR_CONFIG_ADV_MAX_MS) &&
+           IN_RANGE(cfg->adv_interval_max_ms, cfg->adv_interval_min_ms, SENSOR_CONFIG_ADV_MAX_MS) &&
+           IN_RANGE(cfg->tx_power_dbm, SENSOR_CONFIG_TX_POWER_MIN, SENSOR_CONFIG_TX_POWER_MAX);
+}
+
+// Wire format is little endian, the struct is kept in CPU order
+static void config_from_le(struct sensor_config *cfg)
+{
+    cfg->sample_period_ms = sys_le32_to_cpu(cfg->sample_period_ms);
+    cfg->adv_interval_min_ms = sys_le16_to_cpu(cfg->adv_interval_min_ms);
+    cfg->adv_interval_max_ms = sys_le16_to_cpu(cfg->adv_interval_max_ms);
+    cfg->deadband = sys_le16_to_cpu(cfg->deadband);
+}
+
+static void config_to_le(struct sensor_config *cfg)
+{
+    cfg->sample_period_ms = sys_cpu_to_le32(cfg->sample_period_ms);
+    cfg->adv_interval_min_ms = sys_cpu_to_le16(cfg->adv_interval_min_ms);
+    cfg->adv_interval_max_ms = sys_cpu_to_le16(cfg->adv_interval_max_ms);
+    cfg->deadband = sys_cpu_to_le16(cfg->deadband);
+}
+
+static void config_set(const struct sensor_config *cfg)
+{
+    k_spinlock_key_t key = k_spin_lock(&config_lock);
+    if (cfg->adv_interval_min_ms != config.adv_interval_min_ms ||
+        cfg->adv_interval_max_ms != config.adv_interval_max_ms) {
+        atomic_or(&config_changed, CONFIG_CHANGED_ADV);
+    }
+    if (cfg->tx_power_dbm != config.tx_power_dbm) {
+        atomic_or(&config_changed, CONFIG_CHANGED_TX);
+    }
+    config = *cfg;
+    k_spin_unlock(&config_lock, key);
+
+    LOG_INF("Config: period %u ms, adv %u-%u ms, deadband %u, tx %d dBm",
+            cfg->sample_period_ms, cfg->adv_interval_min_ms, cfg->adv_interval_max_ms,
+            cfg->deadband, cfg->tx_power_dbm);
+
+    // Flash and advertising restarts stay out of the BT RX thread
+    k_work_submit(&config_apply_work);
+}
+
+// Runs on the system work queue
+static void config_apply_handler(struct k_work *work)
+{
+    struct sensor_config cfg;
+
+    sensor_config_get(&cfg);
+
+#ifdef CONFIG_SENSOR_BLE_SERVICE_PERSIST
+    struct sensor_config stored = cfg;
+
+    config_to_le(&stored);
+    int err = settings_save_one("sensor_cfg/cfg", &stored, sizeof(stored));
+    if (err) {
+        LOG_ERR("Failed to save config (err %d)", err);
+    }
+#endif // CONFIG_SENSOR_BLE_SERVICE_PERSIST
+
+    // Restarting advertising is only worth it when its settings changed
+    atomic_val_t changed = atomic_clear(&config_changed);
+    if (changed & CONFIG_CHANGED_ADV) {
+        sensor_ble_adv_set_interval(cfg.adv_interval_min_ms, cfg.adv_interval_max_ms);
+    }
+    if (changed & CONFIG_CHANGED_TX) {
+        sensor_ble_set_tx_power(cfg.tx_power_dbm);
+    }
+
+    if (config_cb) {
+        config_cb(&cfg);
+    }
+}
+
 static ssize_t on_sensor_data_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
     void *buf, uint16_t len, uint16_t offset) {
     // TODO: Implement read callback for "Sensor Data"
@@ -26,43 +148,95 @@ static ssize_t on_sensor_data_read(struct bt_conn *conn, const struct bt_gatt_at
 
 static ssize_t on_sensor_interval_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
     void *buf, uint16_t len, uint16_t offset) {
-    // TODO: Implementar callback de leitura para "Sensor Interval"
-    return bt_gatt_attr_read(conn, attr, buf, len, offset, &sensor_interval_var, sizeof(sensor_interval_var));
+    // One byte of seconds, saturated
+    uint8_t interval_s = MIN(sensor_config_sample_period_ms() / MSEC_PER_SEC, UINT8_MAX);
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &interval_s, sizeof(interval_s));
 }
+
 static ssize_t on_sensor_interval_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
     const void *buf, uint16_t len, uint16_t offset, uint8_t flags) {
-    sensor_interval_var = *(uint16_t *)buf;
-    LOG_INF("Sensor Interval set to %u seconds", sensor_interval_var);
+    struct sensor_config cfg;
+    uint32_t interval_s;
+
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    // Seconds as one byte, or two bytes little endian
+    if (len == sizeof(uint8_t)) {
+        interval_s = *(const uint8_t *)buf;
+    } else if (len == sizeof(uint16_t)) {
+        interval_s = sys_get_le16(buf);
+    } else {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    sensor_config_get(&cfg);
+    cfg.sample_period_ms = interval_s * MSEC_PER_SEC;
+    if (!config_is_valid(&cfg)) {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    config_set(&cfg);
+    return len;
+}
+
+static ssize_t on_sensor_config_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+    void *buf, uint16_t len, uint16_t offset) {
+    struct sensor_config cfg;
+
+    sensor_config_get(&cfg);
+    config_to_le(&cfg);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &cfg, sizeof(cfg));
+}
+
+static ssize_t on_sensor_config_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+    const void *buf, uint16_t len, uint16_t offset, uint8_t flags) {
+    struct sensor_config cfg;
+
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len != sizeof(cfg)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    memcpy(&cfg, buf, sizeof(cfg));
+    config_from_le(&cfg);
+    if (!config_is_valid(&cfg)) {
+        LOG_WRN("Config rejected (version %u)", cfg.version);
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    config_set(&cfg);
     return len;
 }
 
 #ifdef CONFIG_BT_SMP
-BT_GATT_SERVICE_DEFINE(sensor_ble_service_svc,
-    BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(SENSOR_BLE_SERVICE_UUID)),
-    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(SENSOR_DATA_CHAR_UUID),
-                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
-                           BT_GATT_PERM_READ_AUTHEN,
-                           on_sensor_data_read, NULL, &sensor_data_var),
-    BT_GATT_CCC(sensor_data_ccc_change, BT_GATT_PERM_READ_AUTHEN | BT_GATT_PERM_WRITE_AUTHEN),
-    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(SENSOR_INTERVAL_CHAR_UUID),
-                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
-                           BT_GATT_PERM_READ_AUTHEN | BT_GATT_PERM_WRITE,
-                           on_sensor_interval_read, on_sensor_interval_write, &sensor_interval_var)
-);
+#define SENSOR_PERM_READ  BT_GATT_PERM_READ_AUTHEN
+#define SENSOR_PERM_WRITE BT_GATT_PERM_WRITE_AUTHEN
 #else
+#define SENSOR_PERM_READ  BT_GATT_PERM_READ
+#define SENSOR_PERM_WRITE BT_GATT_PERM_WRITE
+#endif // CONFIG_BT_SMP
+
 BT_GATT_SERVICE_DEFINE(sensor_ble_service_svc,
     BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(SENSOR_BLE_SERVICE_UUID)),
     BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(SENSOR_DATA_CHAR_UUID),
                            BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
-                           BT_GATT_PERM_READ,
+                           SENSOR_PERM_READ,
                            on_sensor_data_read, NULL, &sensor_data_var),
-    BT_GATT_CCC(sensor_data_ccc_change, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CCC(sensor_data_ccc_change, SENSOR_PERM_READ | SENSOR_PERM_WRITE),
     BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(SENSOR_INTERVAL_CHAR_UUID),
                            BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
-                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
-                           on_sensor_interval_read, on_sensor_interval_write, &sensor_interval_var)
+                           SENSOR_PERM_READ | SENSOR_PERM_WRITE,
+                           on_sensor_interval_read, on_sensor_interval_write, NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(SENSOR_CONFIG_CHAR_UUID),
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           SENSOR_PERM_READ | SENSOR_PERM_WRITE,
+                           on_sensor_config_read, on_sensor_config_write, NULL)
 );
-#endif
 
 
 /* Send notification for sensor_data characteristic */
@@ -81,4 +255,53 @@ int send_sensor_data_notification(sensor_data_t sensor_data)
 int sensor_ble_service_init(void) {
     LOG_INF("BLE Sensor Service service initialized");
     return 0;
-}
\ No newline at end of file
+}
+
+#ifdef CONFIG_SENSOR_BLE_SERVICE_PERSIST
+
+static int config_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    struct sensor_config cfg;
+    const char *next;
+
+    if (!settings_name_steq(name, "cfg", &next) || next) {
+        return -ENOENT;
+    }
+
+    // A config from another layout version is dropped, the defaults stay
+    if (len != sizeof(cfg) || read_cb(cb_arg, &cfg, sizeof(cfg)) != sizeof(cfg)) {
+        LOG_WRN("Stored config has the wrong size, using defaults");
+        return 0;
+    }
+
+    config_from_le(&cfg);
+    if (!config_is_valid(&cfg)) {
+        LOG_WRN("Stored config is invalid, using defaults");
+        return 0;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&config_lock);
+    config = cfg;
+    k_spin_unlock(&config_lock, key);
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(sensor_cfg, "sensor_cfg", NULL, config_settings_set, NULL, NULL);
+
+// Restore the configuration before main() reads it
+static int sensor_config_load(void)
+{
+    int err = settings_subsys_init();
+    if (err) {
+        LOG_ERR("Settings init failed (err %d)", err);
+        return 0;
+    }
+
+    settings_load_subtree("sensor_cfg");
+    return 0;
+}
+
+SYS_INIT(sensor_config_load, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif // CONFIG_SENSOR_BLE_SERVICE_PERSIST
@@ -10,16 +10,55 @@
 // Sensor Data characteristic
 #define SENSOR_DATA_CHAR_UUID BT_UUID_128_ENCODE(0x9c330129, 0xb199, 0x41f3, 0xadf4, 0x2a51a76aad77)
 
-// Sensor Interval characteristic
+// Sensor Interval characteristic (seconds, kept for older clients)
 #define SENSOR_INTERVAL_CHAR_UUID BT_UUID_128_ENCODE(0x527c07fd, 0x600b, 0x409a, 0xad79, 0x1a885d7f9922)
 
-int sensor_ble_service_init(void);
-int send_sensor_data_notification(sensor_data_t sensor_data);
+// Sensor Config characteristic
+#define SENSOR_CONFIG_CHAR_UUID BT_UUID_128_ENCODE(0x3c6f9b1e, 0x52a4, 0x4d0b, 0x9e47, 0x81c2f07a6d35)
 
+#define SENSOR_CONFIG_VERSION 1
 
-#endif /* SENSOR_BLE_SERVICE_H */
+// Accepted ranges, writes outside them are rejected
+#define SENSOR_CONFIG_PERIOD_MIN_MS   100
+#define SENSOR_CONFIG_PERIOD_MAX_MS   (24 * 60 * 60 * MSEC_PER_SEC)
+#define SENSOR_CONFIG_ADV_MIN_MS      20        // Advertising interval limits of the spec
+#define SENSOR_CONFIG_ADV_MAX_MS      10240
+#define SENSOR_CONFIG_TX_POWER_MIN    -40
+#define SENSOR_CONFIG_TX_POWER_MAX    8
 
+// Sensor Config characteristic value, little endian
+struct sensor_config {
+    uint8_t version;                // SENSOR_CONFIG_VERSION
+    uint8_t reserved;
+    uint32_t sample_period_ms;
+    uint16_t adv_interval_min_ms;
+    uint16_t adv_interval_max_ms;
+    uint16_t deadband;              // Raw value change needed to republish, 0 publishes every sample
+    int8_t tx_power_dbm;
+    uint8_t reserved2;
+} __packed;
 
+/**
+ * @brief Called from the system work queue after a new configuration is applied.
+ */
+typedef void (*sensor_config_cb_t)(const struct sensor_config *config);
 
+int sensor_ble_service_init(void);
+int send_sensor_data_notification(sensor_data_t sensor_data);
 
-extern uint8_t sensor_interval_var; // Default sensor interval in seconds
\ No newline at end of file
+/**
+ * @brief Copy the current configuration.
+ */
+void sensor_config_get(struct sensor_config *config);
+
+/**
+ * @brief Current sample period in milliseconds.
+ */
+uint32_t sensor_config_sample_period_ms(void);
+
+/**
+ * @brief Register the callback run when the configuration changes over GATT.
+ */
+void sensor_config_set_callback(sensor_config_cb_t cb);
+
+#endif /* SENSOR_BLE_SERVICE_H */
@@ -2,9 +2,132 @@
 #include <zephyr/kernel.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <errno.h>
+#include <string.h>
 
 LOG_MODULE_REGISTER(sensor_common, CONFIG_SENSOR_COMMON_LOG_LEVEL);
 
+const char *activity_state_str(uint8_t state) {
+    switch (state) {
+        case ACTIVITY_STATE_STILL:
+            return "STILL";
+        case ACTIVITY_STATE_WALKING:
+            return "WALKING";
+        case ACTIVITY_STATE_RUNNING:
+            return "RUNNING";
+        case ACTIVITY_STATE_FALL:
+            return "FALL";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+int sensor_data_values_len(uint8_t type) {
+    switch (type) {
+        case SENSOR_TYPE_TEMP:
+        case SENSOR_TYPE_PRESSURE:
+        case SENSOR_TYPE_LIGHT:
+            return 2;
+        case SENSOR_TYPE_ENVIRONMENTAL:
+        case SENSOR_TYPE_MOTION:
+            // Double value sensors 2 values × 2 bytes = 4 bytes
+            return 4;
+        case SENSOR_TYPE_ACCEL:
+        case SENSOR_TYPE_GYRO:
+            // Triple value sensors: 3 values × 2 bytes = 6 bytes
+            return 6;
+        case SENSOR_TYPE_ACTIVITY:
+            // Activity: state + steps + cadence + posture = 4 values × 2 bytes = 8 bytes
+            return 8;
+        case SENSOR_TYPE_GNSS:
+            // GNSS: fix type + latitude (2 values) + longitude (2 values) + altitude (2 values) = 14 bytes
+            return 14;
+        default:
+            return -EINVAL;
+    }
+}
+
+int sensor_composite_encode(const sensor_data_t *readings, size_t count,
+                            uint8_t *buf, size_t buf_len, size_t *packed) {
+    size_t pos = SENSOR_DATA_HEADER_LEN;
+    uint32_t timestamp = 0;
+    size_t written = 0;
+    size_t skipped = 0;
+    size_t n;
+
+    for (n = 0; n < count; n++) {
+        int len = sensor_data_values_len(readings[n].type);
+
+        // Skip it, stopping here would leave every reading behind it out too
+        if (len < 0) {
+            skipped++;
+            continue;
+        }
+        if (pos + SENSOR_COMPOSITE_RECORD_LEN + len > buf_len) {
+            break;
+        }
+
+        buf[pos++] = readings[n].type;
+        buf[pos++] = len;
+        memcpy(&buf[pos], readings[n].values, len);
+        pos += len;
+
+        // Wrap-safe "newest of"
+        if (written == 0 || (int32_t)(readings[n].timestamp - timestamp) > 0) {
+            timestamp = readings[n].timestamp;
+        }
+        written++;
+    }
+
+    if (skipped) {
+        LOG_WRN("%zu readings of a type that cannot be packed skipped", skipped);
+    }
+
+    *packed = n;
+    if (written == 0) {
+        return (n == count) ? -EINVAL : -ENOSPC;
+    }
+
+    sys_put_le16(COMPANY_ID, &buf[0]);
+    buf[2] = SENSOR_TYPE_COMPOSITE;
+    buf[3] = written;   // Record count in the padding byte
+    sys_put_le32(timestamp, &buf[4]);
+
+    return pos;
+}
+
+int sensor_composite_decode(const uint8_t *buf, size_t len,
+                            sensor_data_t *readings, size_t max_readings) {
+    size_t pos = SENSOR_DATA_HEADER_LEN;
+    size_t n = 0;
+
+    if (len < SENSOR_DATA_HEADER_LEN || buf[2] != SENSOR_TYPE_COMPOSITE) {
+        return -EINVAL;
+    }
+
+    while (pos + SENSOR_COMPOSITE_RECORD_LEN <= len && n < max_readings) {
+        uint8_t type = buf[pos];
+        uint8_t values_len = buf[pos + 1];
+
+        pos += SENSOR_COMPOSITE_RECORD_LEN;
+        if (pos + values_len > len || values_len > sizeof(readings[n].values)) {
+            return -EINVAL;
+        }
+
+        memset(&readings[n], 0, sizeof(readings[n]));
+        readings[n].company_id = sys_get_le16(&buf[0]);
+        readings[n].type = type;
+        readings[n].timestamp = sys_get_le32(&buf[4]);
+        memcpy(readings[n].values, &buf[pos], values_len);
+
+        pos += values_len;
+        n++;
+    }
+
+    return n;
+}
+
 void sensor_data_print(const sensor_data_t *data) {
     LOG_DBG("Sensor Data: Type: %d | Timestamp: %u", data->type, data->timestamp);
     LOG_HEXDUMP_DBG(data, sizeof(sensor_data_t), "Sensor Data:");
@@ -58,6 +181,13 @@ void sensor_data_print(const sensor_data_t *data) {
             data->values[1] ? "STANDING" : "NON_STANDING");
             break;
 
+        case SENSOR_TYPE_ACTIVITY:
+            LOG_INF("Activity: %s | Steps: %u | Cadence: %d spm | Posture: %s",
+            activity_state_str(data->values[0]),
+            (uint16_t)data->values[1], data->values[2],
+            data->values[3] ? "STANDING" : "NON_STANDING");
+            break;
+
         default:
             LOG_WRN("Unknown sensor type received.");
             break;
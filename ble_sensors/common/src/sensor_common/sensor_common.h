@@ -24,9 +24,22 @@ typedef enum {
     SENSOR_TYPE_ACCEL = 5,
     SENSOR_TYPE_GYRO = 6,
     SENSOR_TYPE_GNSS = 7,
-    SENSOR_TYPE_MOTION = 8
+    SENSOR_TYPE_MOTION = 8,
+    SENSOR_TYPE_ACTIVITY = 9,
+    SENSOR_TYPE_COMPOSITE = 10,
+    SENSOR_TYPE_SECURE = 11     // AES-CCM sealed frame, see sensor_auth.h
 } sensor_type_t;
 
+// SENSOR_TYPE_ACTIVITY values: [0] state, [1] step count, [2] cadence (steps/min), [3] standing
+typedef enum {
+    ACTIVITY_STATE_STILL = 0,
+    ACTIVITY_STATE_WALKING = 1,
+    ACTIVITY_STATE_RUNNING = 2,
+    ACTIVITY_STATE_FALL = 3
+} activity_state_t;
+
+const char *activity_state_str(uint8_t state);
+
 
 // Structure for sensor data messages
 typedef struct sensor_data_t {
@@ -41,4 +54,47 @@ typedef struct sensor_data_t {
 
 void sensor_data_print(const sensor_data_t *data);
 
+/**
+ * @brief Bytes of values[] carried over the air for a sensor type.
+ *
+ * @return Length in bytes, or -EINVAL for an unknown type.
+ */
+int sensor_data_values_len(uint8_t type);
+
+// SENSOR_TYPE_COMPOSITE: the 8-byte sensor_data_t header (timestamp of the
+// newest reading) followed by one [type][len][values] record per reading.
+#define SENSOR_DATA_HEADER_LEN      8
+#define SENSOR_COMPOSITE_RECORD_LEN 2   // Record type + length, before the values
+#define SENSOR_ADV_LEGACY_MAX_LEN   26  // 31 - flags AD (3) - manufacturer data AD header (2)
+#define SENSOR_ADV_EXT_MAX_LEN      227 // 229 byte single AD structure - AD header (2)
+#define SENSOR_COMPOSITE_MAX_READINGS 8 // One reading per sensor type in practice
+
+/**
+ * @brief Pack several readings behind one header as SENSOR_TYPE_COMPOSITE.
+ *
+ * Readings are packed in order until the next one does not fit in @p buf_len.
+ * A reading of a type that cannot be packed is skipped and logged.
+ *
+ * @param readings Readings to pack
+ * @param count Number of readings
+ * @param buf Destination buffer
+ * @param buf_len Capacity of @p buf, e.g. SENSOR_ADV_LEGACY_MAX_LEN
+ * @param packed Number of readings consumed, written or skipped
+ *
+ * @return Bytes written, -ENOSPC if not even one reading fits, or -EINVAL if
+ *         none of them can be packed.
+ */
+int sensor_composite_encode(const sensor_data_t *readings, size_t count,
+                            uint8_t *buf, size_t buf_len, size_t *packed);
+
+/**
+ * @brief Unpack a SENSOR_TYPE_COMPOSITE payload into plain readings.
+ *
+ * Every reading gets the company ID and timestamp of the composite header.
+ *
+ * @return Number of readings decoded, or -EINVAL on a malformed payload.
+ */
+int sensor_composite_decode(const uint8_t *buf, size_t len,
+                            sensor_data_t *readings, size_t max_readings);
+
 #endif // SENSOR_COMMON_H
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "sensor_sampler.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(sensor_sampler, CONFIG_SENSOR_SAMPLER_LOG_LEVEL);
+
+struct sample {
+    sensor_data_t data;
+    int err;
+    uint32_t trigger_cyc;       // Cycle counter when the fetch started
+    uint32_t fetch_cyc;         // Cycles spent in fetch + convert
+};
+
+static const struct device *sensor;
+static sensor_sampler_convert_t convert_cb;
+static k_timeout_t sample_period;
+
+// Timing of the sample handed out by sensor_sampler_get()
+static uint32_t pending_trigger_cyc;
+static uint32_t pending_fetch_us;
+static bool pending;
+
+// Latency statistics, reset after every report
+static uint32_t stats_count;
+static uint32_t fetch_us_sum, fetch_us_max;
+static uint32_t latency_us_sum, latency_us_max;
+
+static void sample_once(struct sample *sample) {
+    sample->trigger_cyc = k_cycle_get_32();
+    sample->data.timestamp = k_uptime_get_32();
+
+    sample->err = sensor_sample_fetch(sensor);
+    if (sample->err < 0) {
+        LOG_ERR("Failed to fetch sensor sample (err %d)", sample->err);
+    } else {
+        sample->err = convert_cb(sensor, &sample->data);
+    }
+
+    sample->fetch_cyc = k_cycle_get_32() - sample->trigger_cyc;
+}
+
+#ifdef CONFIG_SENSOR_SAMPLER_ASYNC
+
+K_THREAD_STACK_DEFINE(sampler_stack, CONFIG_SENSOR_SAMPLER_STACK_SIZE);
+static struct k_work_q sampler_workq;
+
+// Depth 1: a slow consumer only ever gets the freshest sample
+K_MSGQ_DEFINE(sample_msgq, sizeof(struct sample), 1, 4);
+
+static void sample_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_work_handler);
+
+static void sample_work_handler(struct k_work *work) {
+    struct sample sample = {0};
+
+    sample_once(&sample);
+
+    while (k_msgq_put(&sample_msgq, &sample, K_NO_WAIT) != 0) {
+        k_msgq_purge(&sample_msgq);
+    }
+
+    k_work_schedule_for_queue(&sampler_workq, &sample_work, sample_period);
+}
+
+#endif // CONFIG_SENSOR_SAMPLER_ASYNC
+
+int sensor_sampler_init(const struct device *dev, sensor_sampler_convert_t convert,
+                        k_timeout_t period) {
+    if (!dev || !convert) {
+        return -EINVAL;
+    }
+
+    sensor = dev;
+    convert_cb = convert;
+    sample_period = period;
+
+#ifdef CONFIG_SENSOR_SAMPLER_ASYNC
+    k_work_queue_start(&sampler_workq, sampler_stack, K_THREAD_STACK_SIZEOF(sampler_stack),
+                       CONFIG_SENSOR_SAMPLER_PRIORITY, NULL);
+    k_thread_name_set(&sampler_workq.thread, "sensor_sampler");
+
+    k_work_schedule_for_queue(&sampler_workq, &sample_work, K_NO_WAIT);
+#endif // CONFIG_SENSOR_SAMPLER_ASYNC
+
+    LOG_INF("Sensor sampler started (%s)",
+            IS_ENABLED(CONFIG_SENSOR_SAMPLER_ASYNC) ? "work queue" : "blocking");
+    return 0;
+}
+
+void sensor_sampler_set_period(k_timeout_t period) {
+    sample_period = period;
+}
+
+static void stats_add(uint32_t fetch_us, uint32_t latency_us) {
+    if (CONFIG_SENSOR_SAMPLER_STATS_INTERVAL == 0) {
+        return;
+    }
+
+    stats_count++;
+    fetch_us_sum += fetch_us;
+    fetch_us_max = MAX(fetch_us_max, fetch_us);
+    latency_us_sum += latency_us;
+    latency_us_max = MAX(latency_us_max, latency_us);
+
+    if (stats_count >= CONFIG_SENSOR_SAMPLER_STATS_INTERVAL) {
+        // In blocking mode the fetch time is also time the main thread is stalled
+        LOG_INF("fetch avg %u us max %u us | sample-to-advertise avg %u us max %u us",
+                fetch_us_sum / stats_count, fetch_us_max,
+                latency_us_sum / stats_count, latency_us_max);
+        stats_count = 0;
+        fetch_us_sum = fetch_us_max = 0;
+        latency_us_sum = latency_us_max = 0;
+    }
+}
+
+int sensor_sampler_get(sensor_data_t *data, k_timeout_t timeout) {
+    struct sample sample = {0};
+
+#ifdef CONFIG_SENSOR_SAMPLER_ASYNC
+    if (k_msgq_get(&sample_msgq, &sample, timeout) != 0) {
+        return -EAGAIN;
+    }
+#else
+    static bool first = true;
+
+    // Same pacing as the old read/publish/sleep loop
+    if (!first) {
+        k_sleep(sample_period);
+    }
+    first = false;
+    ARG_UNUSED(timeout);
+
+    sample_once(&sample);
+#endif // CONFIG_SENSOR_SAMPLER_ASYNC
+
+    if (sample.err) {
+        return sample.err;
+    }
+
+    *data = sample.data;
+    pending_trigger_cyc = sample.trigger_cyc;
+    pending_fetch_us = k_cyc_to_us_floor32(sample.fetch_cyc);
+    pending = true;
+
+    return 0;
+}
+
+void sensor_sampler_published(void) {
+    if (!pending) {
+        return;
+    }
+    pending = false;
+
+    stats_add(pending_fetch_us, k_cyc_to_us_floor32(k_cycle_get_32() - pending_trigger_cyc));
+}
@@ -0,0 +1,44 @@
+#ifndef SENSOR_SAMPLER_H
+#define SENSOR_SAMPLER_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include "sensor_common.h"
+
+/**
+ * @brief Read the channels of a fetched sample into @p data.
+ *
+ * Called right after sensor_sample_fetch(). The timestamp is already set,
+ * the callback fills company_id, type and values.
+ *
+ * @return 0 on success or a negative error code.
+ */
+typedef int (*sensor_sampler_convert_t)(const struct device *dev, sensor_data_t *data);
+
+/**
+ * @brief Start sampling @p dev every @p period.
+ *
+ * With CONFIG_SENSOR_SAMPLER_ASYNC the first fetch is scheduled right away
+ * on the sampler work queue.
+ */
+int sensor_sampler_init(const struct device *dev, sensor_sampler_convert_t convert,
+                        k_timeout_t period);
+
+/**
+ * @brief Change the sampling period, applied from the next sample on.
+ */
+void sensor_sampler_set_period(k_timeout_t period);
+
+/**
+ * @brief Wait for the next sample.
+ *
+ * @return 0 on success, -EAGAIN on timeout, or the fetch/convert error.
+ */
+int sensor_sampler_get(sensor_data_t *data, k_timeout_t timeout);
+
+/**
+ * @brief Mark the last sample as advertised, for the sample-to-advertise latency.
+ */
+void sensor_sampler_published(void);
+
+#endif // SENSOR_SAMPLER_H
@@ -11,6 +11,9 @@
 #ifdef CONFIG_ACCEPT_LIST
 #include "accept_list_service.h"
 #endif
+#ifdef CONFIG_LINK_POLICY
+#include "link_policy.h"
+#endif // CONFIG_LINK_POLICY
 
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
@@ -108,12 +111,27 @@ void sensor_data_worker(void *a, void *b, void *c)
                         shadow.posture ? "STANDING" : "NON_STANDING");
                 break;
 
+            case SENSOR_TYPE_ACTIVITY:
+                // Activity nodes replace the motion payload, keep both shadow fields coherent
+                shadow.activity = pkt->sensor_data.values[0];
+                shadow.steps = pkt->sensor_data.values[1];
+                shadow.movement = (shadow.activity == ACTIVITY_STATE_WALKING ||
+                                   shadow.activity == ACTIVITY_STATE_RUNNING);
+                shadow.posture = pkt->sensor_data.values[3];
+                LOG_DBG("Activity: %s | Steps: %u",
+                        activity_state_str(shadow.activity), shadow.steps);
+                break;
+
             default:
                 LOG_DBG("Unknown sensor type: %d", pkt->sensor_data.type);
                 break;
         }
 
-        send_worker_shadow_notification(shadow);
+        if (send_worker_shadow_notification(shadow) == 0) {
+#ifdef CONFIG_LINK_POLICY
+            link_policy_activity();
+#endif // CONFIG_LINK_POLICY
+        }
         k_free(pkt);
     }
 }
@@ -122,8 +140,6 @@ void sensor_data_worker(void *a, void *b, void *c)
 
 K_THREAD_DEFINE(worker_tid, 1024, sensor_data_worker, NULL, NULL, NULL, 5, 0, 0);
 
-extern bool worker_shadow_notify_enabled;
-
 int main(void)
 {
 
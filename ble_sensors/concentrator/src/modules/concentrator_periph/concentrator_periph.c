@@ -6,6 +6,12 @@
 #include <zephyr/bluetooth/hci.h>
 #include <bluetooth/scan.h>
 #include "worker_shadow_service.h"
+#ifdef CONFIG_LINK_POLICY
+#include "link_policy.h"
+#endif // CONFIG_LINK_POLICY
+#ifdef CONFIG_RADIO_SCHED
+#include "radio_sched.h"
+#endif // CONFIG_RADIO_SCHED
 
 LOG_MODULE_REGISTER(concentrator_periph, CONFIG_CONCENTRATOR_PERIPH_LOG_LEVEL);
 
@@ -26,6 +32,60 @@ const struct bt_data sd[] = {
     BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),  // Add device name to advertising data
 };
 
+// Centrals currently connected to us
+static atomic_t central_count;
+
+#ifdef CONFIG_CONCENTRATOR_PERIPH_DIRECTED_RECONNECT
+// Central that lost its link, called back with directed advertising first
+static bt_addr_le_t redirect_addr;
+static atomic_t redirect_pending;
+#endif // CONFIG_CONCENTRATOR_PERIPH_DIRECTED_RECONNECT
+
+static void adv_work_handler(struct k_work *work);
+static K_WORK_DEFINE(adv_work, adv_work_handler);
+
+// Keep advertising while a central slot is free. One-time advertising stops on
+// every connection, so this runs again after each connect and disconnect.
+static void adv_work_handler(struct k_work *work)
+{
+    int err;
+
+    if (atomic_get(&central_count) >= CONFIG_CONCENTRATOR_PERIPH_MAX_CENTRALS) {
+        return;
+    }
+
+#ifdef CONFIG_CONCENTRATOR_PERIPH_DIRECTED_RECONNECT
+    // High duty directed advertising lasts 1.28 s, then connected() reports
+    // the timeout and undirected advertising takes over. Undirected advertising
+    // still runs while another central slot is free, and the controller has
+    // one advertising set, so it is stopped first or the start fails with
+    // -EALREADY.
+    if (atomic_clear(&redirect_pending)) {
+        err = bt_le_adv_stop();
+        if (err) {
+            LOG_WRN("Failed to stop advertising (err %d)", err);
+        }
+        err = bt_le_adv_start(BT_LE_ADV_CONN_DIR(&redirect_addr), NULL, 0, NULL, 0);
+        if (err == 0) {
+            LOG_INF("Directed advertising to the lost central");
+            return;
+        }
+        LOG_WRN("Directed advertising failed (err %d)", err);
+    }
+#endif // CONFIG_CONCENTRATOR_PERIPH_DIRECTED_RECONNECT
+
+    err = bt_le_adv_start(BT_LE_ADV_CONN_ONE_TIME, sensor_ad, ARRAY_SIZE(sensor_ad), sd, ARRAY_SIZE(sd));
+    if (err == -ENOMEM) {
+        return;     // No free connection object yet, retried from recycled()
+    } else if (err && err != -EALREADY) {
+        LOG_ERR("Advertising failed to start (err %d)", err);
+        return;
+    }
+
+    LOG_INF("Advertising, %ld of %d centrals connected",
+            atomic_get(&central_count), CONFIG_CONCENTRATOR_PERIPH_MAX_CENTRALS);
+}
+
 
 static void update_data_length(struct bt_conn *conn)
 {
@@ -40,16 +100,19 @@ static void update_data_length(struct bt_conn *conn)
     }
 }
 
-static struct bt_gatt_exchange_params exchange_params;
+// One exchange per connection, the params must live until the callback
+static struct bt_gatt_exchange_params exchange_params[CONFIG_BT_MAX_CONN];
 
 static void exchange_func(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_exchange_params *params);
 
 static void update_mtu(struct bt_conn *conn)
 {
     int err;
-    exchange_params.func = exchange_func;
+    struct bt_gatt_exchange_params *params = &exchange_params[bt_conn_index(conn)];
 
-    err = bt_gatt_exchange_mtu(conn, &exchange_params);
+    params->func = exchange_func;
+
+    err = bt_gatt_exchange_mtu(conn, params);
     if (err) {
         LOG_ERR("bt_gatt_exchange_mtu failed (err %d)", err);
     }
@@ -62,7 +125,12 @@ static void connected(struct bt_conn *conn, uint8_t err)
     char addr[BT_ADDR_LE_STR_LEN];
 
     if (err) {
-        LOG_INF("Connection failed (err %u)\n", err);
+        if (err == BT_HCI_ERR_ADV_TIMEOUT) {
+            LOG_INF("Directed advertising timed out");
+        } else {
+            LOG_INF("Connection failed (err %u)\n", err);
+        }
+        k_work_submit(&adv_work);
         return;
     }
     else if(bt_conn_get_info(conn, &info)) {
@@ -80,8 +148,16 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
     update_data_length(conn);
     update_mtu(conn);
-                             
-
+    worker_shadow_service_connected(conn);
+#ifdef CONFIG_LINK_POLICY
+    link_policy_connected(conn);
+#endif // CONFIG_LINK_POLICY
+#ifdef CONFIG_RADIO_SCHED
+    radio_sched_conn_update(conn, info.le.interval);
+#endif // CONFIG_RADIO_SCHED
+
+    atomic_inc(&central_count);
+    k_work_submit(&adv_work);
 }
 
 
@@ -89,18 +165,34 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
     LOG_INF("Disconnected (reason %u)", reason);
     // Additional disconnection handling code
+    worker_shadow_service_disconnected(conn);
+#ifdef CONFIG_LINK_POLICY
+    link_policy_disconnected(conn);
+#endif // CONFIG_LINK_POLICY
+    atomic_dec(&central_count);
+#ifdef CONFIG_CONCENTRATOR_PERIPH_DIRECTED_RECONNECT
+    // Only a lost link, a central that left on purpose is not called back
+    if (reason == BT_HCI_ERR_CONN_TIMEOUT) {
+        bt_addr_le_copy(&redirect_addr, bt_conn_get_dst(conn));
+        atomic_set(&redirect_pending, 1);
+    }
+#endif // CONFIG_CONCENTRATOR_PERIPH_DIRECTED_RECONNECT
+    // Advertising restarts once the connection object is recycled
+#ifdef CONFIG_RADIO_SCHED
+    // Scanning gets the freed radio time with its next timing
+    radio_sched_conn_removed(conn);
+#else
     int err = bt_scan_stop();
     if (err) {
         LOG_ERR("Failed to stop scanning (err %d)", err);
         return;
     }
-    bt_le_adv_start(BT_LE_ADV_CONN_ONE_TIME, sensor_ad, ARRAY_SIZE(sensor_ad), sd, ARRAY_SIZE(sd));
     err = bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE);
     if (err) {
         LOG_ERR("Failed to start scanning (err %d)", err);
         return;
     }
-
+#endif // CONFIG_RADIO_SCHED
 }
 
 
@@ -111,8 +203,23 @@ void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t laten
     uint16_t supervision_timeout = timeout*10;          // in ms
     LOG_INF("Connection parameters updated: interval %.2f ms, latency %d intervals, timeout %d ms",
                         connection_interval, latency, supervision_timeout);
+#ifdef CONFIG_LINK_POLICY
+    link_policy_param_updated(conn, interval, latency, timeout);
+#endif // CONFIG_LINK_POLICY
+#ifdef CONFIG_RADIO_SCHED
+    radio_sched_conn_update(conn, interval);
+#endif // CONFIG_RADIO_SCHED
 }
 
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+void on_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    LOG_INF("PHY updated: TX %s, RX %s",
+            param->tx_phy == BT_GAP_LE_PHY_2M ? "2M" : "1M",
+            param->rx_phy == BT_GAP_LE_PHY_2M ? "2M" : "1M");
+}
+#endif // CONFIG_BT_USER_PHY_UPDATE
+
 void on_le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
 {
     uint16_t tx_len     = info->tx_max_len; 
@@ -137,12 +244,21 @@ static void on_security_changed(struct bt_conn *conn, bt_security_t level,
     }
 }
 
+static void recycled(void)
+{
+    k_work_submit(&adv_work);
+}
+
 static struct bt_conn_cb conn_callbacks = {
     .connected = connected,
     .disconnected = disconnected,
     .le_param_updated = on_le_param_updated,
     .le_data_len_updated    = on_le_data_len_updated,
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+    .le_phy_updated = on_le_phy_updated,
+#endif // CONFIG_BT_USER_PHY_UPDATE
     .security_changed = on_security_changed,
+    .recycled = recycled,
 };
 
 static void auth_passkey_display(struct bt_conn *conn, unsigned int passkey)
@@ -184,13 +300,13 @@ void concentrator_periph_bt_ready(int err) {
         LOG_ERR("Bluetooth init failed (err %d)\n", err);
         return;
     }
-	
-    bt_conn_cb_register(&conn_callbacks);
 
+    // Connection callbacks are registered once, in concentrator_periph_init(),
+    // a second registration would count every central twice
     LOG_INF("Bluetooth initialized");
 
     // Start connectable advertising
-    bt_le_adv_start(BT_LE_ADV_CONN_ONE_TIME, sensor_ad, ARRAY_SIZE(sensor_ad), sd, ARRAY_SIZE(sd));
+    k_work_submit(&adv_work);
 
     // Retrieve and log the Bluetooth address
     bt_id_get(&addr, &count);
@@ -0,0 +1,250 @@
+#include "link_policy.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+
+LOG_MODULE_REGISTER(link_policy, CONFIG_LINK_POLICY_LOG_LEVEL);
+
+BUILD_ASSERT(CONFIG_LINK_POLICY_TIMEOUT_MS >
+             2 * (1 + CONFIG_LINK_POLICY_IDLE_LATENCY) * CONFIG_LINK_POLICY_IDLE_INTERVAL_MS,
+             "Supervision timeout too short for the idle interval and latency");
+
+// Connection interval units are 1.25 ms, supervision timeout units 10 ms
+#define INTERVAL_UNITS(ms) ((ms) * 4 / 5)
+#define TIMEOUT_UNITS(ms)  ((ms) / 10)
+
+static const char *const mode_names[LINK_MODE_COUNT] = { "default", "idle", "burst" };
+
+// Every central link follows the same mode, indexed by bt_conn_index().
+// Written from the BT RX thread, read from the system work queue.
+static struct k_spinlock links_lock;
+static struct {
+    struct bt_conn *conn;
+    enum link_mode applied;     // Mode last requested on this link
+} links[CONFIG_BT_MAX_CONN];
+static size_t link_count;
+static enum link_mode mode = LINK_MODE_DEFAULT;
+static int64_t mode_since;
+static int64_t mode_time_ms[LINK_MODE_COUNT];
+static atomic_t burst_holds;
+
+// Burst detection, fed from whichever thread sends notifications
+static struct k_spinlock window_lock;
+static int64_t window_start;
+static uint32_t window_count;
+
+static void burst_work_handler(struct k_work *work);
+static void idle_work_handler(struct k_work *work);
+static void stats_work_handler(struct k_work *work);
+static K_WORK_DEFINE(burst_work, burst_work_handler);
+static K_WORK_DELAYABLE_DEFINE(idle_work, idle_work_handler);
+static K_WORK_DELAYABLE_DEFINE(stats_work, stats_work_handler);
+
+static void account_mode_time(void) {
+    int64_t now = k_uptime_get();
+
+    if (link_count) {
+        mode_time_ms[mode] += now - mode_since;
+    }
+    mode_since = now;
+}
+
+// Runs on the system work queue, the central may still pick other values
+static void set_mode(enum link_mode target) {
+    static const struct bt_le_conn_param burst_param = BT_LE_CONN_PARAM_INIT(
+        INTERVAL_UNITS(CONFIG_LINK_POLICY_BURST_INTERVAL_MS),
+        INTERVAL_UNITS(CONFIG_LINK_POLICY_BURST_INTERVAL_MS),
+        0, TIMEOUT_UNITS(CONFIG_LINK_POLICY_TIMEOUT_MS));
+    static const struct bt_le_conn_param idle_param = BT_LE_CONN_PARAM_INIT(
+        INTERVAL_UNITS(CONFIG_LINK_POLICY_IDLE_INTERVAL_MS),
+        INTERVAL_UNITS(CONFIG_LINK_POLICY_IDLE_INTERVAL_MS),
+        CONFIG_LINK_POLICY_IDLE_LATENCY, TIMEOUT_UNITS(CONFIG_LINK_POLICY_TIMEOUT_MS));
+    static const struct bt_conn_le_phy_param burst_phy =
+        BT_CONN_LE_PHY_PARAM_INIT(BT_GAP_LE_PHY_2M, BT_GAP_LE_PHY_2M);
+    static const struct bt_conn_le_phy_param idle_phy =
+        BT_CONN_LE_PHY_PARAM_INIT(BT_GAP_LE_PHY_1M, BT_GAP_LE_PHY_1M);
+    bool burst = (target == LINK_MODE_BURST);
+    k_spinlock_key_t key;
+    int err;
+
+    key = k_spin_lock(&links_lock);
+    size_t count = link_count;
+    k_spin_unlock(&links_lock, key);
+
+    if (!count) {
+        return;
+    }
+
+    if (target != mode) {
+        account_mode_time();
+        mode = target;
+        LOG_INF("Link mode %s", mode_names[target]);
+    }
+
+    // Links connected since the last change catch up here. The updates block,
+    // so each runs on its own reference: link_policy_disconnected() may drop
+    // the one in links[] meanwhile.
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        struct bt_conn *conn = NULL;
+
+        key = k_spin_lock(&links_lock);
+        if (links[i].conn && links[i].applied != target) {
+            conn = bt_conn_ref(links[i].conn);
+            links[i].applied = target;
+        }
+        k_spin_unlock(&links_lock, key);
+
+        if (!conn) {
+            continue;
+        }
+
+        err = bt_conn_le_param_update(conn, burst ? &burst_param : &idle_param);
+        if (err) {
+            LOG_WRN("Connection parameter update failed (err %d)", err);
+        }
+
+        err = bt_conn_le_phy_update(conn, burst ? &burst_phy : &idle_phy);
+        if (err) {
+            LOG_WRN("PHY update failed (err %d)", err);
+        }
+
+        bt_conn_unref(conn);
+    }
+}
+
+static void burst_work_handler(struct k_work *work) {
+    set_mode(LINK_MODE_BURST);
+    k_work_reschedule(&idle_work, K_MSEC(CONFIG_LINK_POLICY_IDLE_TIMEOUT_MS));
+}
+
+static void idle_work_handler(struct k_work *work) {
+    if (atomic_get(&burst_holds) > 0) {
+        k_work_reschedule(&idle_work, K_MSEC(CONFIG_LINK_POLICY_IDLE_TIMEOUT_MS));
+        return;
+    }
+    set_mode(LINK_MODE_IDLE);
+}
+
+static void stats_work_handler(struct k_work *work) {
+    account_mode_time();
+
+    LOG_INF("Time per mode: default %lld s | idle %lld s | burst %lld s",
+            mode_time_ms[LINK_MODE_DEFAULT] / MSEC_PER_SEC,
+            mode_time_ms[LINK_MODE_IDLE] / MSEC_PER_SEC,
+            mode_time_ms[LINK_MODE_BURST] / MSEC_PER_SEC);
+
+    k_work_reschedule(&stats_work, K_SECONDS(CONFIG_LINK_POLICY_STATS_INTERVAL_S));
+}
+
+void link_policy_connected(struct bt_conn *conn) {
+    uint8_t index = bt_conn_index(conn);
+    k_spinlock_key_t key;
+
+    if (links[index].conn) {
+        return;
+    }
+
+    if (link_count == 0) {
+        mode = LINK_MODE_DEFAULT;
+        mode_since = k_uptime_get();
+
+        if (CONFIG_LINK_POLICY_STATS_INTERVAL_S > 0) {
+            k_work_reschedule(&stats_work, K_SECONDS(CONFIG_LINK_POLICY_STATS_INTERVAL_S));
+        }
+    }
+
+    key = k_spin_lock(&links_lock);
+    links[index].conn = bt_conn_ref(conn);
+    links[index].applied = LINK_MODE_DEFAULT;
+    link_count++;
+    k_spin_unlock(&links_lock, key);
+
+    // Let the central finish discovery on its own parameters first, then
+    // set_mode() brings this link in line with the others
+    k_work_reschedule(&idle_work, K_MSEC(CONFIG_LINK_POLICY_IDLE_TIMEOUT_MS));
+}
+
+void link_policy_disconnected(struct bt_conn *conn) {
+    uint8_t index = bt_conn_index(conn);
+    k_spinlock_key_t key;
+
+    if (links[index].conn != conn) {
+        return;
+    }
+
+    if (link_count == 1) {
+        k_work_cancel_delayable(&idle_work);
+        k_work_cancel_delayable(&stats_work);
+        account_mode_time();
+        mode = LINK_MODE_DEFAULT;
+    }
+
+    key = k_spin_lock(&links_lock);
+    links[index].conn = NULL;
+    link_count--;
+    k_spin_unlock(&links_lock, key);
+
+    bt_conn_unref(conn);
+}
+
+void link_policy_param_updated(struct bt_conn *conn, uint16_t interval,
+                               uint16_t latency, uint16_t timeout) {
+    uint8_t index = bt_conn_index(conn);
+    enum link_mode applied = links[index].applied;
+
+    if (links[index].conn != conn || applied == LINK_MODE_DEFAULT) {
+        return;
+    }
+
+    // The central has the last word, make a refusal visible
+    uint16_t wanted = (applied == LINK_MODE_BURST) ?
+                      INTERVAL_UNITS(CONFIG_LINK_POLICY_BURST_INTERVAL_MS) :
+                      INTERVAL_UNITS(CONFIG_LINK_POLICY_IDLE_INTERVAL_MS);
+    if (interval != wanted) {
+        LOG_WRN("Central chose %u units instead of %u for %s mode",
+                interval, wanted, mode_names[applied]);
+    }
+}
+
+void link_policy_activity(void) {
+    int64_t now = k_uptime_get();
+    bool burst;
+
+    k_spinlock_key_t key = k_spin_lock(&window_lock);
+    if (now - window_start > CONFIG_LINK_POLICY_BURST_WINDOW_MS) {
+        window_start = now;
+        window_count = 0;
+    }
+    window_count++;
+    burst = window_count >= CONFIG_LINK_POLICY_BURST_THRESHOLD;
+    k_spin_unlock(&window_lock, key);
+
+    if (burst) {
+        k_work_submit(&burst_work);
+    } else if (mode == LINK_MODE_BURST) {
+        // Still sending, stay in burst mode
+        k_work_reschedule(&idle_work, K_MSEC(CONFIG_LINK_POLICY_IDLE_TIMEOUT_MS));
+    }
+}
+
+void link_policy_burst_begin(void) {
+    atomic_inc(&burst_holds);
+    k_work_submit(&burst_work);
+}
+
+void link_policy_burst_end(void) {
+    if (atomic_dec(&burst_holds) <= 0) {
+        atomic_set(&burst_holds, 0);
+    }
+    k_work_reschedule(&idle_work, K_MSEC(CONFIG_LINK_POLICY_IDLE_TIMEOUT_MS));
+}
+
+int64_t link_policy_time_in_mode(enum link_mode target) {
+    int64_t total = mode_time_ms[target];
+
+    if (link_count && target == mode) {
+        total += k_uptime_get() - mode_since;
+    }
+    return total;
+}
@@ -0,0 +1,35 @@
+#ifndef LINK_POLICY_H
+#define LINK_POLICY_H
+
+#include <zephyr/bluetooth/conn.h>
+
+enum link_mode {
+    LINK_MODE_DEFAULT,      // Parameters picked by the central
+    LINK_MODE_IDLE,
+    LINK_MODE_BURST,
+    LINK_MODE_COUNT
+};
+
+// Connection callbacks, called by concentrator_periph
+void link_policy_connected(struct bt_conn *conn);
+void link_policy_disconnected(struct bt_conn *conn);
+void link_policy_param_updated(struct bt_conn *conn, uint16_t interval,
+                               uint16_t latency, uint16_t timeout);
+
+/**
+ * @brief Report a notification sent on the link. Enough of them in a row start a burst.
+ */
+void link_policy_activity(void);
+
+/**
+ * @brief Hold burst mode for a transfer (e.g. history) until link_policy_burst_end().
+ */
+void link_policy_burst_begin(void);
+void link_policy_burst_end(void);
+
+/**
+ * @brief Time spent in @p mode since boot, in milliseconds.
+ */
+int64_t link_policy_time_in_mode(enum link_mode mode);
+
+#endif // LINK_POLICY_H
@@ -0,0 +1,166 @@
+#include "radio_sched.h"
+#include "sensor_scanner.h"
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(radio_sched, CONFIG_RADIO_SCHED_LOG_LEVEL);
+
+BUILD_ASSERT(CONFIG_RADIO_SCHED_IDLE_WINDOW_MS <= CONFIG_RADIO_SCHED_IDLE_INTERVAL_MS,
+             "Scan window longer than the scan interval");
+
+// Connection intervals are in 1.25 ms units, scan timing in 0.625 ms units
+#define CONN_UNIT_US        1250U
+#define SCAN_UNIT_US        625U
+#define SCAN_UNITS_MIN      0x0004
+#define SCAN_UNITS_MAX      0x4000
+
+struct scan_plan {
+    uint32_t interval_us;
+    uint32_t window_us;
+    uint32_t reserved_us;   // Connection events per scan interval
+    uint32_t overlap_us;    // Part of the window that cannot fit beside the reserved time
+};
+
+// Interval of every central link, indexed by bt_conn_index(), 0 when unused
+static uint16_t conn_interval[CONFIG_BT_MAX_CONN];
+
+static struct scan_plan plan = {
+    .interval_us = CONFIG_RADIO_SCHED_IDLE_INTERVAL_MS * USEC_PER_MSEC,
+    .window_us = CONFIG_RADIO_SCHED_IDLE_WINDOW_MS * USEC_PER_MSEC,
+};
+static int64_t plan_since;
+
+static struct k_spinlock stats_lock;
+static uint64_t scan_us, yielded_us, planned_overlap_us;
+static uint32_t replans;
+static uint32_t adverts_logged;
+
+static void plan_work_handler(struct k_work *work);
+static void stats_work_handler(struct k_work *work);
+static K_WORK_DEFINE(plan_work, plan_work_handler);
+static K_WORK_DELAYABLE_DEFINE(stats_work, stats_work_handler);
+
+// Credit the time spent on the current plan to the counters, stats_lock held
+static void account_plan_time(void) {
+    int64_t now = k_uptime_get();
+    uint64_t elapsed_us = (uint64_t)(now - plan_since) * USEC_PER_MSEC;
+
+    scan_us += elapsed_us * plan.window_us / plan.interval_us;
+    yielded_us += elapsed_us * plan.reserved_us / plan.interval_us;
+    planned_overlap_us += elapsed_us * plan.overlap_us / plan.interval_us;
+    plan_since = now;
+}
+
+// Scan interval on the shortest connection interval, so every scan interval
+// holds about one event per link, and the window in the rest. The controller
+// places the window against the connection anchors, the plan only sizes it.
+static void plan_compute(struct scan_plan *next) {
+    uint16_t shortest = UINT16_MAX;
+    uint32_t links = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(conn_interval); i++) {
+        if (conn_interval[i]) {
+            shortest = MIN(shortest, conn_interval[i]);
+            links++;
+        }
+    }
+
+    if (links == 0) {
+        next->interval_us = CONFIG_RADIO_SCHED_IDLE_INTERVAL_MS * USEC_PER_MSEC;
+        next->window_us = CONFIG_RADIO_SCHED_IDLE_WINDOW_MS * USEC_PER_MSEC;
+        next->reserved_us = 0;
+        next->overlap_us = 0;
+        return;
+    }
+
+    // Slower links still get a slot in every interval, a safe upper bound
+    uint32_t interval_us = CLAMP(shortest * CONN_UNIT_US,
+                                 SCAN_UNITS_MIN * SCAN_UNIT_US, SCAN_UNITS_MAX * SCAN_UNIT_US);
+    uint32_t reserved_us = MIN(links * CONFIG_RADIO_SCHED_CONN_EVENT_US, interval_us);
+    uint32_t share_us = interval_us / 100 * CONFIG_RADIO_SCHED_SCAN_SHARE_PCT;
+    uint32_t window_us = MAX(interval_us - reserved_us, share_us);
+
+    window_us = MAX(window_us, SCAN_UNITS_MIN * SCAN_UNIT_US);
+
+    next->interval_us = interval_us;
+    next->window_us = window_us;
+    next->reserved_us = reserved_us;
+    next->overlap_us = (window_us + reserved_us > interval_us) ?
+                       window_us + reserved_us - interval_us : 0;
+}
+
+// Runs on the system work queue
+static void plan_work_handler(struct k_work *work) {
+    struct scan_plan next;
+
+    plan_compute(&next);
+    if (next.interval_us == plan.interval_us && next.window_us == plan.window_us &&
+        next.reserved_us == plan.reserved_us) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    account_plan_time();
+    plan = next;
+    replans++;
+    k_spin_unlock(&stats_lock, key);
+
+    int err = sensor_scanner_set_window(plan.interval_us / SCAN_UNIT_US, plan.window_us / SCAN_UNIT_US);
+    if (err) {
+        LOG_WRN("Scan timing not applied (err %d)", err);
+    }
+
+    LOG_INF("Scan %u/%u us, %u us for connections, %u us overlap",
+            plan.window_us, plan.interval_us, plan.reserved_us, plan.overlap_us);
+}
+
+static void stats_work_handler(struct k_work *work) {
+    struct radio_sched_stats stats;
+
+    radio_sched_stats_get(&stats);
+
+    LOG_INF("Planned scan %llu ms | yielded %llu ms | overlap %llu ms | %u replans | %u adverts",
+            stats.scan_ms, stats.yielded_ms, stats.planned_overlap_ms, stats.replans,
+            stats.adverts - adverts_logged);
+    adverts_logged = stats.adverts;
+
+    k_work_reschedule(&stats_work, K_SECONDS(CONFIG_RADIO_SCHED_STATS_INTERVAL_S));
+}
+
+void radio_sched_conn_update(struct bt_conn *conn, uint16_t interval) {
+    conn_interval[bt_conn_index(conn)] = interval;
+    k_work_submit(&plan_work);
+}
+
+void radio_sched_conn_removed(struct bt_conn *conn) {
+    conn_interval[bt_conn_index(conn)] = 0;
+    k_work_submit(&plan_work);
+}
+
+void radio_sched_stats_get(struct radio_sched_stats *stats) {
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    account_plan_time();
+    stats->scan_ms = scan_us / USEC_PER_MSEC;
+    stats->yielded_ms = yielded_us / USEC_PER_MSEC;
+    stats->planned_overlap_ms = planned_overlap_us / USEC_PER_MSEC;
+    stats->replans = replans;
+    k_spin_unlock(&stats_lock, key);
+
+    stats->adverts = sensor_scanner_adv_count();
+}
+
+static int radio_sched_init(void) {
+    plan_since = k_uptime_get();
+
+    // Idle timing before the scanner starts, it picks it up in scan_init()
+    sensor_scanner_set_window(plan.interval_us / SCAN_UNIT_US, plan.window_us / SCAN_UNIT_US);
+
+    if (CONFIG_RADIO_SCHED_STATS_INTERVAL_S > 0) {
+        k_work_reschedule(&stats_work, K_SECONDS(CONFIG_RADIO_SCHED_STATS_INTERVAL_S));
+    }
+    return 0;
+}
+
+SYS_INIT(radio_sched_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
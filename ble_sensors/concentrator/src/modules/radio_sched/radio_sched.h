@@ -0,0 +1,26 @@
+#ifndef RADIO_SCHED_H
+#define RADIO_SCHED_H
+
+#include <zephyr/bluetooth/conn.h>
+
+struct radio_sched_stats {
+    uint64_t scan_ms;       // Time the scan windows were planned for
+    uint64_t yielded_ms;    // Scan time given up to connection events
+    uint64_t planned_overlap_ms;    // Window planned over connection events by the scan share
+    uint32_t replans;       // Scan timing changes
+    uint32_t adverts;       // Matching advertisements received
+};
+
+// Connection callbacks, called by concentrator_periph
+void radio_sched_conn_update(struct bt_conn *conn, uint16_t interval);
+void radio_sched_conn_removed(struct bt_conn *conn);
+
+/**
+ * @brief Copy the scan time counters, accumulated since boot.
+ *
+ * The controller does not report preempted scan windows, so every counter
+ * follows from the scan plan, not from measured radio time.
+ */
+void radio_sched_stats_get(struct radio_sched_stats *stats);
+
+#endif // RADIO_SCHED_H
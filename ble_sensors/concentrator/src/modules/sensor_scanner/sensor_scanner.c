@@ -4,26 +4,35 @@
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/hci.h>
 #include <bluetooth/scan.h>
+#ifdef CONFIG_SENSOR_AUTH
+#include "sensor_auth.h"
+#endif // CONFIG_SENSOR_AUTH
 
 LOG_MODULE_REGISTER(sensor_scanner, CONFIG_SENSOR_SCANNER_LOG_LEVEL);
 
 static sensor_packet_handler_t sensor_handler = NULL;
 
-// Remove duplicate packets based on MAC address and timestamp
+// Matching advertisements received, read by the radio scheduler
+static atomic_t adv_count;
+
+// Remove duplicate packets based on MAC address, sensor type and timestamp.
+// A composite advertisement carries several types under one timestamp.
 typedef struct {
     bt_addr_le_t addr;
+    uint8_t type;
     uint32_t last_sensor_timestamp;
 } sensor_record_t;
 
-#define MAX_SENSOR_RECORDS 10
+#define MAX_SENSOR_RECORDS 20
 static sensor_record_t sensor_records[MAX_SENSOR_RECORDS];
 static int sensor_records_count = 0;
 
 int sensor_scanner_is_new_data(const sensor_packet_t *pkt)
 {
-    // Check if a record for this MAC already exists.
+    // Check if a record for this MAC and type already exists.
     for (int i = 0; i < sensor_records_count; i++) {
-        if (bt_addr_le_cmp(&sensor_records[i].addr, &pkt->addr) == 0) {
+        if (bt_addr_le_cmp(&sensor_records[i].addr, &pkt->addr) == 0 &&
+            sensor_records[i].type == pkt->sensor_data.type) {
             // If the timestamp is the same, it's a duplicate.
             if (sensor_records[i].last_sensor_timestamp == pkt->sensor_data.timestamp) {
                 return 0;
@@ -33,9 +42,10 @@ int sensor_scanner_is_new_data(const sensor_packet_t *pkt)
             return 1;
         }
     }
-    // If this MAC address hasn't been seen before, add a new record.
+    // If this MAC address and type haven't been seen before, add a new record.
     if (sensor_records_count < MAX_SENSOR_RECORDS) {
         bt_addr_le_copy(&sensor_records[sensor_records_count].addr, &pkt->addr);
+        sensor_records[sensor_records_count].type = pkt->sensor_data.type;
         sensor_records[sensor_records_count].last_sensor_timestamp = pkt->sensor_data.timestamp;
         sensor_records_count++;
         return 1;
@@ -110,6 +120,15 @@ void sensor_packet_print(const sensor_packet_t *pkt)
                 pkt->sensor_data.values[1] ? "STANDING" : "NON_STANDING");
         break;
 
+    case SENSOR_TYPE_ACTIVITY:
+        snprintf(sensor_info, sizeof(sensor_info),
+                "Activity: %s | Steps: %u | Cadence: %d spm | Posture: %s",
+                activity_state_str(pkt->sensor_data.values[0]),
+                (uint16_t)pkt->sensor_data.values[1],
+                pkt->sensor_data.values[2],
+                pkt->sensor_data.values[3] ? "STANDING" : "NON_STANDING");
+        break;
+
     default:
         snprintf(sensor_info, sizeof(sensor_info), "Unknown sensor type");
         break;
@@ -117,14 +136,23 @@ void sensor_packet_print(const sensor_packet_t *pkt)
 
     LOG_INF("%s | %u | %s", addr_str, pkt->timestamp, sensor_info);
 }
+// Raw manufacturer data of one advertisement
+struct mfg_payload {
+    uint8_t data[SENSOR_ADV_EXT_MAX_LEN];
+    uint8_t len;
+};
+
 static bool parse_adv_data(struct bt_data *data, void *user_data)
 {
-    sensor_packet_t *parsed = (sensor_packet_t *)user_data;
-    if (data->type == BT_DATA_MANUFACTURER_DATA && data->data_len >= 8) {
+    struct mfg_payload *payload = (struct mfg_payload *)user_data;
+    if (data->type == BT_DATA_MANUFACTURER_DATA && data->data_len >= SENSOR_DATA_HEADER_LEN) {
         uint16_t company_id = data->data[0] | (data->data[1] << 8);
         if (company_id != COMPANY_ID) return true;
 
-        memcpy(&parsed->sensor_data, data->data, sizeof(sensor_data_t));
+        // Short frames only carry the values of their type
+        payload->len = MIN(data->data_len, sizeof(payload->data));
+        memcpy(payload->data, data->data, payload->len);
+        return false;
     }
     return true;
 }
@@ -134,13 +162,49 @@ static void scan_filter_match(struct bt_scan_device_info *info,
 {
     if (!sensor_handler || !match->manufacturer_data.match) return;
 
+    atomic_inc(&adv_count);
+
+    struct mfg_payload payload = {0};
+    bt_data_parse(info->adv_data, parse_adv_data, &payload);
+    if (payload.len == 0) return;
+
+#ifdef CONFIG_SENSOR_AUTH_VERIFY
+    if (payload.data[2] == SENSOR_TYPE_SECURE) {
+        // Verified in place: the plain frame is never longer than the sealed one
+        int len = sensor_auth_open(payload.data, payload.len, payload.data, sizeof(payload.data));
+        if (len < 0) {
+            return;     // Repeat, replay or forgery, logged by sensor_auth
+        }
+        payload.len = len;
+    } else if (IS_ENABLED(CONFIG_SENSOR_AUTH_REQUIRED)) {
+        return;
+    }
+#else
+    if (payload.data[2] == SENSOR_TYPE_SECURE) return;
+#endif // CONFIG_SENSOR_AUTH_VERIFY
+
     sensor_packet_t parsed = {0};
     bt_addr_le_copy(&parsed.addr, info->recv_info->addr);
     parsed.timestamp = k_uptime_get();
 
-    bt_data_parse(info->adv_data, parse_adv_data, &parsed);
+    if (payload.data[2] != SENSOR_TYPE_COMPOSITE) {
+        memcpy(&parsed.sensor_data, payload.data, MIN(payload.len, sizeof(sensor_data_t)));
+        if (parsed.sensor_data.type != SENSOR_TYPE_ERROR) {
+            sensor_handler(&parsed);
+        }
+        return;
+    }
+
+    // Hand every reading of a composite payload over as its own packet
+    sensor_data_t readings[SENSOR_COMPOSITE_MAX_READINGS];
+    int count = sensor_composite_decode(payload.data, payload.len, readings, ARRAY_SIZE(readings));
+    if (count < 0) {
+        LOG_WRN("Malformed composite payload");
+        return;
+    }
 
-    if (parsed.sensor_data.type != SENSOR_TYPE_ERROR) {
+    for (int i = 0; i < count; i++) {
+        parsed.sensor_data = readings[i];
         sensor_handler(&parsed);
     }
 }
@@ -182,6 +246,41 @@ static struct bt_le_scan_param scan_param = {
     .window = BT_GAP_SCAN_FAST_WINDOW,
 };
 
+static bool scan_ready;
+
+uint32_t sensor_scanner_adv_count(void) {
+    return (uint32_t)atomic_get(&adv_count);
+}
+
+int sensor_scanner_set_window(uint16_t interval, uint16_t window) {
+    if (interval == scan_param.interval && window == scan_param.window) {
+        return 0;
+    }
+
+    scan_param.interval = interval;
+    scan_param.window = window;
+    if (!scan_ready) {
+        return 0;   // Picked up by scan_init()
+    }
+
+    // Stops scanning, restarted below with the new timing
+    int err = bt_scan_params_set(&scan_param);
+    if (err) {
+        LOG_ERR("Failed to set scan parameters (err %d)", err);
+        return err;
+    }
+
+    if (!scanning_state) {
+        return 0;
+    }
+
+    err = bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE);
+    if (err) {
+        LOG_ERR("Failed to restart scanning (err %d)", err);
+    }
+    return err;
+}
+
 static int scan_init(void)
 {
     struct bt_scan_init_param init = {
@@ -190,6 +289,7 @@ static int scan_init(void)
     };
     bt_scan_init(&init);
     bt_scan_cb_register(&scan_cb);
+    scan_ready = true;
 
     uint8_t filter[] = { COMPANY_ID & 0xFF, COMPANY_ID >> 8 };
     struct bt_scan_manufacturer_data mdata = {
@@ -207,6 +307,12 @@ int sensor_scanner_init(sensor_packet_handler_t handler)
     sensor_handler = handler;
 
     LOG_INF("Bluetooth initialized");
+#ifdef CONFIG_SENSOR_AUTH_VERIFY
+    int auth_err = sensor_auth_init();
+    if (auth_err) {
+        LOG_ERR("Sensor auth init failed (err %d), sealed payloads dropped", auth_err);
+    }
+#endif // CONFIG_SENSOR_AUTH_VERIFY
     int err = scan_init();
     if (err) return err;
 
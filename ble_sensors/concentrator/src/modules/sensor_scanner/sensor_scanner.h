@@ -22,4 +22,14 @@ int sensor_scanner_is_new_data(const sensor_packet_t *pkt);
 int sensor_scanner_stop(void);
 int sensor_scanner_start(void);
 
+/**
+ * @brief Change the scan interval and window (0.625 ms units), restarting an active scan.
+ */
+int sensor_scanner_set_window(uint16_t interval, uint16_t window);
+
+/**
+ * @brief Matching advertisements received since boot.
+ */
+uint32_t sensor_scanner_adv_count(void);
+
 #endif // SENSOR_SCANNER_H
@@ -1,5 +1,6 @@
 #include "worker_shadow_service.h"
 #include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
 
@@ -8,13 +9,16 @@ LOG_MODULE_REGISTER(worker_shadow_service, CONFIG_WORKER_SHADOW_SERVICE_LOG_LEVE
 // Global variable for the read characteristic "Worker Shadow".
 static concentrator_shadow_t worker_shadow_var;
 
-// Global flag for Worker Shadow notifications.
-bool worker_shadow_notify_enabled;
+// Notification state of each central, indexed by bt_conn_index()
+static struct {
+    atomic_t in_flight;     // Notifications queued in the host, not yet sent
+    uint32_t dropped;       // Notifications skipped because the queue was full
+} centrals[CONFIG_BT_MAX_CONN];
 
 static void worker_shadow_ccc_change(const struct bt_gatt_attr *attr, uint16_t value)
 {
-    worker_shadow_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
-    LOG_INF("Worker Shadow notifications %s", worker_shadow_notify_enabled ? "enabled" : "disabled");
+    // Subscriptions are kept per connection by the CCC, value is the aggregate
+    LOG_INF("Worker Shadow notifications %s", value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
 }
 
 static ssize_t on_worker_shadow_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
@@ -32,16 +36,89 @@ BT_GATT_SERVICE_DEFINE(worker_shadow_service_svc,
     BT_GATT_CCC(worker_shadow_ccc_change, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
 );
 
-/* Send notification for worker_shadow characteristic */
+void worker_shadow_service_connected(struct bt_conn *conn)
+{
+    uint8_t index = bt_conn_index(conn);
+
+    atomic_set(&centrals[index].in_flight, 0);
+    centrals[index].dropped = 0;
+}
+
+void worker_shadow_service_disconnected(struct bt_conn *conn)
+{
+    uint8_t index = bt_conn_index(conn);
+
+    if (centrals[index].dropped) {
+        LOG_WRN("Central %u: %u notifications dropped", index, centrals[index].dropped);
+    }
+}
+
+static void notify_sent(struct bt_conn *conn, void *user_data)
+{
+    atomic_t *in_flight = &centrals[bt_conn_index(conn)].in_flight;
+
+    if (atomic_dec(in_flight) <= 0) {
+        atomic_set(in_flight, 0);
+    }
+}
+
+struct notify_ctx {
+    const concentrator_shadow_t *shadow;
+    int sent;
+    int err;
+};
+
+// One central: a slow one only loses its own notifications, never blocks the others
+static void notify_central(struct bt_conn *conn, void *data)
+{
+    struct notify_ctx *ctx = data;
+    const struct bt_gatt_attr *attr = &worker_shadow_service_svc.attrs[2];
+    struct bt_conn_info info;
+    uint8_t index = bt_conn_index(conn);
+    int err;
+
+    if (bt_conn_get_info(conn, &info) || info.role != BT_CONN_ROLE_PERIPHERAL ||
+        !bt_gatt_is_subscribed(conn, attr, BT_GATT_CCC_NOTIFY)) {
+        return;
+    }
+
+    if (atomic_get(&centrals[index].in_flight) >= CONFIG_WORKER_SHADOW_SERVICE_QUEUE_DEPTH) {
+        centrals[index].dropped++;
+        ctx->err = -ENOBUFS;
+        return;
+    }
+
+    struct bt_gatt_notify_params params = {
+        .attr = attr,
+        .data = ctx->shadow,
+        .len = sizeof(*ctx->shadow),
+        .func = notify_sent,
+    };
+
+    atomic_inc(&centrals[index].in_flight);
+    err = bt_gatt_notify_cb(conn, &params);
+    if (err) {
+        atomic_dec(&centrals[index].in_flight);
+        ctx->err = err;
+        return;
+    }
+    ctx->sent++;
+}
+
+/* Send notification for worker_shadow characteristic to every subscribed central */
 int send_worker_shadow_notification(concentrator_shadow_t worker_shadow)
 {
+    struct notify_ctx ctx = {
+        .shadow = &worker_shadow_var,
+    };
+
     worker_shadow_var = worker_shadow;
-    if (!worker_shadow_notify_enabled) {
-        return -EACCES;
+    bt_conn_foreach(BT_CONN_TYPE_LE, notify_central, &ctx);
+
+    if (ctx.sent > 0) {
+        return 0;
     }
-    /* The value attribute is assumed to be at index 2 in the service structure. */
-    return bt_gatt_notify(NULL, &worker_shadow_service_svc.attrs[2],
-                            &worker_shadow_var, sizeof(worker_shadow_var));
+    return ctx.err ? ctx.err : -EACCES;
 }
 
 
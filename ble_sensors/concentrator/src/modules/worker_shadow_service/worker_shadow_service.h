@@ -12,7 +12,9 @@ typedef struct {
     uint8_t fix_type;
     uint8_t movement;
     uint8_t posture;
+    uint8_t activity;       // activity_state_t, fills the former padding byte
     int16_t light;
+    uint16_t steps;         // Fills the former tail padding, size stays 24 bytes
 } concentrator_shadow_t;
 
 // Service UUID
@@ -22,6 +24,17 @@ typedef struct {
 #define WORKER_SHADOW_CHAR_UUID BT_UUID_128_ENCODE(0x485ec8f4, 0xc56c, 0x4534, 0x9ba3, 0xd850bf804877)
 
 int worker_shadow_service_init(void);
+
+/**
+ * @brief Notify every subscribed central.
+ *
+ * @return 0 if at least one central was notified, -EACCES if none is subscribed,
+ *         otherwise the error of the last central that could not be notified.
+ */
 int send_worker_shadow_notification(concentrator_shadow_t worker_shadow);
 
+// Connection callbacks, called by concentrator_periph
+void worker_shadow_service_connected(struct bt_conn *conn);
+void worker_shadow_service_disconnected(struct bt_conn *conn);
+
 #endif /* WORKER_SHADOW_SERVICE_H */
\ No newline at end of file
@@ -1,11 +1,24 @@
 #include <zephyr/kernel.h>
+#include <zephyr/sys/barrier.h>
 #include "gateway_ble.h"
 #include "gateway_lte.h"
 #include "bt_simple_service_client.h"
+#include "json_writer.h"
+#ifdef CONFIG_SHADOW_FRAME
+#include "shadow_frame.h"
+#endif // CONFIG_SHADOW_FRAME
+#ifdef CONFIG_SHADOW_BATCH
+#include "shadow_batch.h"
+#endif // CONFIG_SHADOW_BATCH
+#ifdef CONFIG_STORE_FORWARD
+#include "store_forward.h"
+#endif // CONFIG_STORE_FORWARD
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
 #include <net/aws_iot.h>
 #include <string.h>
 #include <stdio.h>
+#include <cJSON.h>
 
 
 #include <zephyr/sys/reboot.h>
@@ -29,101 +42,552 @@ LOG_MODULE_REGISTER(gateway_main, LOG_LEVEL_INF);
 #define MY_CUSTOM_TOPIC_1 "dk/led0"
 #define MY_CUSTOM_TOPIC_2 "my-custom-topic/example_2"
 
-/* Variável global para armazenar o shadow atual e mutex para proteção */
-static concentrator_shadow_t current_shadow;
+/* Um shadow por concentrador, identificado pelo endereço, e mutex para proteção */
+struct shadow_slot {
+    bt_addr_le_t addr;
+    bool used;
+    concentrator_shadow_t shadow;
+    int64_t received_at;    // Chegada do último shadow
+    uint32_t updates;       // Shadows recebidos desde a última publicação
+};
+
+/* Custo de cada modo BLE visto do lado da publicação */
+static struct {
+    uint32_t published;     // Shadows enviados ao AWS IoT
+    uint32_t superseded;    // Shadows substituídos antes de serem enviados
+    uint64_t age_total_ms;  // Idade do shadow ao ser enviado, soma para a média
+    uint64_t bytes;         // Bytes de payload enviados pelo LTE
+    uint32_t batched;       // Shadows enviados em lotes, com o horário de cada um
+    uint32_t batches;
+} publish_stats;
+
+/* Conectado ao AWS IoT, senão os lotes esperam o próximo ciclo */
+static atomic_t aws_connected;
+
+/* O que vai no payload, guardado junto no store_forward para o tópico certo */
+enum payload_kind {
+    PAYLOAD_SHADOW_JSON,    // AWS_IOT_SHADOW_TOPIC_UPDATE
+    PAYLOAD_FRAME,          // CONFIG_SHADOW_FRAME_TOPIC, último shadow de cada concentrador
+    PAYLOAD_BATCH,          // CONFIG_SHADOW_FRAME_TOPIC, lote com a idade de cada shadow
+};
+
+/* Ciclos de publicação desde a conexão, para a cadência do JSON */
+static uint32_t publish_cycle;
+
+/* Em polling, o ciclo lê os concentradores antes de publicar */
+static bool poll_complete;
+
+static struct shadow_slot shadows[CONFIG_GATEWAY_BLE_MAX_CONCENTRATORS];
 static struct k_mutex shadow_mutex;
 
 /* Declarações antecipadas */
 static void shadow_update_work_fn(struct k_work *work);
+static void shadow_rx_work_fn(struct k_work *work);
 static void connect_work_fn(struct k_work *work);
 static void aws_iot_event_handler(const struct aws_iot_evt *const evt);
 static void print_shadow(const concentrator_shadow_t *shadow);
 
 /* Work items */
 static K_WORK_DELAYABLE_DEFINE(shadow_update_work, shadow_update_work_fn);
+static K_WORK_DEFINE(shadow_rx_work, shadow_rx_work_fn);
+#ifdef CONFIG_SHADOW_BATCH
+static void batch_flush_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(batch_flush_work, batch_flush_work_fn);
+static void batch_added(size_t count);
+#endif // CONFIG_SHADOW_BATCH
+#ifdef CONFIG_STORE_FORWARD
+static void drain_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(drain_work, drain_work_fn);
+#endif // CONFIG_STORE_FORWARD
+
+/* Workqueue do gateway: shadows recebidos e publicação, longe da thread BT RX */
+static K_THREAD_STACK_DEFINE(gateway_workq_stack, CONFIG_GATEWAY_WORKQ_STACK_SIZE);
+static struct k_work_q gateway_workq;
 static K_WORK_DELAYABLE_DEFINE(connect_work, connect_work_fn);
 
 /* Hardware ID */
 static char hw_id[HW_ID_LEN];
 
-/* Função que atualiza o shadow ao receber uma notificação BLE */
+/* Slot do concentrador, criado na primeira notificação. Chamar com shadow_mutex. */
+static struct shadow_slot *shadow_slot_get(const bt_addr_le_t *addr)
+{
+    struct shadow_slot *free_slot = NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(shadows); i++) {
+        if (!shadows[i].used) {
+            free_slot = free_slot ? free_slot : &shadows[i];
+        } else if (bt_addr_le_cmp(&shadows[i].addr, addr) == 0) {
+            return &shadows[i];
+        }
+    }
+
+    if (free_slot) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        bt_addr_le_copy(&free_slot->addr, addr);
+        free_slot->used = true;
+    }
+    return free_slot;
+}
+
+/* Passa o shadow da thread BT RX para a workqueue do gateway sem bloquear:
+ * um slot por link com seqlock, o callback só copia e o leitor repete se
+ * o slot mudou durante a cópia. */
+struct shadow_inbox {
+    atomic_t seq;               // Ímpar enquanto o callback escreve
+    atomic_t overwritten;       // Shadows substituídos antes de serem processados
+    bt_addr_le_t addr;
+    concentrator_shadow_t shadow;
+    int64_t received_at;
+};
+
+static struct shadow_inbox inbox[CONFIG_BT_MAX_CONN];
+static ATOMIC_DEFINE(inbox_pending, CONFIG_BT_MAX_CONN);
+
+/* Recebe o shadow de um concentrador, na thread BT RX (notificação ou leitura) */
 uint8_t concentrator_data_handler(struct bt_simple_service *simple_service,
     const uint8_t *data, uint16_t length)
 {
-	LOG_DBG("Dados recebidos do cliente: %u bytes", length);
-    if (length != sizeof(concentrator_shadow_t)) {
-        LOG_ERR("Tamanho dos dados recebidos (%u) incompatível", length);
+    const bt_addr_le_t *addr = gateway_ble_peer_addr(simple_service);
+    concentrator_shadow_t shadow;
+    struct shadow_inbox *box;
+    int64_t received_at;
+    uint8_t index;
+
+    if (length != sizeof(concentrator_shadow_t) || !addr) {
         return BT_GATT_ITER_CONTINUE;
     }
 
-    /* Atualiza o current_shadow com proteção do mutex */
-    k_mutex_lock(&shadow_mutex, K_FOREVER);
-    memcpy(&current_shadow, data, sizeof(concentrator_shadow_t));
-    k_mutex_unlock(&shadow_mutex);
-
-    LOG_DBG("Shadow atualizado via notificação BLE");
-    print_shadow(&current_shadow);
+    memcpy(&shadow, data, sizeof(shadow));
+    received_at = k_uptime_get();
+
+#ifdef CONFIG_SHADOW_BATCH
+    /* Todo shadow entra no lote já aqui: o inbox guarda só o último de cada
+     * link, e a workqueue pode estar presa no aws_iot_send() por segundos */
+    batch_added(shadow_batch_add(addr, &shadow, received_at));
+#endif // CONFIG_SHADOW_BATCH
+
+    index = bt_conn_index(simple_service->conn);
+    box = &inbox[index];
+
+    /* Escritor único por link: a thread BT RX */
+    atomic_inc(&box->seq);
+    barrier_dmem_fence_full();
+    bt_addr_le_copy(&box->addr, addr);
+    box->shadow = shadow;
+    box->received_at = received_at;
+    barrier_dmem_fence_full();
+    atomic_inc(&box->seq);
+
+    if (atomic_test_and_set_bit(inbox_pending, index)) {
+        atomic_inc(&box->overwritten);
+    }
+    k_work_submit_to_queue(&gateway_workq, &shadow_rx_work);
 
     return BT_GATT_ITER_CONTINUE;
 }
 
-/* Função que prepara o JSON com base no shadow atual e envia via AWS IoT */
-static void shadow_update_work_fn(struct k_work *work)
+/* Copia um slot do inbox, repetindo se o callback escreveu durante a cópia */
+static void inbox_read(struct shadow_inbox *box, bt_addr_le_t *addr,
+    concentrator_shadow_t *shadow, int64_t *received_at)
+{
+    atomic_val_t seq;
+
+    do {
+        seq = atomic_get(&box->seq);
+        if (seq & 1) {
+            k_yield();
+            continue;
+        }
+        barrier_dmem_fence_full();
+        bt_addr_le_copy(addr, &box->addr);
+        *shadow = box->shadow;
+        *received_at = box->received_at;
+        barrier_dmem_fence_full();
+    } while ((seq & 1) || atomic_get(&box->seq) != seq);
+}
+
+/* Atualiza os shadows dos concentradores e mostra os dados, fora da thread BT RX */
+static void shadow_rx_work_fn(struct k_work *work)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(inbox); i++) {
+        struct shadow_slot *slot;
+        concentrator_shadow_t shadow;
+        bt_addr_le_t addr;
+        int64_t received_at;
+
+        if (!atomic_test_and_clear_bit(inbox_pending, i)) {
+            continue;
+        }
+        inbox_read(&inbox[i], &addr, &shadow, &received_at);
+
+        /* Atualiza o shadow do concentrador com proteção do mutex */
+        k_mutex_lock(&shadow_mutex, K_FOREVER);
+        slot = shadow_slot_get(&addr);
+        if (slot) {
+            slot->shadow = shadow;
+            slot->received_at = received_at;
+            slot->updates += 1 + atomic_clear(&inbox[i].overwritten);
+        }
+        k_mutex_unlock(&shadow_mutex);
+
+        if (!slot) {
+            LOG_ERR("Sem slot livre para o concentrador, aumente CONFIG_GATEWAY_BLE_MAX_CONCENTRATORS");
+            continue;
+        }
+
+        LOG_DBG("Shadow atualizado via BLE");
+        print_shadow(&shadow);
+    }
+}
+
+/* Envia um payload ao AWS IoT no tópico do seu tipo. Com message_id,
+ * vai com QoS 1 e o AWS_IOT_EVT_PUBACK traz o mesmo id. */
+static int payload_send(uint8_t kind, const uint8_t *data, size_t len, uint16_t message_id)
 {
-    int err;
-    char message[CONFIG_AWS_IOT_SAMPLE_JSON_MESSAGE_SIZE_MAX] = { 0 };
     struct aws_iot_data tx_data = {
-        .qos = MQTT_QOS_0_AT_MOST_ONCE,
+        .qos = message_id ? MQTT_QOS_1_AT_LEAST_ONCE : MQTT_QOS_0_AT_MOST_ONCE,
+        .message_id = message_id,
         .topic.type = AWS_IOT_SHADOW_TOPIC_UPDATE,
+        .ptr = (char *)data,
+        .len = len,
     };
+    int err;
 
-    concentrator_shadow_t s_copy;
-    /* Cria uma cópia dos dados atuais com proteção do mutex */
-    k_mutex_lock(&shadow_mutex, K_FOREVER);
-    s_copy = current_shadow;
-    k_mutex_unlock(&shadow_mutex);
+#ifdef CONFIG_SHADOW_FRAME
+    if (kind == PAYLOAD_FRAME || kind == PAYLOAD_BATCH) {
+        tx_data.topic.type = AWS_IOT_SHADOW_TOPIC_NONE;
+        tx_data.topic.str = CONFIG_SHADOW_FRAME_TOPIC;
+        tx_data.topic.len = sizeof(CONFIG_SHADOW_FRAME_TOPIC) - 1;
+    }
+#endif // CONFIG_SHADOW_FRAME
+
+    err = aws_iot_send(&tx_data);
+    if (!err) {
+        publish_stats.bytes += len;
+    }
+    return err;
+}
+
+/* Publica, ou guarda na flash enquanto o AWS IoT não está acessível.
+ * Só os lotes vão para a flash: o JSON e o snapshot são o último estado,
+ * e repetidos depois da reconexão sobrescreveriam o estado atual. */
+static int payload_publish(enum payload_kind kind, const uint8_t *data, size_t len)
+{
+    int err = -ENOTCONN;
 
+    if (atomic_get(&aws_connected)) {
+        err = payload_send(kind, data, len, 0);
+    }
+
+#ifdef CONFIG_STORE_FORWARD
+    /* Guardado depois de uma falha com a conexão de pé: sem reconexão,
+     * só um envio que deu certo faz a fila andar */
+    if (!err && store_forward_depth() > 0) {
+        (void)k_work_schedule_for_queue(&gateway_workq, &drain_work,
+                                        K_MSEC(CONFIG_STORE_FORWARD_DRAIN_INTERVAL_MS));
+    }
+    if (err && kind == PAYLOAD_BATCH) {
+        int store_err = store_forward_push(kind, data, len);
+
+        if (store_err) {
+            LOG_ERR("Payload perdido, store_forward falhou: %d", store_err);
+            return err;
+        }
+        LOG_INF("Envio falhou (%d), payload guardado, %zu na fila", err, store_forward_depth());
+        return 0;
+    }
+#endif // CONFIG_STORE_FORWARD
+    return err;
+}
+
+/* Envia o shadow de um concentrador, aninhado sob o seu endereço no shadow do gateway.
+ * Os campos em ponto fixo saem direto dos inteiros do shadow, sem printf de float. */
+static int shadow_publish(const bt_addr_le_t *addr, const concentrator_shadow_t *shadow)
+{
+    /* Só a workqueue do gateway publica, o buffer é reaproveitado */
+    static char message[CONFIG_AWS_IOT_SAMPLE_JSON_MESSAGE_SIZE_MAX];
+    char addr_str[BT_ADDR_STR_LEN];
+    struct json_writer json;
+    int len;
+
+    bt_addr_to_str(&addr->a, addr_str, sizeof(addr_str));
+
+    json_writer_init(&json, message, sizeof(message));
+    json_writer_object_begin(&json, NULL);
+    json_writer_object_begin(&json, "state");
+    json_writer_object_begin(&json, "reported");
+    json_writer_int(&json, "uptime", k_uptime_get());
+    json_writer_string(&json, "app_version", CONFIG_AWS_IOT_SAMPLE_APP_VERSION);
+    json_writer_string(&json, "ble_mode",
+        gateway_ble_mode_get() == GATEWAY_BLE_MODE_POLL ? "poll" : "notify");
+    json_writer_object_begin(&json, "concentrators");
+    json_writer_object_begin(&json, addr_str);
+    json_writer_uint(&json, "concentrator_timestamp", shadow->concentrator_timestamp);
+    json_writer_fixed(&json, "temperature", shadow->temperature, 2);
+    json_writer_fixed(&json, "pressure", shadow->pressure, 1);
+    json_writer_fixed(&json, "latitude", shadow->latitude, 7);
+    json_writer_fixed(&json, "longitude", shadow->longitude, 7);
+    json_writer_uint(&json, "fix_type", shadow->fix_type);
+    json_writer_uint(&json, "movement", shadow->movement);
+    json_writer_uint(&json, "posture", shadow->posture);
+    json_writer_uint(&json, "activity", shadow->activity);
+    json_writer_uint(&json, "steps", shadow->steps);
+    json_writer_int(&json, "light", shadow->light);
+    json_writer_object_end(&json);
+    json_writer_object_end(&json);
+    json_writer_object_end(&json);
+    json_writer_object_end(&json);
+    json_writer_object_end(&json);
+
+    len = json_writer_finish(&json);
+    if (len < 0) {
+        LOG_ERR("Mensagem maior que CONFIG_AWS_IOT_SAMPLE_JSON_MESSAGE_SIZE_MAX");
+        return len;
+    }
 
-	snprintf(message, sizeof(message),
-	"{\"state\":{\"reported\":{"
-	"\"uptime\": %lld, "
-	"\"app_version\": \"%s\", "
-	"\"concentrator_timestamp\": %u, "
-	"\"temperature\": %.2f, "
-	"\"pressure\": %.1f, "
-	"\"latitude\": %.7f, "
-	"\"longitude\": %.7f, "
-	"\"fix_type\": %u, "
-	"\"movement\": %u, "
-	"\"posture\": %u, "
-	"\"light\": %d"
-	"}}}",
-	(long long)k_uptime_get(),
-	CONFIG_AWS_IOT_SAMPLE_APP_VERSION,
-	s_copy.concentrator_timestamp,
-	s_copy.temperature / 100.0,
-	s_copy.pressure / 10.0,
-	s_copy.latitude / 1e7,
-	s_copy.longitude / 1e7,
-	s_copy.fix_type,
-	s_copy.movement,
-	s_copy.posture,
-	s_copy.light);
-
-
-
-    tx_data.ptr = message;
-    tx_data.len = strlen(message);
     LOG_INF("Enviando mensagem: %s para o AWS IoT Shadow", message);
 
-    err = aws_iot_send(&tx_data);
+    return payload_publish(PAYLOAD_SHADOW_JSON, (const uint8_t *)message, len);
+}
+
+#if defined(CONFIG_SHADOW_FRAME) && !defined(CONFIG_SHADOW_BATCH)
+/* Envia os shadows de todos os concentradores em um frame binário (scripts/shadow_frame.py) */
+static int shadow_frame_publish(const struct shadow_slot *slots, size_t count)
+{
+    static uint8_t buf[SHADOW_FRAME_LEN(CONFIG_GATEWAY_BLE_MAX_CONCENTRATORS)];
+    struct shadow_frame frame;
+    size_t added = 0;
+
+    (void)shadow_frame_begin(&frame, buf, sizeof(buf), (uint32_t)(k_uptime_get() / MSEC_PER_SEC));
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].used && shadow_frame_add(&frame, &slots[i].addr, &slots[i].shadow) == 0) {
+            added++;
+        }
+    }
+    if (added == 0) {
+        return 0;
+    }
+
+    LOG_INF("Enviando frame binário: %zu concentradores, %zu bytes", added, shadow_frame_len(&frame));
+
+    return payload_publish(PAYLOAD_FRAME, buf, shadow_frame_len(&frame));
+}
+#endif // CONFIG_SHADOW_FRAME && !CONFIG_SHADOW_BATCH
+
+#ifdef CONFIG_SHADOW_BATCH
+/* Envia todos os shadows recebidos desde o último lote, cada um com a sua idade */
+static int batch_publish(void)
+{
+    static uint8_t buf[SHADOW_FRAME_BATCH_LEN(CONFIG_SHADOW_BATCH_SIZE)];
+    uint32_t last_seq;
+    size_t taken;
+    int len;
+    int err;
+
+    len = shadow_batch_encode(buf, sizeof(buf), k_uptime_get(), &taken, &last_seq);
+    if (len < 0 || taken == 0) {
+        return len < 0 ? len : 0;
+    }
+
+    LOG_INF("Enviando lote: %zu shadows, %d bytes", taken, len);
+
+    err = payload_publish(PAYLOAD_BATCH, buf, len);
     if (err) {
-        LOG_ERR("aws_iot_send falhou, erro: %d", err);
-        //FATAL_ERROR();
+        return err;
+    }
+
+    /* Os shadows chegam na thread BT RX durante o envio, e com o lote cheio
+     * empurram para fora os mais antigos: só sai o que foi no frame */
+    shadow_batch_consume(last_seq);
+    publish_stats.batched += taken;
+    publish_stats.batches++;
+
+    /* O prazo recomeça com o primeiro shadow do próximo lote */
+    (void)k_work_cancel_delayable(&batch_flush_work);
+    batch_added(shadow_batch_count());
+    return 0;
+}
+
+/* O primeiro shadow de um lote marca o prazo; lote cheio só vai na hora
+ * com CONFIG_SHADOW_BATCH_SEND_WHEN_FULL, senão o anel descarta o mais
+ * antigo. Chamada da thread BT RX e da workqueue do gateway. */
+static void batch_added(size_t count)
+{
+    if (IS_ENABLED(CONFIG_SHADOW_BATCH_SEND_WHEN_FULL) && count >= CONFIG_SHADOW_BATCH_SIZE) {
+        (void)k_work_reschedule_for_queue(&gateway_workq, &batch_flush_work, K_NO_WAIT);
+    } else if (count > 0 && CONFIG_SHADOW_BATCH_DEADLINE_S > 0) {
+        (void)k_work_schedule_for_queue(&gateway_workq, &batch_flush_work,
+                                        K_SECONDS(CONFIG_SHADOW_BATCH_DEADLINE_S));
+    }
+}
+
+static void batch_flush_work_fn(struct k_work *work)
+{
+    int err;
+
+    /* Sem store_forward o lote espera a conexão na RAM */
+    if (!IS_ENABLED(CONFIG_STORE_FORWARD) && !atomic_get(&aws_connected)) {
         return;
     }
 
-    (void)k_work_reschedule(&shadow_update_work,
+    err = batch_publish();
+    if (err) {
+        LOG_ERR("aws_iot_send do lote falhou, erro: %d", err);
+    }
+}
+#endif // CONFIG_SHADOW_BATCH
+
+#ifdef CONFIG_STORE_FORWARD
+BUILD_ASSERT(SHADOW_FRAME_BATCH_LEN(CONFIG_SHADOW_BATCH_SIZE) <= CONFIG_STORE_FORWARD_RECORD_MAX,
+             "lote cheio não cabe num registro da flash");
+
+/* Envia um lote da fila: a idade de cada shadow passa a contar também o
+ * tempo na flash, senão o backend dataria o lote pelo fim da queda */
+static int drain_send(uint8_t kind, uint8_t *data, size_t len, int64_t age_ms,
+                      uint16_t message_id)
+{
+    if (kind != PAYLOAD_BATCH ||
+        shadow_frame_batch_restamp(data, len, (uint32_t)(k_uptime_get() / MSEC_PER_SEC), age_ms)) {
+        return -EBADMSG;
+    }
+    if (age_ms < 0) {
+        LOG_WRN("Lote de um boot anterior sem hora da rede, idades desconhecidas");
+    }
+    return payload_send(kind, data, len, message_id);
+}
+
+/* Esvazia a fila da flash aos poucos depois da reconexão, sem tomar o uplink
+ * dos ciclos de publicação. Um registro só sai da fila com o seu PUBACK. */
+static void drain_work_fn(struct k_work *work)
+{
+    int sent;
+
+    if (!atomic_get(&aws_connected) || store_forward_depth() == 0) {
+        return;
+    }
+
+    sent = store_forward_drain(drain_send);
+    if (sent < 0) {
+        LOG_WRN("Envio da fila falhou (%d), %zu na fila", sent, store_forward_depth());
+    } else if (sent > 0) {
+        LOG_INF("%d payloads da fila enviados, %zu restantes", sent, store_forward_depth());
+    }
+
+    if (store_forward_depth() > 0) {
+        (void)k_work_reschedule_for_queue(&gateway_workq, &drain_work,
+                                          K_MSEC(CONFIG_STORE_FORWARD_DRAIN_INTERVAL_MS));
+    }
+}
+#endif // CONFIG_STORE_FORWARD
+
+/* Fim das leituras do poll, publica em seguida */
+static void poll_done(size_t received)
+{
+    LOG_DBG("Poll concluído, %zu shadows lidos", received);
+    poll_complete = true;
+    (void)k_work_reschedule_for_queue(&gateway_workq, &shadow_update_work, K_NO_WAIT);
+}
+
+/* Compara os modos BLE: transferências no link contra o que foi publicado */
+static void print_transfer_stats(void)
+{
+    struct gateway_ble_transfer_stats stats;
+
+    gateway_ble_transfer_stats_get(&stats);
+
+    LOG_INF("BLE %s: %u notificações, %u leituras (%u erros, média %u ms, máx %u ms), "
+        "%u PDUs, %llu bytes",
+        gateway_ble_mode_get() == GATEWAY_BLE_MODE_POLL ? "poll" : "notify",
+        stats.notifications, stats.reads, stats.read_errors,
+        stats.reads ? (uint32_t)(stats.read_total_ms / stats.reads) : 0, stats.read_max_ms,
+        stats.att_pdus, (unsigned long long)stats.bytes);
+    LOG_INF("Publicados %u shadows, %u substituídos antes do envio, idade média %u ms, %llu bytes",
+        publish_stats.published, publish_stats.superseded,
+        publish_stats.published ? (uint32_t)(publish_stats.age_total_ms / publish_stats.published) : 0,
+        (unsigned long long)publish_stats.bytes);
+#ifdef CONFIG_SHADOW_BATCH
+    LOG_INF("Lotes: %u, com %u shadows; %u descartados com o lote cheio",
+        publish_stats.batches, publish_stats.batched, shadow_batch_dropped());
+#endif // CONFIG_SHADOW_BATCH
+#ifdef CONFIG_STORE_FORWARD
+    struct store_forward_stats store;
+
+    store_forward_stats_get(&store);
+    LOG_INF("Fila na flash: %u payloads (%u sem PUBACK), %u bytes, mais antigo %lld s; "
+        "%u guardados, %u confirmados, %u perdidos com a fila cheia, %u expirados",
+        store.depth, store.inflight, store.depth_bytes,
+        store.oldest_age_ms < 0 ? -1LL : (long long)(store.oldest_age_ms / MSEC_PER_SEC),
+        store.stored, store.drained, store.dropped_full, store.dropped_expired);
+#endif // CONFIG_STORE_FORWARD
+}
+
+/* Publica o shadow de cada concentrador conhecido via AWS IoT */
+static void shadow_update_work_fn(struct k_work *work)
+{
+    struct shadow_slot snapshot[ARRAY_SIZE(shadows)];
+    bool json_due = true;
+    int err;
+
+    /* Em polling, lê os concentradores primeiro; poll_done() chama de novo */
+    if (gateway_ble_mode_get() == GATEWAY_BLE_MODE_POLL && !poll_complete) {
+        err = gateway_ble_poll_shadow(poll_done);
+        if (err == 0 || err == -EBUSY) {
+            return;
+        }
+        LOG_DBG("Poll não iniciado (%d), publicando o último shadow", err);
+    }
+    poll_complete = false;
+
+    /* Cria uma cópia dos dados atuais com proteção do mutex */
+    k_mutex_lock(&shadow_mutex, K_FOREVER);
+    memcpy(snapshot, shadows, sizeof(snapshot));
+    for (size_t i = 0; i < ARRAY_SIZE(shadows); i++) {
+        shadows[i].updates = 0;
+    }
+    k_mutex_unlock(&shadow_mutex);
+
+#ifdef CONFIG_SHADOW_FRAME
+    /* O frame vai a cada ciclo, o JSON do shadow só a cada CONFIG_SHADOW_FRAME_JSON_EVERY */
+#ifdef CONFIG_SHADOW_BATCH
+    err = batch_publish();
+#else
+    err = shadow_frame_publish(snapshot, ARRAY_SIZE(snapshot));
+#endif // CONFIG_SHADOW_BATCH
+    if (err) {
+        LOG_ERR("aws_iot_send do frame falhou, erro: %d", err);
+        goto reschedule;
+    }
+    json_due = CONFIG_SHADOW_FRAME_JSON_EVERY > 0 &&
+               publish_cycle % MAX(CONFIG_SHADOW_FRAME_JSON_EVERY, 1) == 0;
+#endif // CONFIG_SHADOW_FRAME
+    publish_cycle++;
+
+    for (size_t i = 0; i < ARRAY_SIZE(snapshot); i++) {
+        const struct shadow_slot *slot = &snapshot[i];
+
+        if (!slot->used) {
+            continue;
+        }
+
+        if (json_due) {
+            err = shadow_publish(&slot->addr, &slot->shadow);
+            if (err) {
+                LOG_ERR("aws_iot_send falhou, erro: %d", err);
+                //FATAL_ERROR();
+                goto reschedule;
+            }
+        }
+
+        publish_stats.published++;
+        publish_stats.superseded += slot->updates > 1 ? slot->updates - 1 : 0;
+        publish_stats.age_total_ms += k_uptime_get() - slot->received_at;
+    }
+
+    print_transfer_stats();
+
+    /* Também depois de uma falha, senão as publicações param até a próxima conexão */
+reschedule:
+    (void)k_work_reschedule_for_queue(&gateway_workq, &shadow_update_work,
                 K_SECONDS(CONFIG_AWS_IOT_SAMPLE_PUBLICATION_INTERVAL_SECONDS));
 }
 
@@ -133,12 +597,21 @@ static void print_shadow(const concentrator_shadow_t *shadow)
 {
     LOG_INF("Notificação recebida:");
     LOG_INF(" Timestamp: %u", shadow->concentrator_timestamp);
-    LOG_INF(" Temp: %.2f°C", shadow->temperature / 100.0);
-    LOG_INF(" Pressure: %.1f hPa", shadow->pressure / 10.0);
-    LOG_INF(" Lat: %.7f", shadow->latitude / 1e7);
-    LOG_INF(" Lon: %.7f", shadow->longitude / 1e7);
+    char temperature[8], pressure[8], latitude[14], longitude[14];
+
+    /* Ponto fixo, a imagem não tem printf de float */
+    json_fixed_to_str(temperature, sizeof(temperature), shadow->temperature, 2);
+    json_fixed_to_str(pressure, sizeof(pressure), shadow->pressure, 1);
+    json_fixed_to_str(latitude, sizeof(latitude), shadow->latitude, 7);
+    json_fixed_to_str(longitude, sizeof(longitude), shadow->longitude, 7);
+
+    LOG_INF(" Temp: %s°C", temperature);
+    LOG_INF(" Pressure: %s hPa", pressure);
+    LOG_INF(" Lat: %s", latitude);
+    LOG_INF(" Lon: %s", longitude);
     LOG_INF(" Fix: %d", shadow->fix_type);
     LOG_INF(" Move: %d | Posture: %d", shadow->movement, shadow->posture);
+    LOG_INF(" Activity: %d | Steps: %u", shadow->activity, shadow->steps);
     LOG_INF(" Light: %d", shadow->light);
     LOG_INF("--------------------------------------------------");
 }
@@ -184,12 +657,44 @@ static void on_aws_iot_evt_connected(const struct aws_iot_evt *const evt)
 	boot_write_img_confirmed();
 #endif
 
-	/* Start sequential updates to AWS IoT. */
-	(void)k_work_reschedule(&shadow_update_work, K_NO_WAIT);
+	/* Start sequential updates to AWS IoT, the first one with the JSON shadow. */
+	atomic_set(&aws_connected, 1);
+	publish_cycle = 0;
+	(void)k_work_reschedule_for_queue(&gateway_workq, &shadow_update_work, K_NO_WAIT);
+#ifdef CONFIG_STORE_FORWARD
+	/* O que ficou guardado sem conexão vai depois da primeira publicação */
+	(void)k_work_reschedule_for_queue(&gateway_workq, &drain_work,
+					  K_MSEC(CONFIG_STORE_FORWARD_DRAIN_INTERVAL_MS));
+#endif // CONFIG_STORE_FORWARD
+}
+
+/* Modo BLE pedido no shadow: {"state":{"desired":{"ble_mode":"poll"}}} */
+static void on_aws_iot_evt_delta(const struct aws_iot_evt *const evt)
+{
+    cJSON *root = cJSON_ParseWithLength(evt->data.msg.ptr, evt->data.msg.len);
+    cJSON *state = cJSON_GetObjectItem(root, "state");
+    cJSON *ble_mode = cJSON_GetObjectItem(state, "ble_mode");
+
+    if (cJSON_IsString(ble_mode)) {
+        if (strcmp(ble_mode->valuestring, "poll") == 0) {
+            (void)gateway_ble_mode_set(GATEWAY_BLE_MODE_POLL);
+        } else if (strcmp(ble_mode->valuestring, "notify") == 0) {
+            (void)gateway_ble_mode_set(GATEWAY_BLE_MODE_NOTIFY);
+        } else {
+            LOG_WRN("ble_mode desconhecido: %s", ble_mode->valuestring);
+        }
+    }
+
+    cJSON_Delete(root);
 }
 
 static void on_aws_iot_evt_disconnected(void)
 {
+	atomic_set(&aws_connected, 0);
+#ifdef CONFIG_STORE_FORWARD
+	/* Sem PUBACK, os registros da fila em trânsito vão de novo na reconexão */
+	store_forward_rewind();
+#endif // CONFIG_STORE_FORWARD
 	//(void)k_work_cancel_delayable(&shadow_update_work);
 	//(void)k_work_reschedule(&connect_work, K_SECONDS(5));
 }
@@ -238,9 +743,15 @@ static void aws_iot_event_handler(const struct aws_iot_evt *const evt)
 									 evt->data.msg.ptr,
 									 evt->data.msg.topic.len,
 									 evt->data.msg.topic.str);
+		if (evt->data.msg.topic.type == AWS_IOT_SHADOW_TOPIC_UPDATE_DELTA) {
+			on_aws_iot_evt_delta(evt);
+		}
 		break;
 	case AWS_IOT_EVT_PUBACK:
 		LOG_INF("AWS_IOT_EVT_PUBACK, message ID: %d", evt->data.message_id);
+#ifdef CONFIG_STORE_FORWARD
+		store_forward_ack(evt->data.message_id);
+#endif // CONFIG_STORE_FORWARD
 		break;
 	case AWS_IOT_EVT_PINGRESP:
 		LOG_INF("AWS_IOT_EVT_PINGRESP");
@@ -332,6 +843,11 @@ int main(void)
     /* Inicializa o mutex */
     k_mutex_init(&shadow_mutex);
 
+    k_work_queue_start(&gateway_workq, gateway_workq_stack,
+                       K_THREAD_STACK_SIZEOF(gateway_workq_stack),
+                       CONFIG_GATEWAY_WORKQ_PRIORITY, NULL);
+    k_thread_name_set(&gateway_workq.thread, "gateway_workq");
+
     LOG_INF("Gateway BLE Example");
 
     err = gateway_lte_init();
@@ -347,6 +863,22 @@ int main(void)
         return 1;
     }
 
+    /* Bonds e handles GATT em cache, antes de começar a conectar */
+    settings_load();
+
+#ifdef CONFIG_STORE_FORWARD
+    err = store_forward_init();
+    if (err) {
+        LOG_ERR("Inicialização do store_forward falhou: %d, payloads sem conexão serão perdidos", err);
+    } else {
+        LOG_INF("store_forward: %zu payloads guardados de boots anteriores", store_forward_depth());
+    }
+
+    /* Os ciclos começam sem esperar o AWS IoT, o que não sair fica na flash */
+    (void)k_work_reschedule_for_queue(&gateway_workq, &shadow_update_work,
+                K_SECONDS(CONFIG_AWS_IOT_SAMPLE_PUBLICATION_INTERVAL_SECONDS));
+#endif // CONFIG_STORE_FORWARD
+
     err = gateway_ble_init(concentrator_data_handler);
     if (err) {
         LOG_ERR("Inicialização BLE falhou: %d", err);
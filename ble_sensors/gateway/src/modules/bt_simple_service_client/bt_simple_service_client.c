@@ -20,7 +20,8 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME, LOG_LEVEL_INF);
 enum {
 	SIMPLE_SERVICE_C_INITIALIZED,
 	SIMPLE_SERVICE_C_BUTTOM_NOTIF_ENABLED,
-	SIMPLE_SERVICE_C_RX_WRITE_PENDING
+	SIMPLE_SERVICE_C_RX_WRITE_PENDING,
+	SIMPLE_SERVICE_C_READ_PENDING
 };
 
 int bt_simple_service_client_init(struct bt_simple_service *simple_service_c,
@@ -85,6 +86,20 @@ int bt_simple_service_handles_assign(struct bt_gatt_dm *dm,
 	return 0;
 }
 
+int bt_simple_service_handles_set(struct bt_simple_service *simple_service_c,
+			  struct bt_conn *conn,
+			  const struct bt_simple_service_client_handles *handles)
+{
+	if (!handles->shadow || !handles->shadow_ccc) {
+		return -EINVAL;
+	}
+
+	LOG_DBG("Using cached handles for Custom service.");
+	simple_service_c->handles = *handles;
+	simple_service_c->conn = conn;
+	return 0;
+}
+
 static uint8_t on_received(struct bt_conn *conn,
 			struct bt_gatt_subscribe_params *params,
 			const void *data, uint16_t length)
@@ -140,6 +155,84 @@ int bt_simple_service_subscribe_receive(struct bt_simple_service *simple_service
 	return err;
 }
 
+int bt_simple_service_unsubscribe_receive(struct bt_simple_service *simple_service_c)
+{
+	int err;
+
+	if (!atomic_test_bit(&simple_service_c->state, SIMPLE_SERVICE_C_BUTTOM_NOTIF_ENABLED)) {
+		return -EALREADY;
+	}
+
+	/* The state bit is cleared by on_received() once the CCC is written */
+	err = bt_gatt_unsubscribe(simple_service_c->conn, &simple_service_c->shadow_notif_params);
+	if (err) {
+		LOG_ERR("Unsubscribe failed (err %d)", err);
+	} else {
+		LOG_DBG("[UNSUBSCRIBE REQUESTED]");
+	}
+
+	return err;
+}
+
+static uint8_t on_read(struct bt_conn *conn, uint8_t err,
+		       struct bt_gatt_read_params *params,
+		       const void *data, uint16_t length)
+{
+	struct bt_simple_service *simple_service_c;
+
+	/* Retrieve module context. */
+	simple_service_c = CONTAINER_OF(params, struct bt_simple_service, read_params);
+
+	/* A value longer than the MTU comes in parts, the end is marked by data == NULL */
+	if (!err && data) {
+		uint16_t room = sizeof(simple_service_c->read_buf) - simple_service_c->read_len;
+		uint16_t copy = MIN(length, room);
+
+		memcpy(&simple_service_c->read_buf[simple_service_c->read_len], data, copy);
+		simple_service_c->read_len += copy;
+		if (copy == length) {
+			return BT_GATT_ITER_CONTINUE;
+		}
+		LOG_WRN("Shadow longer than %zu bytes", sizeof(simple_service_c->read_buf));
+	}
+
+	atomic_clear_bit(&simple_service_c->state, SIMPLE_SERVICE_C_READ_PENDING);
+	if (simple_service_c->cb.read) {
+		simple_service_c->cb.read(simple_service_c, err,
+					  err ? NULL : simple_service_c->read_buf,
+					  err ? 0 : simple_service_c->read_len);
+	}
+
+	return BT_GATT_ITER_STOP;
+}
+
+int bt_simple_service_read_shadow(struct bt_simple_service *simple_service_c)
+{
+	int err;
+
+	if (!simple_service_c->conn) {
+		return -ENOTCONN;
+	}
+
+	if (atomic_test_and_set_bit(&simple_service_c->state, SIMPLE_SERVICE_C_READ_PENDING)) {
+		return -EBUSY;
+	}
+
+	simple_service_c->read_len = 0;
+	simple_service_c->read_params.func = on_read;
+	simple_service_c->read_params.handle_count = 1;
+	simple_service_c->read_params.single.handle = simple_service_c->handles.shadow;
+	simple_service_c->read_params.single.offset = 0;
+
+	err = bt_gatt_read(simple_service_c->conn, &simple_service_c->read_params);
+	if (err) {
+		LOG_ERR("Read failed (err %d)", err);
+		atomic_clear_bit(&simple_service_c->state, SIMPLE_SERVICE_C_READ_PENDING);
+	}
+
+	return err;
+}
+
 static void on_sent(struct bt_conn *conn, uint8_t err,
                      struct bt_gatt_write_params *params)
 {
@@ -54,6 +54,17 @@ struct bt_simple_service_cb {
 	 */
 	void (*sent)(struct bt_simple_service *simple_service, uint8_t err, const uint8_t *data, uint16_t len);
 
+	/** @brief Shadow read callback.
+	 *
+	 * A read started with bt_simple_service_read_shadow() has completed.
+	 *
+	 * @param[in] simple_service  Simple Service Client instance.
+	 * @param[in] err ATT error code, 0 on success.
+	 * @param[in] data Value read, NULL on error.
+	 * @param[in] len Length of the value read.
+	 */
+	void (*read)(struct bt_simple_service *simple_service, uint8_t err, const uint8_t *data, uint16_t len);
+
 	/** @brief TX notifications disabled callback.
 	 *
 	 * TX notifications have been disabled.
@@ -93,6 +104,13 @@ struct bt_simple_service {
 	/** GATT write parameters for WRITE Characteristic. */
 	struct bt_gatt_write_params write_params;
 
+	/** GATT read parameters for SHADOW Characteristic. */
+	struct bt_gatt_read_params read_params;
+
+	/** Shadow value being read, a long read arrives in several parts. */
+	uint8_t read_buf[sizeof(concentrator_shadow_t)];
+	uint16_t read_len;
+
 	/** Application callbacks. */
 	struct bt_simple_service_cb cb;
 };
@@ -118,6 +136,22 @@ struct bt_simple_service {
 int bt_simple_service_handles_assign(struct bt_gatt_dm *dm,
 			  struct bt_simple_service *simple_service_c);
 
+/** @brief Assign handles known from an earlier discovery of the same peer.
+ *
+ * Skips the GATT discovery on a reconnect. The caller is responsible for
+ * checking that the peer's attribute table did not change meanwhile.
+ *
+ * @param[in,out] simple_service_c Simple Service Client instance.
+ * @param[in] conn Connection to the peer.
+ * @param[in] handles Handles saved after the earlier discovery.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval (-EINVAL) If a handle is missing.
+ */
+int bt_simple_service_handles_set(struct bt_simple_service *simple_service_c,
+			  struct bt_conn *conn,
+			  const struct bt_simple_service_client_handles *handles);
+
 
 
 
@@ -134,6 +168,29 @@ int bt_simple_service_handles_assign(struct bt_gatt_dm *dm,
  */
 int bt_simple_service_subscribe_receive(struct bt_simple_service *simple_service_c);
 
+/** @brief Request the peer to stop sending notifications for the Shadow
+ *	   Characteristic.
+ *
+ * @param[in,out] simple_service_c Simple Service Client instance.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval (-EALREADY) If notifications were not enabled.
+ *           Otherwise, a negative error code is returned.
+ */
+int bt_simple_service_unsubscribe_receive(struct bt_simple_service *simple_service_c);
+
+/** @brief Read the Shadow Characteristic.
+ *
+ * The value is delivered through the read callback.
+ *
+ * @param[in,out] simple_service_c Simple Service Client instance.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval (-EBUSY) If a read is already in progress.
+ *           Otherwise, a negative error code is returned.
+ */
+int bt_simple_service_read_shadow(struct bt_simple_service *simple_service_c);
+
 int bt_simple_service_set_led(struct bt_simple_service *simple_service_c, const uint8_t data);
 
 
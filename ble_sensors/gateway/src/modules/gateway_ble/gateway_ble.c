@@ -1,4 +1,4 @@
-// gateway_ble.c (modo polling apenas, sem notify/callback)
+// gateway_ble.c (um link por concentrador, até CONFIG_BT_MAX_CONN)
 
 #include "gateway_ble.h"
 #include <zephyr/kernel.h>
@@ -11,6 +11,7 @@
 #include <zephyr/bluetooth/gatt.h>
 #include <bluetooth/gatt_dm.h>
 #include <bluetooth/scan.h>
+#include <zephyr/settings/settings.h>
 
 #include <string.h>
 
@@ -20,36 +21,270 @@ LOG_MODULE_REGISTER(gateway_ble, CONFIG_GATEWAY_BLE_LOG_LEVEL);
 
 ble_state_t ble_state = BLE_DISCONNECTED;
 
-static struct bt_conn *default_conn;
-static struct bt_simple_service simple_service;
+#define DB_HASH_LEN 16
+
+// One link per concentrator, indexed by bt_conn_index()
+struct concentrator_link {
+    struct bt_conn *conn;
+    struct bt_simple_service client;
+    bool discover_pending;
+    int64_t connected_at;
+    bool first_shadow;          // Waiting for the first shadow of this link
+    bool cached;                // Handles taken from the cache, no discovery
+    bool hash_valid;
+    uint8_t hash[DB_HASH_LEN];  // Database Hash of the concentrator
+    struct bt_gatt_read_params hash_params;
+    int64_t read_at;            // Start of the shadow read in progress
+    bool polling;               // Read counted in the poll in progress
+};
+
+// Handles of a concentrator discovered earlier, valid while its Database Hash is unchanged
+struct handle_cache_entry {
+    bt_addr_le_t addr;
+    uint8_t hash[DB_HASH_LEN];
+    struct bt_simple_service_client_handles handles;
+} __packed;
+
+// Links lost sooner than this count as a failed attempt
+#define LINK_STABLE_MS 10000
+
+// Concentrators seen so far, kept across disconnections for the reconnect backoff
+struct concentrator_peer {
+    bt_addr_le_t addr;
+    bool used;
+    bool connected;
+    uint8_t failures;
+    int64_t retry_at;
+};
+
+static struct concentrator_link links[CONFIG_BT_MAX_CONN];
+static struct concentrator_peer peers[CONFIG_GATEWAY_BLE_MAX_CONCENTRATORS];
+static struct handle_cache_entry handle_cache[CONFIG_GATEWAY_BLE_MAX_CONCENTRATORS];
+static size_t handle_cache_next;    // Entry replaced when the cache is full
+
+static concentrator_shadow_handler_t shadow_handler;
+
+static struct k_spinlock stats_lock;
+static struct gateway_ble_reconnect_stats reconnect_stats;
+static struct gateway_ble_transfer_stats transfer_stats;
+
+static atomic_t mode = ATOMIC_INIT(IS_ENABLED(CONFIG_GATEWAY_BLE_MODE_POLL) ?
+                                   GATEWAY_BLE_MODE_POLL : GATEWAY_BLE_MODE_NOTIFY);
+
+// Poll in progress, done is NULL when there is none
+static struct k_spinlock poll_lock;
+static gateway_ble_poll_done_t poll_done;
+static size_t poll_outstanding;
+static size_t poll_received;
+
+// The controller creates one connection at a time
+static struct bt_conn *pending_conn;
+static bool discovering;
+
+static void reconnect_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(reconnect_work, reconnect_work_fn);
+static void cache_save_work_fn(struct k_work *work);
+static K_WORK_DEFINE(cache_save_work, cache_save_work_fn);
+static void poll_timeout_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(poll_timeout_work, poll_timeout_work_fn);
+
+static size_t link_count(void)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static struct concentrator_peer *peer_find(const bt_addr_le_t *addr, bool add)
+{
+    struct concentrator_peer *free_peer = NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(peers); i++) {
+        if (!peers[i].used) {
+            free_peer = free_peer ? free_peer : &peers[i];
+        } else if (bt_addr_le_cmp(&peers[i].addr, addr) == 0) {
+            return &peers[i];
+        }
+    }
+
+    if (!add || !free_peer) {
+        return NULL;
+    }
+
+    memset(free_peer, 0, sizeof(*free_peer));
+    bt_addr_le_copy(&free_peer->addr, addr);
+    free_peer->used = true;
+    return free_peer;
+}
+
+// Back off exponentially from a concentrator that keeps failing
+static void peer_failed(struct concentrator_peer *peer)
+{
+    uint32_t delay_ms;
+
+    if (!peer) {
+        return;
+    }
+
+    peer->failures = MIN(peer->failures + 1, 16);
+    delay_ms = MIN((uint32_t)CONFIG_GATEWAY_BLE_RECONNECT_MIN_MS << (peer->failures - 1),
+                   CONFIG_GATEWAY_BLE_RECONNECT_MAX_MS);
+    peer->retry_at = k_uptime_get() + delay_ms;
+
+    LOG_INF("Concentrator retry in %u ms (%u failures)", delay_ms, peer->failures);
+}
+
+static void update_ble_state(void)
+{
+    if (link_count() > 0) {
+        ble_state = BLE_CONNECTED;
+    } else if (pending_conn) {
+        ble_state = BLE_CONNECTING;
+    } else {
+        ble_state = BLE_DISCONNECTED;
+    }
+}
+
+static struct handle_cache_entry *handle_cache_find(const bt_addr_le_t *addr)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(handle_cache); i++) {
+        if (bt_addr_le_cmp(&handle_cache[i].addr, addr) == 0) {
+            return &handle_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// UUID filter for new concentrators, one address filter per cached concentrator.
+// Directed advertisements carry no UUID, so those match by address.
+static int scan_filters_add(void)
+{
+    static const struct bt_uuid_128 sensor_uuid = BT_UUID_INIT_128(WORKER_SHADOW_SERVICE_UUID);
+    static const bt_addr_le_t addr_none;
+    int err;
+
+    err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID, &sensor_uuid.uuid);
+    if (err) {
+        LOG_ERR("Failed to add filter (err %d)", err);
+        return err;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(handle_cache); i++) {
+        if (bt_addr_le_cmp(&handle_cache[i].addr, &addr_none) != 0) {
+            err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_ADDR, &handle_cache[i].addr);
+            if (err) {
+                LOG_DBG("Address filter not added (err %d)", err);
+            }
+        }
+    }
+    return 0;
+}
+
+static void handle_cache_store(const struct concentrator_link *link)
+{
+    const bt_addr_le_t *addr = bt_conn_get_dst(link->conn);
+    struct handle_cache_entry *entry = handle_cache_find(addr);
+    bool added = !entry;
+
+    if (!entry) {
+        entry = &handle_cache[handle_cache_next];
+        handle_cache_next = (handle_cache_next + 1) % ARRAY_SIZE(handle_cache);
+    }
+
+    bt_addr_le_copy(&entry->addr, addr);
+    memcpy(entry->hash, link->hash, DB_HASH_LEN);
+    entry->handles = link->client.handles;
+
+    // The entry may have replaced another concentrator, whose address filter
+    // would otherwise keep its slot in CONFIG_BT_SCAN_ADDRESS_CNT forever
+    if (added) {
+        bt_scan_filter_remove_all();
+        (void)scan_filters_add();
+    }
+
+    // Flash writes stay out of the BT RX thread
+    k_work_submit(&cache_save_work);
+}
+
+static void cache_save_work_fn(struct k_work *work)
+{
+    int err = settings_save_one("gw_gatt/cache", handle_cache, sizeof(handle_cache));
+    if (err) {
+        LOG_ERR("Failed to save the handle cache (err %d)", err);
+    }
+}
+
+static int handle_cache_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+
+    if (!settings_name_steq(name, "cache", &next) || next) {
+        return -ENOENT;
+    }
+
+    // A cache from another table size is dropped, discovery refills it
+    if (len != sizeof(handle_cache) ||
+        read_cb(cb_arg, handle_cache, sizeof(handle_cache)) != sizeof(handle_cache)) {
+        memset(handle_cache, 0, sizeof(handle_cache));
+    }
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(gw_gatt, "gw_gatt", NULL, handle_cache_set, NULL, NULL);
+
+static void discover_next(void);
+
+// Handles are known: notify mode subscribes, poll mode waits for the next poll
+static void link_ready(struct concentrator_link *link)
+{
+    if (atomic_get(&mode) == GATEWAY_BLE_MODE_NOTIFY) {
+        bt_simple_service_subscribe_receive(&link->client);
+    }
+}
 
 static void discovery_completed_cb(struct bt_gatt_dm *dm,
 				   void *context)
 {
+	struct concentrator_link *link = context;
 	int err;
 
 	LOG_INF("The discovery procedure succeeded");
 
 	bt_gatt_dm_data_print(dm);
 
-    err = bt_simple_service_handles_assign(dm, &simple_service);
+    err = bt_simple_service_handles_assign(dm, &link->client);
 	if (err) {
 		LOG_ERR("Could not init client object, error: %d", err);
+	} else {
+		link_ready(link);
+		if (link->hash_valid) {
+			handle_cache_store(link);
+		}
 	}
 
-	bt_simple_service_subscribe_receive(&simple_service);
-
 	err = bt_gatt_dm_data_release(dm);
 	if (err) {
 		LOG_ERR("Could not release the discovery data, error "
 		       "code: %d", err);
 	}
+
+	discovering = false;
+	discover_next();
 }
 
 static void discovery_service_not_found_cb(struct bt_conn *conn,
 					   void *context)
 {
 	LOG_ERR("The service could not be found during the discovery");
+	bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+
+	discovering = false;
+	discover_next();
 }
 
 static void discovery_error_found_cb(struct bt_conn *conn,
@@ -57,6 +292,10 @@ static void discovery_error_found_cb(struct bt_conn *conn,
 				     void *context)
 {
 	LOG_ERR("The discovery procedure failed with %d", err);
+	bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+
+	discovering = false;
+	discover_next();
 }
 
 static const struct bt_gatt_dm_cb discovery_cb = {
@@ -65,71 +304,157 @@ static const struct bt_gatt_dm_cb discovery_cb = {
 	.error_found = discovery_error_found_cb,
 };
 
-static void gatt_discover(struct bt_conn *conn)
+// GATT DM runs one discovery at a time, the other links wait for their turn
+static void discover_next(void)
 {
 	int err;
 
-	LOG_DBG("Running Gatt Discover Function");
+	if (discovering) {
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		struct concentrator_link *link = &links[i];
+
+		if (!link->conn || !link->discover_pending) {
+			continue;
+		}
+
+		LOG_DBG("Running Gatt Discover Function");
 
-    static const struct bt_uuid_128 sensor_uuid =BT_UUID_INIT_128(WORKER_SHADOW_SERVICE_UUID);
-	err = bt_gatt_dm_start(conn, &sensor_uuid.uuid, &discovery_cb, NULL);
+		static const struct bt_uuid_128 sensor_uuid = BT_UUID_INIT_128(WORKER_SHADOW_SERVICE_UUID);
+		err = bt_gatt_dm_start(link->conn, &sensor_uuid.uuid, &discovery_cb, link);
 		if (err) {
 			LOG_ERR("Failed to start discovery (err %d)", err);
+			bt_conn_disconnect(link->conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+			link->discover_pending = false;
+			continue;
 		}
+
+		link->discover_pending = false;
+		discovering = true;
+		return;
+	}
+}
+
+// The Database Hash tells in one read whether the cached handles still hold
+static uint8_t hash_read_cb(struct bt_conn *conn, uint8_t err,
+                            struct bt_gatt_read_params *params,
+                            const void *data, uint16_t length)
+{
+    struct concentrator_link *link = CONTAINER_OF(params, struct concentrator_link, hash_params);
+    const struct handle_cache_entry *entry;
+
+    if (link->conn != conn) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    link->hash_valid = (!err && data && length == DB_HASH_LEN);
+    if (link->hash_valid) {
+        memcpy(link->hash, data, DB_HASH_LEN);
+    }
+
+    entry = handle_cache_find(bt_conn_get_dst(conn));
+    if (link->hash_valid && entry && memcmp(entry->hash, link->hash, DB_HASH_LEN) == 0 &&
+        bt_simple_service_handles_set(&link->client, conn, &entry->handles) == 0) {
+        LOG_INF("Attribute table unchanged, using cached handles");
+        link->cached = true;
+        link_ready(link);
+    } else {
+        link->discover_pending = true;
+        discover_next();
+    }
+
+    return BT_GATT_ITER_STOP;
+}
+
+static void hash_read_start(struct concentrator_link *link)
+{
+    int err;
+
+    link->hash_params.func = hash_read_cb;
+    link->hash_params.handle_count = 0;
+    link->hash_params.by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    link->hash_params.by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    link->hash_params.by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+
+    err = bt_gatt_read(link->conn, &link->hash_params);
+    if (err) {
+        LOG_WRN("Database Hash read failed (err %d), discovering", err);
+        link->hash_valid = false;
+        link->discover_pending = true;
+        discover_next();
+    }
 }
 
 static void connected(struct bt_conn *conn, uint8_t conn_err)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
-	int err;
-    
+	struct concentrator_peer *peer = peer_find(bt_conn_get_dst(conn), true);
+	struct concentrator_link *link = &links[bt_conn_index(conn)];
 
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
     LOG_DBG("Connected to %s", addr);
 
+	if (conn == pending_conn) {
+		bt_conn_unref(pending_conn);
+		pending_conn = NULL;
+	}
+
 	if (conn_err) {
 		LOG_INF("Failed to connect to %s (%d)", addr, conn_err);
-
-		if (default_conn == conn) {
-			bt_conn_unref(default_conn);
-			default_conn = NULL;
-
-			err = bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE);
-			if (err) {
-				LOG_ERR("Scanning failed to start (err %d)",
-					err);
-			}
+		peer_failed(peer);
+	} else {
+		LOG_INF("Connected: %s (%zu links)", addr, link_count() + 1);
+
+		link->conn = bt_conn_ref(conn);
+		link->discover_pending = false;
+		link->connected_at = k_uptime_get();
+		link->first_shadow = true;
+		link->cached = false;
+		if (peer) {
+			peer->connected = true;
 		}
-
-		return;
+		hash_read_start(link);
 	}
 
-	LOG_INF("Connected: %s", addr);
-    gatt_discover(conn);
+	update_ble_state();
+	k_work_reschedule(&reconnect_work, K_NO_WAIT);
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
-	int err;
+	struct concentrator_peer *peer = peer_find(bt_conn_get_dst(conn), false);
+	struct concentrator_link *link = &links[bt_conn_index(conn)];
 
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
 	LOG_INF("Disconnected: %s (reason %u)", addr, reason);
 
-	if (default_conn != conn) {
+	if (link->conn != conn) {
 		return;
 	}
 
-	bt_conn_unref(default_conn);
-	default_conn = NULL;
-
-	err = bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE);
-	if (err) {
-		LOG_ERR("Scanning failed to start (err %d)",
-			err);
+	bt_conn_unref(link->conn);
+	link->conn = NULL;
+	link->client.conn = NULL;
+	link->discover_pending = false;
+
+	// A link lost right away counts as a failure, a long lived one reconnects at once
+	if (peer) {
+		peer->connected = false;
+		if (k_uptime_get() - link->connected_at < LINK_STABLE_MS) {
+			peer_failed(peer);
+		} else {
+			peer->failures = 0;
+			peer->retry_at = 0;
+		}
 	}
+
+	update_ble_state();
+	k_work_reschedule(&reconnect_work, K_NO_WAIT);
 }
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
@@ -143,24 +468,43 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 
 
 
-static void scan_connecting_error(struct bt_scan_device_info *device_info)
-{
-	LOG_WRN("Connecting failed");
-}
-
-static void scan_connecting(struct bt_scan_device_info *device_info,
-			    struct bt_conn *conn)
-{
-    LOG_DBG("Connecting...");
-	default_conn = bt_conn_ref(conn);
-}
-
 static void scan_filter_match(struct bt_scan_device_info *info,
     struct bt_scan_filter_match *match, bool connectable)
-{  
+{
+    const bt_addr_le_t *addr = info->recv_info->addr;
+    struct concentrator_peer *peer;
+    int err;
+
     LOG_DBG("Filter match found");
 
-    return;
+    if (!connectable || pending_conn || link_count() >= ARRAY_SIZE(links)) {
+        return;
+    }
+
+    // A concentrator with free central slots keeps advertising while connected
+    peer = peer_find(addr, true);
+    if (!peer) {
+        LOG_WRN("Concentrator table full, CONFIG_GATEWAY_BLE_MAX_CONCENTRATORS too small");
+        return;
+    }
+    if (peer->connected || k_uptime_get() < peer->retry_at) {
+        return;
+    }
+
+    sensor_scanner_stop();
+
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, BT_LE_CONN_PARAM_DEFAULT,
+                            &pending_conn);
+    if (err) {
+        LOG_WRN("Connecting failed (err %d)", err);
+        pending_conn = NULL;
+        peer_failed(peer);
+        k_work_reschedule(&reconnect_work, K_NO_WAIT);
+        return;
+    }
+
+    LOG_DBG("Connecting...");
+    update_ble_state();
 }
 
 uint8_t scanning_state = 1;
@@ -187,7 +531,22 @@ int sensor_scanner_start(void) {
     return err;
 }
 
-BT_SCAN_CB_INIT(scan_cb, scan_filter_match, NULL, scan_connecting_error, scan_connecting);
+// Reconnect manager: scan whenever a link slot is free and no connection is
+// being created. Concentrators in backoff are skipped in scan_filter_match().
+static void reconnect_work_fn(struct k_work *work)
+{
+    bool want_scan = !pending_conn && link_count() < ARRAY_SIZE(links);
+
+    if (want_scan && !scanning_state) {
+        if (sensor_scanner_start()) {
+            k_work_reschedule(&reconnect_work, K_MSEC(CONFIG_GATEWAY_BLE_RECONNECT_MIN_MS));
+        }
+    } else if (!want_scan && scanning_state) {
+        sensor_scanner_stop();
+    }
+}
+
+BT_SCAN_CB_INIT(scan_cb, scan_filter_match, NULL, NULL, NULL);
 
 static struct bt_le_scan_param scan_param = {
     .type = BT_LE_SCAN_TYPE_ACTIVE,
@@ -209,21 +568,246 @@ static void ble_data_sent(struct bt_simple_service *simple_service, uint8_t err,
     }
 }
 
-// static uint8_t ble_data_received(struct bt_simple_service *simple_service,
-//         const uint8_t *data, uint16_t len)
-// {
-//     ARG_UNUSED(simple_service);
+// Times the reconnect, then hands the shadow to the application. Both modes end here.
+static uint8_t shadow_received(struct bt_simple_service *simple_service,
+    const uint8_t *data, uint16_t len)
+{
+    struct concentrator_link *link = CONTAINER_OF(simple_service, struct concentrator_link, client);
+
+    if (link->first_shadow) {
+        uint32_t elapsed_ms = (uint32_t)(k_uptime_get() - link->connected_at);
+
+        link->first_shadow = false;
+
+        k_spinlock_key_t key = k_spin_lock(&stats_lock);
+        reconnect_stats.links++;
+        reconnect_stats.cached += link->cached;
+        reconnect_stats.last_ms = elapsed_ms;
+        reconnect_stats.max_ms = MAX(reconnect_stats.max_ms, elapsed_ms);
+        reconnect_stats.total_ms += elapsed_ms;
+        k_spin_unlock(&stats_lock, key);
+
+        LOG_INF("First shadow %u ms after connecting (%s)", elapsed_ms,
+                link->cached ? "cached handles" : "discovery");
+    }
+
+    return shadow_handler ? shadow_handler(simple_service, data, len) : BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t shadow_notified(struct bt_simple_service *simple_service,
+    const uint8_t *data, uint16_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    transfer_stats.notifications++;
+    transfer_stats.att_pdus++;
+    transfer_stats.bytes += len;
+    k_spin_unlock(&stats_lock, key);
 
-//     if (*data == 0x01) {
-//         LOG_DBG("Received value: 0x01, setting LED on");
+    return shadow_received(simple_service, data, len);
+}
 
-//     } else if (*data == 0x00) {
+// One link of the poll is over, the last one reports the poll as done
+static void poll_finish(struct concentrator_link *link, bool received)
+{
+    gateway_ble_poll_done_t done = NULL;
+    size_t count = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&poll_lock);
+    if (!link || link->polling) {
+        if (link) {
+            link->polling = false;
+            poll_received += received;
+        }
+        if (poll_outstanding > 0 && --poll_outstanding == 0) {
+            done = poll_done;
+            count = poll_received;
+            poll_done = NULL;
+        }
+    }
+    k_spin_unlock(&poll_lock, key);
 
-//         LOG_DBG("Received value: 0x00, setting LED off");
-//     }
+    if (done) {
+        (void)k_work_cancel_delayable(&poll_timeout_work);
+        done(count);
+    }
+}
 
-//     return BT_GATT_ITER_CONTINUE;
-// }
+// Links that did not answer in time are left out, a late answer still reaches the handler
+static void poll_timeout_work_fn(struct k_work *work)
+{
+    gateway_ble_poll_done_t done;
+    size_t count;
+    uint32_t missing = 0;
+
+    k_spinlock_key_t key = k_spin_lock(&poll_lock);
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].polling) {
+            links[i].polling = false;
+            missing++;
+        }
+    }
+    done = poll_done;
+    count = poll_received;
+    poll_done = NULL;
+    poll_outstanding = 0;
+    k_spin_unlock(&poll_lock, key);
+
+    if (missing) {
+        LOG_WRN("Poll timed out, %u links did not answer", missing);
+
+        key = k_spin_lock(&stats_lock);
+        transfer_stats.read_errors += missing;
+        k_spin_unlock(&stats_lock, key);
+    }
+
+    if (done) {
+        done(count);
+    }
+}
+
+static void shadow_read(struct bt_simple_service *simple_service, uint8_t err,
+    const uint8_t *data, uint16_t len)
+{
+    struct concentrator_link *link = CONTAINER_OF(simple_service, struct concentrator_link, client);
+    uint32_t elapsed_ms = (uint32_t)(k_uptime_get() - link->read_at);
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    if (err) {
+        transfer_stats.read_errors++;
+    } else {
+        // Request and response per part, a value longer than the MTU takes several
+        uint16_t part = simple_service->conn ? bt_gatt_get_mtu(simple_service->conn) - 1 : len;
+
+        transfer_stats.reads++;
+        transfer_stats.att_pdus += 2 * DIV_ROUND_UP(MAX(len, 1), MAX(part, 1));
+        transfer_stats.bytes += len;
+        transfer_stats.read_last_ms = elapsed_ms;
+        transfer_stats.read_max_ms = MAX(transfer_stats.read_max_ms, elapsed_ms);
+        transfer_stats.read_total_ms += elapsed_ms;
+    }
+    k_spin_unlock(&stats_lock, key);
+
+    if (err) {
+        LOG_WRN("Shadow read failed (ATT err 0x%02X)", err);
+    } else {
+        LOG_DBG("Shadow read in %u ms", elapsed_ms);
+        (void)shadow_received(simple_service, data, len);
+    }
+
+    poll_finish(link, !err);
+}
+
+int gateway_ble_poll_shadow(gateway_ble_poll_done_t done)
+{
+    size_t started = 0;
+    k_spinlock_key_t key;
+
+    if (!done) {
+        return -EINVAL;
+    }
+
+    // The caller holds one count until every read is started
+    key = k_spin_lock(&poll_lock);
+    if (poll_done) {
+        k_spin_unlock(&poll_lock, key);
+        return -EBUSY;
+    }
+    poll_done = done;
+    poll_outstanding = 1;
+    poll_received = 0;
+    k_spin_unlock(&poll_lock, key);
+
+    (void)k_work_reschedule(&poll_timeout_work, K_MSEC(CONFIG_GATEWAY_BLE_POLL_TIMEOUT_MS));
+
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        struct concentrator_link *link = &links[i];
+        int err;
+
+        // Links still discovering have no handles yet
+        if (!link->conn || !link->client.conn) {
+            continue;
+        }
+
+        key = k_spin_lock(&poll_lock);
+        link->polling = true;
+        poll_outstanding++;
+        k_spin_unlock(&poll_lock, key);
+
+        link->read_at = k_uptime_get();
+        err = bt_simple_service_read_shadow(&link->client);
+        if (err) {
+            LOG_WRN("Shadow read not started (err %d)", err);
+
+            key = k_spin_lock(&stats_lock);
+            transfer_stats.read_errors++;
+            k_spin_unlock(&stats_lock, key);
+
+            poll_finish(link, false);
+            continue;
+        }
+        started++;
+    }
+
+    if (started == 0) {
+        key = k_spin_lock(&poll_lock);
+        poll_done = NULL;
+        poll_outstanding = 0;
+        k_spin_unlock(&poll_lock, key);
+
+        (void)k_work_cancel_delayable(&poll_timeout_work);
+        return -ENOTCONN;
+    }
+
+    poll_finish(NULL, false);
+    return 0;
+}
+
+int gateway_ble_mode_set(enum gateway_ble_mode new_mode)
+{
+    if (new_mode != GATEWAY_BLE_MODE_NOTIFY && new_mode != GATEWAY_BLE_MODE_POLL) {
+        return -EINVAL;
+    }
+
+    if (atomic_set(&mode, new_mode) == new_mode) {
+        return 0;
+    }
+
+    LOG_INF("Shadow transfer mode: %s", new_mode == GATEWAY_BLE_MODE_POLL ? "poll" : "notify");
+
+    // In poll mode the concentrator keeps no subscription and sends nothing on its own
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        struct bt_simple_service *client = &links[i].client;
+
+        if (!links[i].conn || !client->conn) {
+            continue;
+        }
+        if (new_mode == GATEWAY_BLE_MODE_NOTIFY) {
+            (void)bt_simple_service_subscribe_receive(client);
+        } else {
+            (void)bt_simple_service_unsubscribe_receive(client);
+        }
+    }
+    return 0;
+}
+
+enum gateway_ble_mode gateway_ble_mode_get(void)
+{
+    return (enum gateway_ble_mode)atomic_get(&mode);
+}
+
+void gateway_ble_transfer_stats_get(struct gateway_ble_transfer_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats = transfer_stats;
+    k_spin_unlock(&stats_lock, key);
+}
+
+void gateway_ble_reconnect_stats_get(struct gateway_ble_reconnect_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats = reconnect_stats;
+    k_spin_unlock(&stats_lock, key);
+}
 
 static int simple_service_client_init(concentrator_shadow_handler_t client_handler)
 {
@@ -231,19 +815,25 @@ static int simple_service_client_init(concentrator_shadow_handler_t client_handl
 
     struct bt_simple_service_client_init_param init = {
         .cb = {
-            .received = client_handler,
+            .received = shadow_notified,
             .sent = ble_data_sent,
+            .read = shadow_read,
         }
     };
 
-    err = bt_simple_service_client_init(&simple_service, &init);
-    if (err) {
-        LOG_ERR("Client initialization failed (err %d)", err);
-        return err;
+    shadow_handler = client_handler;
+
+    // One client context per link
+    for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+        err = bt_simple_service_client_init(&links[i].client, &init);
+        if (err) {
+            LOG_ERR("Client initialization failed (err %d)", err);
+            return err;
+        }
     }
 
-    LOG_INF("Client module initialized");
-    return err;
+    LOG_INF("Client module initialized, %zu links", ARRAY_SIZE(links));
+    return 0;
 }
 
 
@@ -251,22 +841,30 @@ static int simple_service_client_init(concentrator_shadow_handler_t client_handl
 static int scan_init(void)
 {
     int err;
+    // Connections are created here, so concentrators already linked are skipped
     struct bt_scan_init_param init = {
-        .connect_if_match = 1,
+        .connect_if_match = 0,
         .scan_param = &scan_param,
     };
     bt_scan_init(&init);
     bt_scan_cb_register(&scan_cb);
 
 
-    static const struct bt_uuid_128 sensor_uuid =BT_UUID_INIT_128(WORKER_SHADOW_SERVICE_UUID);
-    err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID, &sensor_uuid.uuid);
+    // Concentrators known from the cache reconnect on directed advertising too
+    err = scan_filters_add();
     if (err) {
-        LOG_ERR("Failed to add filter (err %d)", err);
         return err;
     }
+
+    static const bt_addr_le_t addr_none;
+    for (size_t i = 0; i < ARRAY_SIZE(handle_cache); i++) {
+        if (bt_addr_le_cmp(&handle_cache[i].addr, &addr_none) != 0) {
+            handle_cache_next = (i + 1) % ARRAY_SIZE(handle_cache);
+        }
+    }
+
     if (!err) {
-        err = bt_scan_filter_enable(BT_SCAN_UUID_FILTER, false);
+        err = bt_scan_filter_enable(BT_SCAN_UUID_FILTER | BT_SCAN_ADDR_FILTER, false);
         if (err) {
             LOG_ERR("Failed to enable filter (err %d)", err);
         } else {
@@ -277,6 +875,10 @@ static int scan_init(void)
 
 }
 
+const bt_addr_le_t *gateway_ble_peer_addr(const struct bt_simple_service *simple_service)
+{
+    return simple_service->conn ? bt_conn_get_dst(simple_service->conn) : NULL;
+}
 
 int gateway_ble_init(concentrator_shadow_handler_t client_handler)
 {
@@ -29,13 +29,69 @@ typedef uint8_t (*concentrator_shadow_handler_t)(struct bt_simple_service *simpl
 
 
 /**
- * Inicializa BLE e conecta ao concentrador.
+ * Inicializa BLE e conecta aos concentradores (até CONFIG_BT_MAX_CONN).
  */
 int gateway_ble_init(concentrator_shadow_handler_t client_handler);
 
+/* Tempo entre a conexão e o primeiro shadow de cada link */
+struct gateway_ble_reconnect_stats {
+    uint32_t links;         // Links que já entregaram o primeiro shadow
+    uint32_t cached;        // Destes, quantos usaram handles em cache
+    uint32_t last_ms;
+    uint32_t max_ms;
+    uint64_t total_ms;      // Soma, para a média
+};
+
+/**
+ * Copia as estatísticas de reconexão.
+ */
+void gateway_ble_reconnect_stats_get(struct gateway_ble_reconnect_stats *stats);
+
+/**
+ * Endereço do concentrador ligado a esta instância do cliente, NULL se desconectado.
+ */
+const bt_addr_le_t *gateway_ble_peer_addr(const struct bt_simple_service *simple_service);
+
+/* Como os shadows chegam dos concentradores */
+enum gateway_ble_mode {
+    GATEWAY_BLE_MODE_NOTIFY,    // Notificação a cada shadow novo
+    GATEWAY_BLE_MODE_POLL,      // Leitura GATT quando o gateway vai publicar
+};
+
+/**
+ * Troca o modo em todos os links. Em polling as notificações são desligadas.
+ */
+int gateway_ble_mode_set(enum gateway_ble_mode mode);
+
+enum gateway_ble_mode gateway_ble_mode_get(void);
+
+/* Chamado quando todas as leituras de um poll terminaram ou expiraram */
+typedef void (*gateway_ble_poll_done_t)(size_t received);
+
+/**
+ * Lê o shadow de cada link por leitura GATT. Os dados chegam pelo mesmo
+ * handler das notificações, depois done é chamado uma vez.
+ *
+ * @return 0 se alguma leitura começou, -ENOTCONN sem links prontos,
+ *         -EBUSY se um poll ainda está em andamento.
+ */
+int gateway_ble_poll_shadow(gateway_ble_poll_done_t done);
+
+/* Transferências dos shadows, para comparar os dois modos */
+struct gateway_ble_transfer_stats {
+    uint32_t notifications;     // Shadows recebidos por notificação
+    uint32_t reads;             // Leituras completadas
+    uint32_t read_errors;       // Leituras com erro ou sem resposta no prazo
+    uint32_t att_pdus;          // PDUs ATT com shadow no ar, estimativa de energia
+    uint64_t bytes;             // Bytes de shadow recebidos
+    uint32_t read_last_ms;      // Latência da leitura (pedido até resposta)
+    uint32_t read_max_ms;
+    uint64_t read_total_ms;     // Soma, para a média
+};
+
 /**
- * Lê os dados do shadow por leitura GATT.
+ * Copia as estatísticas de transferência.
  */
-int gateway_ble_poll_shadow(concentrator_shadow_t *shadow_out);
+void gateway_ble_transfer_stats_get(struct gateway_ble_transfer_stats *stats);
 
 #endif // GATEWAY_BLE_H
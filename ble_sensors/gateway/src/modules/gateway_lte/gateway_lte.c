@@ -61,16 +61,10 @@ static void lte_handler(const struct lte_lc_evt *const evt)
 		break;
 
 	#if defined(CONFIG_LTE_LC_EDRX_MODULE)
-	case LTE_LC_EVT_EDRX_UPDATE: {
-		char log_buf[60];
-		ssize_t len;
-
-		len = snprintf(log_buf, sizeof(log_buf),
-			       "eDRX parameter update: eDRX: %f, PTW: %f",
-			       evt->edrx_cfg.edrx, evt->edrx_cfg.ptw);
-		if (len > 0) {
-			LOG_INF("%s\n", log_buf);
-		}
+	case LTE_LC_EVT_EDRX_UPDATE:
+		/* In ms, the image has no floating point printf */
+		LOG_INF("eDRX parameter update: eDRX: %d ms, PTW: %d ms",
+			(int)(evt->edrx_cfg.edrx * 1000), (int)(evt->edrx_cfg.ptw * 1000));
 		break;
 	#endif
 	
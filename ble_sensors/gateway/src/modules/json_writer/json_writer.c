@@ -0,0 +1,183 @@
+// json_writer.c
+
+#include "json_writer.h"
+
+#include <errno.h>
+#include <string.h>
+
+// Longest number: sign, 20 digits of a uint64_t and the decimal point
+#define NUMBER_MAX_LEN 22
+
+static void put(struct json_writer *writer, const char *data, size_t len)
+{
+    // One byte stays free for the NUL of json_writer_finish()
+    if (writer->overflow || writer->size - writer->len <= len) {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(&writer->buf[writer->len], data, len);
+    writer->len += len;
+}
+
+static void put_char(struct json_writer *writer, char c)
+{
+    put(writer, &c, 1);
+}
+
+// Digits of value from the end of out, at least min_digits (zero padded)
+static size_t format_digits(char *out_end, uint64_t value, uint8_t min_digits)
+{
+    size_t n = 0;
+
+    do {
+        *--out_end = '0' + (value % 10);
+        value /= 10;
+        n++;
+    } while (value || n < min_digits);
+
+    return n;
+}
+
+// Formats into the end of tmp, returns the start
+static char *format_fixed(char tmp[NUMBER_MAX_LEN], int64_t value, uint8_t decimals, size_t *len)
+{
+    char *end = &tmp[NUMBER_MAX_LEN];
+    char *p = end;
+    uint64_t magnitude = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    uint64_t scale = 1;
+
+    decimals = decimals > 18 ? 18 : decimals;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    if (decimals) {
+        p -= format_digits(p, magnitude % scale, decimals);
+        *--p = '.';
+    }
+    p -= format_digits(p, magnitude / scale, 1);
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    *len = end - p;
+    return p;
+}
+
+static void put_string(struct json_writer *writer, const char *value)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = value;
+
+    put_char(writer, '"');
+    for (const char *p = value; *p; p++) {
+        unsigned char c = *p;
+
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+
+        // Plain characters go out in one copy, only these need escaping
+        put(writer, run, p - run);
+        run = p + 1;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', c };
+            put(writer, esc, sizeof(esc));
+        } else {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            put(writer, esc, sizeof(esc));
+        }
+    }
+    put(writer, run, strlen(run));
+    put_char(writer, '"');
+}
+
+static void put_key(struct json_writer *writer, const char *key)
+{
+    if (writer->need_comma) {
+        put_char(writer, ',');
+    }
+    if (key) {
+        put_string(writer, key);
+        put_char(writer, ':');
+    }
+    writer->need_comma = true;
+}
+
+void json_writer_init(struct json_writer *writer, char *buf, size_t size)
+{
+    writer->buf = buf;
+    writer->size = size;
+    writer->len = 0;
+    writer->need_comma = false;
+    writer->overflow = (size == 0);
+}
+
+void json_writer_object_begin(struct json_writer *writer, const char *key)
+{
+    put_key(writer, key);
+    put_char(writer, '{');
+    writer->need_comma = false;
+}
+
+void json_writer_object_end(struct json_writer *writer)
+{
+    put_char(writer, '}');
+    writer->need_comma = true;
+}
+
+void json_writer_string(struct json_writer *writer, const char *key, const char *value)
+{
+    put_key(writer, key);
+    put_string(writer, value);
+}
+
+void json_writer_int(struct json_writer *writer, const char *key, int64_t value)
+{
+    json_writer_fixed(writer, key, value, 0);
+}
+
+void json_writer_uint(struct json_writer *writer, const char *key, uint64_t value)
+{
+    char tmp[NUMBER_MAX_LEN];
+    size_t len = format_digits(&tmp[NUMBER_MAX_LEN], value, 1);
+
+    put_key(writer, key);
+    put(writer, &tmp[NUMBER_MAX_LEN - len], len);
+}
+
+void json_writer_fixed(struct json_writer *writer, const char *key, int64_t value, uint8_t decimals)
+{
+    char tmp[NUMBER_MAX_LEN];
+    size_t len;
+    const char *text = format_fixed(tmp, value, decimals, &len);
+
+    put_key(writer, key);
+    put(writer, text, len);
+}
+
+int json_writer_finish(struct json_writer *writer)
+{
+    if (writer->overflow) {
+        if (writer->size) {
+            writer->buf[0] = '\0';
+        }
+        return -ENOMEM;
+    }
+    writer->buf[writer->len] = '\0';
+    return (int)writer->len;
+}
+
+int json_fixed_to_str(char *buf, size_t size, int64_t value, uint8_t decimals)
+{
+    char tmp[NUMBER_MAX_LEN];
+    size_t len;
+    const char *text = format_fixed(tmp, value, decimals, &len);
+
+    if (len >= size) {
+        return -ENOMEM;
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    return (int)len;
+}
@@ -0,0 +1,53 @@
+// json_writer.h
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming JSON writer into a caller buffer, without printf. Numbers with
+ * decimals are written from the scaled integers of the shadow, so the image
+ * needs no floating point formatting.
+ *
+ * Errors are sticky: once the buffer is full every call is ignored and
+ * json_writer_finish() reports -ENOMEM.
+ */
+struct json_writer {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool need_comma;
+    bool overflow;
+};
+
+void json_writer_init(struct json_writer *writer, char *buf, size_t size);
+
+/* key is NULL for the root object */
+void json_writer_object_begin(struct json_writer *writer, const char *key);
+void json_writer_object_end(struct json_writer *writer);
+
+void json_writer_string(struct json_writer *writer, const char *key, const char *value);
+void json_writer_int(struct json_writer *writer, const char *key, int64_t value);
+void json_writer_uint(struct json_writer *writer, const char *key, uint64_t value);
+
+/* Writes value / 10^decimals with exactly that many decimals, e.g. (-312345, 4) as -31.2345 */
+void json_writer_fixed(struct json_writer *writer, const char *key, int64_t value, uint8_t decimals);
+
+/**
+ * Terminates the text with a NUL.
+ *
+ * @return Length of the text, without the NUL, or -ENOMEM if it did not fit.
+ */
+int json_writer_finish(struct json_writer *writer);
+
+/**
+ * Formats value / 10^decimals into buf, as json_writer_fixed() does.
+ *
+ * @return Length written, without the NUL, or -ENOMEM if buf is too small.
+ */
+int json_fixed_to_str(char *buf, size_t size, int64_t value, uint8_t decimals);
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,108 @@
+// shadow_batch.c
+
+#include "shadow_batch.h"
+#include "shadow_frame.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(shadow_batch, CONFIG_SHADOW_BATCH_LOG_LEVEL);
+
+struct batch_sample {
+    uint32_t seq;
+    bt_addr_le_t addr;
+    int64_t received_at;
+    concentrator_shadow_t shadow;
+};
+
+// Ring, oldest at head
+static struct batch_sample samples[CONFIG_SHADOW_BATCH_SIZE];
+static size_t head;
+static size_t count;
+static uint32_t dropped;
+static uint32_t next_seq;
+static struct k_spinlock lock;
+
+size_t shadow_batch_add(const bt_addr_le_t *addr, const concentrator_shadow_t *shadow,
+                        int64_t received_at)
+{
+    struct batch_sample *sample;
+    size_t now_count;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (count == ARRAY_SIZE(samples)) {
+        head = (head + 1) % ARRAY_SIZE(samples);
+        count--;
+        dropped++;
+    }
+
+    sample = &samples[(head + count) % ARRAY_SIZE(samples)];
+    sample->seq = next_seq++;
+    bt_addr_le_copy(&sample->addr, addr);
+    sample->received_at = received_at;
+    sample->shadow = *shadow;
+    now_count = ++count;
+    k_spin_unlock(&lock, key);
+
+    return now_count;
+}
+
+size_t shadow_batch_count(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    size_t now_count = count;
+    k_spin_unlock(&lock, key);
+
+    return now_count;
+}
+
+uint32_t shadow_batch_dropped(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t now_dropped = dropped;
+    k_spin_unlock(&lock, key);
+
+    return now_dropped;
+}
+
+int shadow_batch_encode(uint8_t *buf, size_t size, int64_t now, size_t *taken,
+                        uint32_t *last_seq)
+{
+    struct shadow_frame frame;
+    int err;
+
+    *taken = 0;
+
+    err = shadow_frame_batch_begin(&frame, buf, size, (uint32_t)(now / MSEC_PER_SEC));
+    if (err) {
+        return err;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    for (size_t i = 0; i < count; i++) {
+        const struct batch_sample *sample = &samples[(head + i) % ARRAY_SIZE(samples)];
+        uint32_t age_ms = (uint32_t)CLAMP(now - sample->received_at, 0,
+                                          (int64_t)SHADOW_FRAME_AGE_UNKNOWN - 1);
+
+        if (shadow_frame_add_sample(&frame, &sample->addr, age_ms, &sample->shadow)) {
+            break;
+        }
+        *last_seq = sample->seq;
+        (*taken)++;
+    }
+    k_spin_unlock(&lock, key);
+
+    LOG_DBG("Batch of %zu shadows, %zu bytes", *taken, shadow_frame_len(&frame));
+    return (int)shadow_frame_len(&frame);
+}
+
+void shadow_batch_consume(uint32_t last_seq)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    // Shadows encoded but pushed out by a full ring meanwhile are already gone
+    while (count > 0 && (int32_t)(samples[head].seq - last_seq) <= 0) {
+        head = (head + 1) % ARRAY_SIZE(samples);
+        count--;
+    }
+    k_spin_unlock(&lock, key);
+}
@@ -0,0 +1,43 @@
+// shadow_batch.h
+
+#ifndef SHADOW_BATCH_H
+#define SHADOW_BATCH_H
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/addr.h>
+
+#include "worker_shadow_service.h"
+
+/**
+ * Keeps one shadow received at received_at (uptime, ms). When the batch is
+ * full the oldest shadow is dropped.
+ *
+ * @return Shadows in the batch, CONFIG_SHADOW_BATCH_SIZE when full.
+ */
+size_t shadow_batch_add(const bt_addr_le_t *addr, const concentrator_shadow_t *shadow,
+                        int64_t received_at);
+
+size_t shadow_batch_count(void);
+
+/* Shadows dropped because the batch was full */
+uint32_t shadow_batch_dropped(void);
+
+/**
+ * Writes the batch, oldest first, as a batch frame (shadow_frame.h) sent at now.
+ * The shadows stay in the batch until shadow_batch_consume().
+ *
+ * @param[out] taken Shadows written to the frame.
+ * @param[out] last_seq Sequence of the newest shadow written, for
+ *                      shadow_batch_consume(). Left as is when none was.
+ *
+ * @return Frame length, or a negative error code.
+ */
+int shadow_batch_encode(uint8_t *buf, size_t size, int64_t now, size_t *taken,
+                        uint32_t *last_seq);
+
+/* Removes the shadows up to last_seq from shadow_batch_encode(), once their
+ * frame was sent. Safe from any thread: shadows added meanwhile stay, and
+ * the encoded ones a full batch dropped meanwhile are skipped. */
+void shadow_batch_consume(uint32_t last_seq);
+
+#endif // SHADOW_BATCH_H
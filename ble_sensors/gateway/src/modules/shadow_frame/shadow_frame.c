@@ -0,0 +1,112 @@
+// shadow_frame.c
+
+#include "shadow_frame.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+// The shadow goes in as it came over BLE, the host decodes it with the same layout
+BUILD_ASSERT(sizeof(concentrator_shadow_t) == 24, "shadow layout changed, update shadow_frame.py");
+
+static int frame_begin(struct shadow_frame *frame, uint8_t *buf, size_t size,
+                       uint8_t version, uint32_t uptime_s)
+{
+    if (size < SHADOW_FRAME_HEADER_LEN) {
+        return -ENOMEM;
+    }
+
+    frame->buf = buf;
+    frame->size = size;
+    frame->buf[0] = version;
+    frame->buf[1] = 0;
+    sys_put_le32(uptime_s, &frame->buf[2]);
+    frame->len = SHADOW_FRAME_HEADER_LEN;
+    return 0;
+}
+
+// Reserves a record, NULL if it does not fit
+static uint8_t *frame_record(struct shadow_frame *frame, size_t len)
+{
+    uint8_t *record = &frame->buf[frame->len];
+
+    if (frame->size - frame->len < len || frame->buf[1] == UINT8_MAX) {
+        return NULL;
+    }
+
+    frame->buf[1]++;
+    frame->len += len;
+    return record;
+}
+
+int shadow_frame_begin(struct shadow_frame *frame, uint8_t *buf, size_t size, uint32_t uptime_s)
+{
+    return frame_begin(frame, buf, size, SHADOW_FRAME_VERSION, uptime_s);
+}
+
+int shadow_frame_batch_begin(struct shadow_frame *frame, uint8_t *buf, size_t size, uint32_t uptime_s)
+{
+    return frame_begin(frame, buf, size, SHADOW_FRAME_VERSION_BATCH, uptime_s);
+}
+
+int shadow_frame_add(struct shadow_frame *frame, const bt_addr_le_t *addr,
+                     const concentrator_shadow_t *shadow)
+{
+    uint8_t *record;
+
+    if (frame->buf[0] != SHADOW_FRAME_VERSION) {
+        return -EINVAL;
+    }
+    record = frame_record(frame, SHADOW_FRAME_RECORD_LEN);
+    if (!record) {
+        return -ENOMEM;
+    }
+
+    record[0] = addr->type;
+    memcpy(&record[1], addr->a.val, BT_ADDR_SIZE);
+    memcpy(&record[1 + BT_ADDR_SIZE], shadow, sizeof(*shadow));
+    return 0;
+}
+
+int shadow_frame_add_sample(struct shadow_frame *frame, const bt_addr_le_t *addr,
+                            uint32_t age_ms, const concentrator_shadow_t *shadow)
+{
+    uint8_t *record;
+
+    if (frame->buf[0] != SHADOW_FRAME_VERSION_BATCH) {
+        return -EINVAL;
+    }
+    record = frame_record(frame, SHADOW_FRAME_SAMPLE_LEN);
+    if (!record) {
+        return -ENOMEM;
+    }
+
+    record[0] = addr->type;
+    memcpy(&record[1], addr->a.val, BT_ADDR_SIZE);
+    sys_put_le32(age_ms, &record[1 + BT_ADDR_SIZE]);
+    memcpy(&record[1 + BT_ADDR_SIZE + 4], shadow, sizeof(*shadow));
+    return 0;
+}
+
+int shadow_frame_batch_restamp(uint8_t *buf, size_t len, uint32_t uptime_s, int64_t delay_ms)
+{
+    if (len < SHADOW_FRAME_HEADER_LEN || buf[0] != SHADOW_FRAME_VERSION_BATCH ||
+        len != SHADOW_FRAME_BATCH_LEN(buf[1])) {
+        return -EINVAL;
+    }
+
+    sys_put_le32(uptime_s, &buf[2]);
+    for (size_t i = 0; i < buf[1]; i++) {
+        uint8_t *age = &buf[SHADOW_FRAME_HEADER_LEN + i * SHADOW_FRAME_SAMPLE_LEN + 1 + BT_ADDR_SIZE];
+        uint32_t age_ms = sys_get_le32(age);
+
+        if (delay_ms < 0 || age_ms == SHADOW_FRAME_AGE_UNKNOWN) {
+            age_ms = SHADOW_FRAME_AGE_UNKNOWN;
+        } else {
+            age_ms = (uint32_t)MIN(age_ms + delay_ms, (int64_t)SHADOW_FRAME_AGE_UNKNOWN - 1);
+        }
+        sys_put_le32(age_ms, age);
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// shadow_frame.h
+
+#ifndef SHADOW_FRAME_H
+#define SHADOW_FRAME_H
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/addr.h>
+
+#include "worker_shadow_service.h"
+
+/*
+ * Frame, little endian, no padding:
+ *
+ *   version   u8     SHADOW_FRAME_VERSION or SHADOW_FRAME_VERSION_BATCH
+ *   count     u8     records that follow
+ *   uptime    u32    gateway uptime when sent (s)
+ *
+ * then per record:
+ *
+ *   addr_type u8     BT_ADDR_LE_PUBLIC / BT_ADDR_LE_RANDOM
+ *   addr      u8[6]  least significant byte first, as in bt_addr_t
+ *   age_ms    u32    batch only: time from reception to sending,
+ *                    SHADOW_FRAME_AGE_UNKNOWN if it was lost
+ *   shadow    24 B   concentrator_shadow_t as sent over BLE
+ *
+ * A snapshot frame has the latest shadow of each concentrator, a batch
+ * frame every shadow received since the last batch, oldest first.
+ */
+#define SHADOW_FRAME_VERSION 1
+#define SHADOW_FRAME_VERSION_BATCH 2
+#define SHADOW_FRAME_HEADER_LEN 6
+#define SHADOW_FRAME_RECORD_LEN (1 + BT_ADDR_SIZE + sizeof(concentrator_shadow_t))
+#define SHADOW_FRAME_SAMPLE_LEN (SHADOW_FRAME_RECORD_LEN + 4)
+#define SHADOW_FRAME_AGE_UNKNOWN UINT32_MAX
+
+/* Size of a frame with count records */
+#define SHADOW_FRAME_LEN(count) (SHADOW_FRAME_HEADER_LEN + (count) * SHADOW_FRAME_RECORD_LEN)
+#define SHADOW_FRAME_BATCH_LEN(count) (SHADOW_FRAME_HEADER_LEN + (count) * SHADOW_FRAME_SAMPLE_LEN)
+
+struct shadow_frame {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+};
+
+/**
+ * Starts a frame in buf.
+ *
+ * @return 0, or -ENOMEM if buf cannot hold the header.
+ */
+int shadow_frame_begin(struct shadow_frame *frame, uint8_t *buf, size_t size, uint32_t uptime_s);
+
+/**
+ * Starts a batch frame in buf.
+ *
+ * @return 0, or -ENOMEM if buf cannot hold the header.
+ */
+int shadow_frame_batch_begin(struct shadow_frame *frame, uint8_t *buf, size_t size, uint32_t uptime_s);
+
+/**
+ * Appends the shadow of one concentrator to a snapshot frame.
+ *
+ * @return 0, -EINVAL on a batch frame, or -ENOMEM if the record does not
+ *         fit or the frame already has 255 records.
+ */
+int shadow_frame_add(struct shadow_frame *frame, const bt_addr_le_t *addr,
+                     const concentrator_shadow_t *shadow);
+
+/**
+ * Appends one shadow to a batch frame, received age_ms before sending.
+ *
+ * @return 0, -EINVAL on a snapshot frame, or -ENOMEM as shadow_frame_add().
+ */
+int shadow_frame_add_sample(struct shadow_frame *frame, const bt_addr_le_t *addr,
+                            uint32_t age_ms, const concentrator_shadow_t *shadow);
+
+/**
+ * Dates a batch frame again before it is sent late, from flash: the
+ * header takes the current uptime and every age grows by delay_ms.
+ * A negative delay_ms marks every age unknown.
+ *
+ * @return 0, or -EINVAL if buf does not hold a whole batch frame.
+ */
+int shadow_frame_batch_restamp(uint8_t *buf, size_t len, uint32_t uptime_s, int64_t delay_ms);
+
+/* Length of the frame so far */
+static inline size_t shadow_frame_len(const struct shadow_frame *frame)
+{
+    return frame->len;
+}
+
+#endif // SHADOW_FRAME_H
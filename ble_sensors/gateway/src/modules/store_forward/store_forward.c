@@ -0,0 +1,468 @@
+// store_forward.c (FIFO em flash, FCB, para os payloads não enviados)
+
+#include "store_forward.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/random/random.h>
+#include <zephyr/logging/log.h>
+#ifdef CONFIG_DATE_TIME
+#include <date_time.h>
+#endif // CONFIG_DATE_TIME
+
+LOG_MODULE_REGISTER(store_forward, CONFIG_STORE_FORWARD_LOG_LEVEL);
+
+#define STORE_FORWARD_AREA_ID FIXED_PARTITION_ID(store_forward_storage)
+#define STORE_FORWARD_MAGIC 0x53464657 // "SFFW"
+#define RECORD_VERSION 1
+
+#define RECORD_UNIX_TIME BIT(0)     // time_ms is network time, otherwise uptime of boot_id
+
+// Stored in front of every payload, a multiple of the flash write block
+struct record_hdr {
+    uint8_t version;
+    uint8_t kind;
+    uint8_t flags;
+    uint8_t reserved;
+    uint16_t len;
+    uint16_t reserved2;
+    uint32_t boot_id;
+    int64_t time_ms;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct record_hdr) % 4 == 0, "record header must keep writes aligned");
+BUILD_ASSERT(CONFIG_STORE_FORWARD_RECORD_MAX <= UINT16_MAX - sizeof(struct record_hdr),
+             "FCB entries are at most 64 kB");
+
+static struct fcb fcb;
+static struct flash_sector sectors[CONFIG_STORE_FORWARD_MAX_SECTORS];
+static bool ready;
+
+// Last record published; fe_sector NULL means none since the oldest one
+static struct fcb_entry drain_loc;
+
+// Tells the records of this boot apart, their uptime gives their age
+static uint32_t boot_id;
+
+// Header and payload, padded for the flash writes; also the drain read buffer
+static uint8_t record_buf[ROUND_UP(sizeof(struct record_hdr) + CONFIG_STORE_FORWARD_RECORD_MAX, 8)];
+
+static struct store_forward_stats stats;
+
+// Published and waiting for the PUBACK, in queue order right after drain_loc
+enum inflight_state {
+    INFLIGHT_WAITING,
+    INFLIGHT_ACKED,
+    INFLIGHT_EXPIRED,   // Dropped unsent, removed in order with the others
+    INFLIGHT_SKIPPED,
+};
+
+struct inflight_record {
+    struct fcb_entry loc;
+    uint16_t message_id;
+    uint8_t state;
+};
+
+// inflight is also touched by the MQTT thread through the ack and the rewind
+static struct k_spinlock inflight_lock;
+static struct inflight_record inflight[CONFIG_STORE_FORWARD_DRAIN_RECORDS];
+static size_t inflight_cnt;
+static uint32_t inflight_gen;       // Bumped by a rewind, a send racing it is forgotten
+static int64_t inflight_since;      // Last progress of the window, for the PUBACK timeout
+static uint16_t last_message_id;
+
+static void record_time(struct record_hdr *hdr)
+{
+#ifdef CONFIG_DATE_TIME
+    int64_t unix_ms;
+
+    if (date_time_now(&unix_ms) == 0) {
+        hdr->time_ms = unix_ms;
+        hdr->flags |= RECORD_UNIX_TIME;
+        return;
+    }
+#endif // CONFIG_DATE_TIME
+    hdr->time_ms = k_uptime_get();
+}
+
+// -1 when the record comes from an earlier boot without network time
+static int64_t record_age_ms(const struct record_hdr *hdr)
+{
+    if (hdr->flags & RECORD_UNIX_TIME) {
+#ifdef CONFIG_DATE_TIME
+        int64_t unix_ms;
+
+        if (date_time_now(&unix_ms) == 0) {
+            return MAX(unix_ms - hdr->time_ms, 0);
+        }
+#endif // CONFIG_DATE_TIME
+        return -1;
+    }
+    if (hdr->boot_id == boot_id) {
+        return MAX(k_uptime_get() - hdr->time_ms, 0);
+    }
+    return -1;
+}
+
+static bool record_expired(const struct record_hdr *hdr)
+{
+    int64_t age_ms = record_age_ms(hdr);
+
+    return CONFIG_STORE_FORWARD_MAX_AGE_H > 0 && age_ms >= 0 &&
+           age_ms >= (int64_t)CONFIG_STORE_FORWARD_MAX_AGE_H * 3600 * MSEC_PER_SEC;
+}
+
+static int record_read_hdr(const struct fcb_entry *loc, struct record_hdr *hdr)
+{
+    if (loc->fe_data_len < sizeof(*hdr)) {
+        return -EBADMSG;
+    }
+    return flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(*loc), hdr, sizeof(*hdr));
+}
+
+static void depth_remove(const struct fcb_entry *loc)
+{
+    stats.depth--;
+    stats.depth_bytes -= MIN(stats.depth_bytes, loc->fe_data_len - sizeof(struct record_hdr));
+}
+
+// Apart from the ids the MQTT helper hands out, and never 0
+static uint16_t next_message_id(void)
+{
+    last_message_id = (last_message_id + 1) | 0x8000;
+    return last_message_id;
+}
+
+// Keeps the records resolved in front, the first one waiting and all after it go again
+static void inflight_rewind_locked(void)
+{
+    size_t kept = 0;
+
+    while (kept < inflight_cnt && inflight[kept].state != INFLIGHT_WAITING) {
+        kept++;
+    }
+    inflight_cnt = kept;
+    inflight_gen++;
+}
+
+// Moves the cursor over the records resolved in order
+static void inflight_advance(void)
+{
+    struct inflight_record resolved[ARRAY_SIZE(inflight)];
+    size_t n = 0;
+    k_spinlock_key_t key = k_spin_lock(&inflight_lock);
+
+    while (n < inflight_cnt && inflight[n].state != INFLIGHT_WAITING) {
+        resolved[n] = inflight[n];
+        n++;
+    }
+    if (n) {
+        memmove(inflight, &inflight[n], (inflight_cnt - n) * sizeof(inflight[0]));
+        inflight_cnt -= n;
+        inflight_since = k_uptime_get();
+    }
+    k_spin_unlock(&inflight_lock, key);
+
+    for (size_t i = 0; i < n; i++) {
+        drain_loc = resolved[i].loc;
+        depth_remove(&resolved[i].loc);
+        if (resolved[i].state == INFLIGHT_ACKED) {
+            stats.drained++;
+        } else if (resolved[i].state == INFLIGHT_EXPIRED) {
+            stats.dropped_expired++;
+        }
+    }
+}
+
+// Erases the oldest page, losing the records in it that were not published
+static void drop_oldest_sector(void)
+{
+    struct flash_sector *oldest = fcb.f_oldest;
+    struct fcb_entry loc;
+    uint32_t lost = 0;
+
+    inflight_advance();
+    loc = drain_loc;
+
+    if (drain_loc.fe_sector == NULL || drain_loc.fe_sector == oldest) {
+        while (fcb_getnext(&fcb, &loc) == 0 && loc.fe_sector == oldest) {
+            depth_remove(&loc);
+            lost++;
+        }
+        memset(&drain_loc, 0, sizeof(drain_loc));
+
+        // Records in flight may sit in the erased page, the later ones go again
+        k_spinlock_key_t key = k_spin_lock(&inflight_lock);
+        inflight_cnt = 0;
+        inflight_gen++;
+        k_spin_unlock(&inflight_lock, key);
+    }
+
+    fcb_rotate(&fcb);
+
+    stats.dropped_full += lost;
+    LOG_WRN("Store full, oldest page erased (%u records lost)", lost);
+}
+
+// Pages behind the drain cursor only hold published records
+static void release_drained_sectors(void)
+{
+    if (stats.depth == 0) {
+        fcb_clear(&fcb);
+        memset(&drain_loc, 0, sizeof(drain_loc));
+        return;
+    }
+
+    while (drain_loc.fe_sector && fcb.f_oldest != drain_loc.fe_sector) {
+        if (fcb_rotate(&fcb)) {
+            break;
+        }
+    }
+}
+
+int store_forward_init(void)
+{
+    struct fcb_entry loc = { 0 };
+    uint32_t sector_cnt = ARRAY_SIZE(sectors);
+    int err;
+
+    err = flash_area_get_sectors(STORE_FORWARD_AREA_ID, &sector_cnt, sectors);
+    if (err) {
+        LOG_ERR("Store partition not found (err %d)", err);
+        return err;
+    }
+
+    fcb.f_magic = STORE_FORWARD_MAGIC;
+    fcb.f_version = RECORD_VERSION;
+    fcb.f_sectors = sectors;
+    fcb.f_sector_cnt = sector_cnt;
+    fcb.f_scratch_cnt = 0;
+
+    err = fcb_init(STORE_FORWARD_AREA_ID, &fcb);
+    if (err) {
+        LOG_ERR("Store init failed (err %d)", err);
+        return err;
+    }
+
+    boot_id = sys_rand32_get();
+
+    // Records left by an earlier boot are still waiting
+    while (fcb_getnext(&fcb, &loc) == 0) {
+        stats.depth++;
+        stats.depth_bytes += loc.fe_data_len - MIN(loc.fe_data_len, sizeof(struct record_hdr));
+    }
+
+    ready = true;
+    LOG_INF("Store ready, %u pages, %u records waiting", sector_cnt, stats.depth);
+    return 0;
+}
+
+int store_forward_push(uint8_t kind, const void *data, size_t len)
+{
+    struct record_hdr hdr = {
+        .version = RECORD_VERSION,
+        .kind = kind,
+        .len = len,
+        .boot_id = boot_id,
+    };
+    struct fcb_entry loc;
+    size_t total = sizeof(hdr) + len;
+    int err;
+
+    if (!ready) {
+        return -ENODEV;
+    }
+    if (len > CONFIG_STORE_FORWARD_RECORD_MAX) {
+        return -EMSGSIZE;
+    }
+
+    err = fcb_append(&fcb, total, &loc);
+    if (err == -ENOSPC) {
+#ifdef CONFIG_STORE_FORWARD_FULL_DROP_OLDEST
+        drop_oldest_sector();
+        err = fcb_append(&fcb, total, &loc);
+#else
+        stats.dropped_full++;
+        return -ENOSPC;
+#endif // CONFIG_STORE_FORWARD_FULL_DROP_OLDEST
+    }
+    if (err) {
+        LOG_ERR("Store append failed (err %d)", err);
+        return err;
+    }
+
+    // The entry is padded to the write block, the padding goes out with the payload
+    record_time(&hdr);
+    memcpy(record_buf, &hdr, sizeof(hdr));
+    memcpy(&record_buf[sizeof(hdr)], data, len);
+    err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), record_buf,
+                           ROUND_UP(total, fcb.f_align));
+    if (err) {
+        LOG_ERR("Store write failed (err %d)", err);
+        return err;
+    }
+
+    err = fcb_append_finish(&fcb, &loc);
+    if (err) {
+        LOG_ERR("Store append finish failed (err %d)", err);
+        return err;
+    }
+
+    stats.depth++;
+    stats.depth_bytes += len;
+    stats.stored++;
+    LOG_DBG("Stored %zu bytes, %u records waiting", len, stats.depth);
+    return 0;
+}
+
+int store_forward_drain(store_forward_send_t send)
+{
+    const struct record_hdr *hdr = (const struct record_hdr *)record_buf;
+    size_t sent = 0;
+    int err = 0;
+
+    if (!ready) {
+        return -ENODEV;
+    }
+
+    inflight_advance();
+    release_drained_sectors();
+
+    // PUBACK lost with the link, or never sent: publish the window again
+    k_spinlock_key_t key = k_spin_lock(&inflight_lock);
+    if (inflight_cnt && k_uptime_get() - inflight_since >=
+                        (int64_t)CONFIG_STORE_FORWARD_ACK_TIMEOUT_S * MSEC_PER_SEC) {
+        LOG_WRN("No PUBACK for %u s, publishing %zu records again",
+                CONFIG_STORE_FORWARD_ACK_TIMEOUT_S, inflight_cnt);
+        inflight_rewind_locked();
+    }
+    k_spin_unlock(&inflight_lock, key);
+
+    while (true) {
+        struct fcb_entry loc;
+        uint8_t state = INFLIGHT_WAITING;
+        uint16_t message_id = 0;
+        uint32_t gen;
+        size_t idx;
+
+        key = k_spin_lock(&inflight_lock);
+        if (inflight_cnt == ARRAY_SIZE(inflight)) {
+            k_spin_unlock(&inflight_lock, key);
+            break;
+        }
+        loc = inflight_cnt ? inflight[inflight_cnt - 1].loc : drain_loc;
+        gen = inflight_gen;
+        k_spin_unlock(&inflight_lock, key);
+
+        if (fcb_getnext(&fcb, &loc)) {
+            break;
+        }
+
+        // A record that cannot be read back is skipped, not retried forever
+        if (loc.fe_data_len < sizeof(*hdr) || loc.fe_data_len > sizeof(record_buf) ||
+            flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), record_buf, loc.fe_data_len) ||
+            hdr->version != RECORD_VERSION || hdr->len != loc.fe_data_len - sizeof(*hdr)) {
+            LOG_WRN("Unreadable record skipped");
+            state = INFLIGHT_SKIPPED;
+        } else if (record_expired(hdr)) {
+            state = INFLIGHT_EXPIRED;
+        } else {
+            message_id = next_message_id();
+        }
+
+        // Listed before sending, the PUBACK may arrive before send() returns
+        key = k_spin_lock(&inflight_lock);
+        if (gen != inflight_gen) {
+            k_spin_unlock(&inflight_lock, key);
+            break;
+        }
+        if (inflight_cnt == 0) {
+            inflight_since = k_uptime_get();
+        }
+        idx = inflight_cnt++;
+        inflight[idx] = (struct inflight_record) {
+            .loc = loc,
+            .message_id = message_id,
+            .state = state,
+        };
+        k_spin_unlock(&inflight_lock, key);
+
+        if (state != INFLIGHT_WAITING) {
+            continue;
+        }
+
+        err = send(hdr->kind, &record_buf[sizeof(*hdr)], hdr->len, record_age_ms(hdr), message_id);
+        if (err == 0) {
+            sent++;
+            continue;
+        }
+
+        // Only this loop appends, so without a rewind the record is still at idx
+        key = k_spin_lock(&inflight_lock);
+        if (gen == inflight_gen) {
+            if (err == -EBADMSG) {
+                inflight[idx].state = INFLIGHT_SKIPPED;
+            } else {
+                inflight_cnt = idx;
+            }
+        }
+        k_spin_unlock(&inflight_lock, key);
+
+        if (err != -EBADMSG) {
+            break;
+        }
+        LOG_WRN("Record refused by the sender, dropped");
+        err = 0;
+    }
+
+    if (sent) {
+        LOG_INF("Published %zu records, %u waiting", sent, stats.depth);
+    }
+    return err ? err : (int)sent;
+}
+
+void store_forward_ack(uint16_t message_id)
+{
+    k_spinlock_key_t key = k_spin_lock(&inflight_lock);
+
+    for (size_t i = 0; i < inflight_cnt; i++) {
+        if (inflight[i].state == INFLIGHT_WAITING && inflight[i].message_id == message_id) {
+            inflight[i].state = INFLIGHT_ACKED;
+            break;
+        }
+    }
+    k_spin_unlock(&inflight_lock, key);
+}
+
+void store_forward_rewind(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&inflight_lock);
+
+    inflight_rewind_locked();
+    k_spin_unlock(&inflight_lock, key);
+}
+
+size_t store_forward_depth(void)
+{
+    return stats.depth;
+}
+
+void store_forward_stats_get(struct store_forward_stats *out)
+{
+    struct fcb_entry loc = drain_loc;
+    struct record_hdr hdr;
+
+    *out = stats;
+    out->oldest_age_ms = -1;
+
+    k_spinlock_key_t key = k_spin_lock(&inflight_lock);
+    out->inflight = inflight_cnt;
+    k_spin_unlock(&inflight_lock, key);
+
+    if (ready && stats.depth && fcb_getnext(&fcb, &loc) == 0 && record_read_hdr(&loc, &hdr) == 0) {
+        out->oldest_age_ms = record_age_ms(&hdr);
+    }
+}
@@ -0,0 +1,72 @@
+// store_forward.h
+
+#ifndef STORE_FORWARD_H
+#define STORE_FORWARD_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+struct store_forward_stats {
+    uint32_t depth;             // Records waiting, in flight included
+    uint32_t inflight;          // Records published and waiting for their PUBACK
+    uint32_t depth_bytes;       // Payload bytes waiting
+    int64_t oldest_age_ms;      // Age of the oldest record waiting, -1 if unknown or empty
+    uint32_t stored;            // Records appended since boot
+    uint32_t drained;           // Records acknowledged by the broker since boot
+    uint32_t dropped_full;      // Records lost to a full partition
+    uint32_t dropped_expired;   // Records older than CONFIG_STORE_FORWARD_MAX_AGE_H
+};
+
+/**
+ * Publishes one record with QoS 1 and message_id. kind is the one given
+ * to the push, age_ms the time since the push (-1 if unknown), data may
+ * be changed in place. The record leaves the queue only on
+ * store_forward_ack() with the same message_id.
+ *
+ * @return 0 once handed to MQTT, -EBADMSG to drop the record unsent, or
+ *         an error to keep it in the queue.
+ */
+typedef int (*store_forward_send_t)(uint8_t kind, uint8_t *data, size_t len, int64_t age_ms,
+                                    uint16_t message_id);
+
+/**
+ * Mounts the queue and counts the records left from earlier boots.
+ * All functions but store_forward_ack() and store_forward_rewind() are
+ * meant for one thread, the gateway workqueue.
+ */
+int store_forward_init(void);
+
+/**
+ * Appends a payload to the queue. kind is kept with it for the caller, so
+ * the drain can publish it to the right topic.
+ *
+ * @return 0, -ENODEV without a mounted queue, -EMSGSIZE above
+ *         CONFIG_STORE_FORWARD_RECORD_MAX, -ENOSPC when full and refusing
+ *         new payloads, or a flash error.
+ */
+int store_forward_push(uint8_t kind, const void *data, size_t len);
+
+/**
+ * Publishes the next records, oldest first, until
+ * CONFIG_STORE_FORWARD_DRAIN_RECORDS wait for their PUBACK. Also removes
+ * the records acknowledged since the last call, and publishes again the
+ * ones not acknowledged within CONFIG_STORE_FORWARD_ACK_TIMEOUT_S.
+ * Expired records are dropped on the way.
+ *
+ * @return Records published, or the error of the send that failed. The
+ *         failed record is published again on the next call.
+ */
+int store_forward_drain(store_forward_send_t send);
+
+/* PUBACK of a drained record, from any thread */
+void store_forward_ack(uint16_t message_id);
+
+/* Connection lost: the records still waiting for their PUBACK are
+ * published again by the next drain. From any thread. */
+void store_forward_rewind(void);
+
+size_t store_forward_depth(void);
+
+void store_forward_stats_get(struct store_forward_stats *stats);
+
+#endif // STORE_FORWARD_H
@@ -0,0 +1,134 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/logging/log.h>
+#include <stdlib.h>
+#include "gnss_filter.h"
+
+// gnss_filter.c logs as part of parser_gnss
+LOG_MODULE_REGISTER(sensor_gnss, CONFIG_PARSER_GNSS_LOG_LEVEL);
+
+// Real cadence of the nodes: SENSOR_NODE_INTERVAL_S default plus the wait for the fix
+#define SAMPLE_PERIOD_MS    10000
+#define FIX_WAIT_MS         1500
+#define CADENCE_MS          (SAMPLE_PERIOD_MS + FIX_WAIT_MS)
+
+#define BASE_LAT            (-31190000)     // Manaus, as in scripts/gnss_log_gen.py
+#define BASE_LON            (-600217000)
+#define JITTER_E7           270             // ~3 m of latitude
+#define WALK_E7_PER_S       126             // 1.4 m/s to the east at this latitude
+#define STILL_CMS           10
+#define WALK_CMS            140
+#define FIX_3D              1
+
+// Same jitter on every run
+static uint32_t rand_state;
+
+static int32_t jitter(void)
+{
+    rand_state = rand_state * 1103515245u + 12345u;
+    return (int32_t)((rand_state >> 16) % (2 * JITTER_E7 + 1)) - JITTER_E7;
+}
+
+static int64_t isqrt64(int64_t value)
+{
+    int64_t root = 0;
+
+    while ((root + 1) * (root + 1) <= value) {
+        root++;
+    }
+    return root;
+}
+
+static void gnss_filter_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    gnss_filter_reset();
+    gnss_filter_set_motion_hint(false);
+    rand_state = 1;
+}
+
+// A still receiver is smoothed at the real cadence, not restarted on every fix
+ZTEST(gnss_filter, test_still_jitter_is_smoothed)
+{
+    const int warmup = 30;
+    const int fixes = 60;
+    int64_t raw_sq = 0;
+    int64_t filtered_sq = 0;
+    int published = 0;
+
+    for (int i = 0; i < fixes; i++) {
+        int32_t raw_lat = BASE_LAT + jitter();
+        int32_t raw_lon = BASE_LON + jitter();
+        int32_t lat = raw_lat;
+        int32_t lon = raw_lon;
+
+        published += gnss_filter_update(&lat, &lon, 1000 + i * CADENCE_MS, STILL_CMS, FIX_3D);
+
+        if (i >= warmup) {
+            raw_sq += (int64_t)(raw_lat - BASE_LAT) * (raw_lat - BASE_LAT);
+            filtered_sq += (int64_t)(lat - BASE_LAT) * (lat - BASE_LAT);
+        }
+    }
+
+    int64_t raw_rms = isqrt64(raw_sq / (fixes - warmup));
+    int64_t filtered_rms = isqrt64(filtered_sq / (fixes - warmup));
+
+    TC_PRINT("still: raw rms %lld, filtered rms %lld (1e-7 deg), %d published\n",
+             raw_rms, filtered_rms, published);
+    zassert_true(filtered_rms * 3 < raw_rms, "jitter not smoothed");
+    // Only the first fix and the republications after the silence timeout
+    zassert_equal(published, 1 + (fixes - 1) / DIV_ROUND_UP(
+                      CONFIG_PARSER_GNSS_FILTER_MAX_SILENCE_S * MSEC_PER_SEC, CADENCE_MS),
+                  "jitter inside the radius was published");
+}
+
+// A walk at the real cadence is followed and every step leaves the radius
+ZTEST(gnss_filter, test_walk_is_tracked)
+{
+    const int warmup = 3;
+    const int fixes = 20;
+    int32_t worst = 0;
+    int published = 0;
+
+    for (int i = 0; i < fixes; i++) {
+        uint32_t timestamp = 1000 + i * CADENCE_MS;
+        int32_t true_lon = BASE_LON + (int32_t)((int64_t)WALK_E7_PER_S * i * CADENCE_MS / 1000);
+        int32_t lat = BASE_LAT + jitter();
+        int32_t lon = true_lon + jitter();
+
+        published += gnss_filter_update(&lat, &lon, timestamp, WALK_CMS, FIX_3D);
+
+        if (i >= warmup) {
+            worst = MAX(worst, abs(lon - true_lon));
+        }
+    }
+
+    TC_PRINT("walk: worst error %d (1e-7 deg), %d of %d published\n", worst, published, fixes);
+    zassert_true(worst < 3 * JITTER_E7 / 2, "walk not tracked");
+    zassert_equal(published, fixes, "steps of 16 m were suppressed");
+}
+
+// A gap longer than CONFIG_PARSER_GNSS_FILTER_MAX_GAP_S restarts at the raw fix
+ZTEST(gnss_filter, test_long_gap_restarts)
+{
+    uint32_t timestamp = 1000;
+    int32_t lat;
+    int32_t lon;
+
+    for (int i = 0; i < 10; i++, timestamp += CADENCE_MS) {
+        lat = BASE_LAT + jitter();
+        lon = BASE_LON + jitter();
+        (void)gnss_filter_update(&lat, &lon, timestamp, STILL_CMS, FIX_3D);
+    }
+
+    timestamp += CONFIG_PARSER_GNSS_FILTER_MAX_GAP_S * MSEC_PER_SEC;
+    lat = BASE_LAT + 5000;
+    lon = BASE_LON + 5000;
+    zassert_true(gnss_filter_update(&lat, &lon, timestamp, STILL_CMS, FIX_3D),
+                 "fix after the gap not published");
+    zassert_equal(lat, BASE_LAT + 5000, "latitude not restarted");
+    zassert_equal(lon, BASE_LON + 5000, "longitude not restarted");
+}
+
+ZTEST_SUITE(gnss_filter, NULL, NULL, gnss_filter_before, NULL, NULL);
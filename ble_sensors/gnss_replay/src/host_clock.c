@@ -0,0 +1,15 @@
+/*
+ * Runs on the native_simulator runner side, outside of the Zephyr image,
+ * so the benchmark can read the host monotonic clock.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t gnss_replay_host_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
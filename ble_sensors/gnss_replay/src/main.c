@@ -0,0 +1,273 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/drivers/serial/uart_emul.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include "parser_gnss.h"
+#include "sensor_common.h"
+
+#ifdef CONFIG_ARCH_POSIX
+// Implemented in host_clock.c, on the native simulator runner side
+extern uint64_t gnss_replay_host_time_ns(void);
+#endif // CONFIG_ARCH_POSIX
+
+LOG_MODULE_REGISTER(gnss_replay, LOG_LEVEL_INF);
+
+#define UART_NODE DT_NODELABEL(arduino_serial)
+static const struct device *uart = DEVICE_DT_GET(UART_NODE);
+
+// Logs generated by scripts/gnss_log_gen.py and embedded at build time
+static const uint8_t nmea_log[] = {
+#include "nmea_walk.nmea.inc"
+};
+
+static const uint8_t ubx_log[] = {
+#include "ubx_walk.ubx.inc"
+};
+
+#define UBX_FRAME_LEN       100     // NAV-PVT: 6 byte header + 92 byte payload + 2 byte checksum
+#define UBX_PAYLOAD_OFS     6
+
+// Valid fix appended after each faulty input, the parser must recover on it
+static const char sentinel_gga[] =
+    "$GNGGA,120000.00,0307.1400,S,06001.3020,W,1,12,0.8,35.0,M,-12.0,M,,*6A\r\n";
+#define SENTINEL_LAT        (-31190000)
+#define SENTINEL_LON        (-600217000)
+#define COORD_TOLERANCE     1       // double -> 1e-7 degree truncation
+
+/* ---------- Feeder ---------- */
+
+struct feed_job {
+    const uint8_t *data;
+    size_t len;
+};
+
+K_MSGQ_DEFINE(feed_msgq, sizeof(struct feed_job), 4, 4);
+K_SEM_DEFINE(feed_done, 0, 4);
+
+// Push @p len bytes into the emulated UART, paced to the configured line rate
+static void feed_bytes(const uint8_t *data, size_t len) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t chunk = MIN(CONFIG_GNSS_REPLAY_CHUNK_SIZE, len - pos);
+        uint32_t put = uart_emul_put_rx_data(uart, &data[pos], chunk);
+
+        pos += put;
+
+        if (CONFIG_GNSS_REPLAY_SPEEDUP > 0) {
+            // 10 bits per byte on the wire (start + 8 data + stop)
+            k_sleep(K_USEC((uint64_t)put * 10 * USEC_PER_SEC /
+                           CONFIG_GNSS_REPLAY_BAUDRATE / CONFIG_GNSS_REPLAY_SPEEDUP));
+        } else if (put < chunk) {
+            // RX FIFO full, let the parser drain it
+            k_sleep(K_TICKS(1));
+        }
+    }
+}
+
+static void feeder_thread(void) {
+    struct feed_job job;
+
+    while (1) {
+        k_msgq_get(&feed_msgq, &job, K_FOREVER);
+        feed_bytes(job.data, job.len);
+        k_sem_give(&feed_done);
+    }
+}
+
+K_THREAD_DEFINE(feeder_thread_id, 1024, feeder_thread, NULL, NULL, NULL, 8, 0, 0);
+
+static void feed(const void *data, size_t len) {
+    struct feed_job job = { .data = data, .len = len };
+
+    k_msgq_put(&feed_msgq, &job, K_FOREVER);
+}
+
+static int32_t gnss_lat(const sensor_data_t *data) {
+    return ((int32_t)data->values[1] << 16) | (data->values[2] & 0xFFFF);
+}
+
+static int32_t gnss_lon(const sensor_data_t *data) {
+    return ((int32_t)data->values[3] << 16) | (data->values[4] & 0xFFFF);
+}
+
+/* ---------- Faulty input ---------- */
+
+// Expected counter deltas for one faulty input followed by the sentinel
+struct replay_case {
+    const char *name;
+    const uint8_t *data;
+    size_t len;
+    uint32_t checksum_errors;
+    uint32_t malformed;
+    uint32_t fixes;
+    int32_t lat;            // Position expected from the last fix
+    int32_t lon;
+    bool sentinel;
+};
+
+static const char bad_checksum[] =
+    "$GNGGA,120000.00,0307.1400,S,06001.3020,W,1,12,0.8,35.0,M,-12.0,M,,*6B\r\n";
+static const char truncated[] =
+    "$GNGGA,120000.00,0307.1400,S,060";
+static const char no_asterisk[] =
+    "$GNGGA,120000.00,0307.1400,S,06001.3020,W,1,12,0.8,35.0,M,-12.0,M,,\r\n";
+static const char no_fix[] =
+    "$GNGGA,120001.00,,,,,0,00,99.99,,,,,,*7A\r\n";
+
+static char overlong[NMEA_BUFFER_SIZE + 48];
+static uint8_t ubx_corrupt[UBX_FRAME_LEN];
+static uint8_t ubx_truncated[UBX_FRAME_LEN / 2 + 100];
+
+static void check_case(const struct replay_case *tc) {
+    struct parser_gnss_stats stats;
+    sensor_data_t data = {0};
+    int jobs = 1;
+
+    uart_emul_flush_rx_data(uart);
+    parser_gnss_reset_stats();
+
+    feed(tc->data, tc->len);
+    if (tc->sentinel) {
+        feed(sentinel_gga, strlen(sentinel_gga));
+        jobs++;
+    }
+
+    int err = acquire_gnss_fix(&data);
+
+    while (jobs--) {
+        k_sem_take(&feed_done, K_FOREVER);
+    }
+    // Let the parser thread empty its queue before sampling the counters
+    k_msleep(10);
+    parser_gnss_get_stats(&stats);
+
+    LOG_INF("%-22s err %d | fixes %u | checksum %u | malformed %u | lat %d lon %d",
+            tc->name, err, stats.fixes, stats.checksum_errors, stats.malformed,
+            gnss_lat(&data), gnss_lon(&data));
+
+    zassert_ok(err, "%s: no fix", tc->name);
+    zassert_equal(stats.fixes, tc->fixes, "%s: fixes", tc->name);
+    zassert_equal(stats.checksum_errors, tc->checksum_errors, "%s: checksum errors", tc->name);
+    zassert_equal(stats.malformed, tc->malformed, "%s: malformed", tc->name);
+    zassert_within(gnss_lat(&data), tc->lat, COORD_TOLERANCE, "%s: latitude", tc->name);
+    zassert_within(gnss_lon(&data), tc->lon, COORD_TOLERANCE, "%s: longitude", tc->name);
+}
+
+#define FAULT_CASE(_name, _data, _len, _checksum, _malformed) \
+    check_case(&(const struct replay_case) { \
+        _name, (const uint8_t *)(_data), (_len), (_checksum), (_malformed), 1, \
+        SENTINEL_LAT, SENTINEL_LON, true })
+
+ZTEST(gnss_replay, test_nmea_bad_checksum) {
+    FAULT_CASE("nmea bad checksum", bad_checksum, strlen(bad_checksum), 1, 0);
+}
+
+ZTEST(gnss_replay, test_nmea_truncated) {
+    FAULT_CASE("nmea truncated", truncated, strlen(truncated), 0, 1);
+}
+
+ZTEST(gnss_replay, test_nmea_missing_checksum) {
+    FAULT_CASE("nmea missing checksum", no_asterisk, strlen(no_asterisk), 0, 1);
+}
+
+ZTEST(gnss_replay, test_nmea_no_fix) {
+    FAULT_CASE("nmea no fix", no_fix, strlen(no_fix), 0, 0);
+}
+
+ZTEST(gnss_replay, test_nmea_overlong) {
+    FAULT_CASE("nmea overlong", overlong, sizeof(overlong), 0, 1);
+}
+
+ZTEST(gnss_replay, test_ubx_bad_checksum) {
+    FAULT_CASE("ubx bad checksum", ubx_corrupt, sizeof(ubx_corrupt), 1, 0);
+}
+
+// The frame length comes from the header, so the noise completes it
+ZTEST(gnss_replay, test_ubx_truncated) {
+    FAULT_CASE("ubx truncated", ubx_truncated, sizeof(ubx_truncated), 1, 0);
+}
+
+ZTEST(gnss_replay, test_ubx_nav_pvt) {
+    check_case(&(const struct replay_case) {
+        "ubx nav-pvt", ubx_log, UBX_FRAME_LEN, 0, 0, 1,
+        (int32_t)sys_get_le32(&ubx_log[UBX_PAYLOAD_OFS + 28]),
+        (int32_t)sys_get_le32(&ubx_log[UBX_PAYLOAD_OFS + 24]), false });
+}
+
+/* ---------- Benchmark ---------- */
+
+// Only the parse calls are timed (parser_gnss_set_clock), not the feeder pacing
+static void replay(const char *name, const uint8_t *log, size_t len) {
+    struct parser_gnss_stats stats;
+    sensor_data_t data;
+    uint32_t acquired = 0;
+
+    uart_emul_flush_rx_data(uart);
+    parser_gnss_reset_stats();
+
+    feed(log, len);
+
+    // The log is exhausted once no fix arrives within the parser timeout
+    while (acquire_gnss_fix(&data) == 0) {
+        acquired++;
+    }
+    k_sem_take(&feed_done, K_FOREVER);
+    parser_gnss_get_stats(&stats);
+
+    uint32_t frames = stats.nmea_sentences + stats.ubx_frames;
+
+    LOG_INF("--- Replay %s (speedup %d) ---", name, CONFIG_GNSS_REPLAY_SPEEDUP);
+    LOG_INF("bytes %u | frames %u | fixes %u (acquired %u) | checksum %u | malformed %u | dropped %u",
+            stats.bytes, frames, stats.fixes, acquired,
+            stats.checksum_errors, stats.malformed, stats.dropped);
+    if (frames > 0 && stats.process_ns > 0) {
+        LOG_INF("parse %llu ns/frame | %llu bytes/s",
+                stats.process_ns / frames,
+                (uint64_t)stats.bytes * NSEC_PER_SEC / stats.process_ns);
+    }
+
+    zassert_true(stats.fixes > 0, "%s: no fix decoded", name);
+    zassert_equal(stats.checksum_errors, 0, "%s: checksum errors", name);
+    zassert_equal(stats.malformed, 0, "%s: malformed input", name);
+    zassert_equal(stats.dropped, 0, "%s: frames dropped", name);
+}
+
+ZTEST(gnss_replay, test_replay_nmea) {
+    replay("NMEA", nmea_log, sizeof(nmea_log));
+}
+
+ZTEST(gnss_replay, test_replay_ubx) {
+    replay("UBX", ubx_log, sizeof(ubx_log));
+}
+
+static void *gnss_replay_setup(void) {
+    zassert_true(device_is_ready(uart), "Emulated UART not ready");
+    zassert_ok(parser_gnss_init(), "GNSS Initialization Failed!");
+
+#ifdef CONFIG_ARCH_POSIX
+    // The kernel clock of native_sim does not advance while the parser runs
+    parser_gnss_set_clock(gnss_replay_host_time_ns);
+#endif // CONFIG_ARCH_POSIX
+
+    // Sentence longer than the parser buffer
+    overlong[0] = '$';
+    memset(&overlong[1], 'A', sizeof(overlong) - 3);
+    overlong[sizeof(overlong) - 2] = '\r';
+    overlong[sizeof(overlong) - 1] = '\n';
+
+    // First NAV-PVT of the log with a flipped payload bit
+    memcpy(ubx_corrupt, ubx_log, UBX_FRAME_LEN);
+    ubx_corrupt[UBX_PAYLOAD_OFS + 28] ^= 0x01;
+
+    // Half a NAV-PVT followed by line noise
+    memset(ubx_truncated, 0, sizeof(ubx_truncated));
+    memcpy(ubx_truncated, ubx_log, UBX_FRAME_LEN / 2);
+
+    return NULL;
+}
+
+ZTEST_SUITE(gnss_replay, NULL, gnss_replay_setup, NULL, NULL, NULL);
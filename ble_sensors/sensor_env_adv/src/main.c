@@ -14,6 +14,7 @@
 
 #include "sensor_common.h"
 #include "sensor_ble.h"
+#include "sensor_sampler.h"
 #ifdef CONFIG_SENSOR_BLE_SERVICE
 #include "sensor_ble_service.h"
 #endif // CONFIG_SENSOR_BLE_SERVICE
@@ -33,18 +34,10 @@ static const struct device *init_sensor(void)
 	 return dev;
  }
  
-static int read_sensor_data(const struct device *sensor, sensor_data_t *data) {
+// Runs right after the fetch, on the sampler work queue
+static int convert_sensor_data(const struct device *sensor, sensor_data_t *data) {
     struct sensor_value pressure, temp;
 
-    // Get Timestamp
-    uint32_t timestamp = k_uptime_get_32();
-
-    // Fetch sensor data
-    if (sensor_sample_fetch(sensor) < 0) {
-        LOG_ERR("Failed to fetch sensor sample");
-        return -1;  // Return error code
-    }
-
     // Read pressure and temperature values
     if (sensor_channel_get(sensor, SENSOR_CHAN_PRESS, &pressure) < 0 ||
         sensor_channel_get(sensor, SENSOR_CHAN_DIE_TEMP, &temp) < 0) {
@@ -59,14 +52,21 @@ static int read_sensor_data(const struct device *sensor, sensor_data_t *data) {
     // Populate sensor_data_t structure
     data->company_id = COMPANY_ID;
     data->type = SENSOR_TYPE_ENVIRONMENTAL;
-    data->timestamp = timestamp;
     data->values[0] = (int16_t)(sensor_value_to_double(&temp) * TEMP_SCALING_FACTOR);
     data->values[1] = (int16_t)(sensor_value_to_double(&pressure) * PRESSURE_SCALING_FACTOR);
 
     return 0;  // Return success
 }
  
- /* Main Function */
+static k_timeout_t read_interval(void) {
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+    return K_MSEC(sensor_config_sample_period_ms());
+#else
+    return SENSOR_READ_INTERVAL;
+#endif // CONFIG_SENSOR_BLE_SERVICE
+}
+
+/* Main Function */
 int main(void) {
 	sensor_data_t data;
     
@@ -92,13 +92,22 @@ int main(void) {
         return -1;  // Exit if the sensor is not found
     }
 
+    if (sensor_sampler_init(sensor, convert_sensor_data, read_interval()) != 0) {
+        LOG_ERR("Failed to start sensor sampler");
+        return -1;
+    }
+
 	while (1) {
-		// Read sensor data
-        if (read_sensor_data(sensor, &data) == 0) {
+        // Picks up interval changes written over GATT
+        sensor_sampler_set_period(read_interval());
+
+		// Sleep until the sampler has a new reading
+        if (sensor_sampler_get(&data, K_FOREVER) == 0) {
             // Process the sensor data
 			sensor_data_print(&data);
 			LOG_HEXDUMP_DBG(&data, sizeof(sensor_data_t), "Sensor Data");
 			sensor_data_adv_update(&data);
+            sensor_sampler_published();
 #ifdef CONFIG_SENSOR_BLE_SERVICE
             send_sensor_data_notification(data);
 #endif // CONFIG_SENSOR_BLE_SERVICE
@@ -106,11 +115,6 @@ int main(void) {
 		} else {
 		  LOG_ERR("Failed to read sensor data");
 		}
-#ifdef CONFIG_SENSOR_BLE_SERVICE
-        k_sleep(K_SECONDS(sensor_interval_var)); 
-#else
-        k_sleep(SENSOR_READ_INTERVAL);
-#endif // CONFIG_SENSOR_BLE_SERVICE
     }
     return 0;
 }
\ No newline at end of file
@@ -36,18 +36,21 @@ int main(void) {
     }
 
     while (1) {
-        if (acquire_gnss_fix(&data) == 0) {
+        err = acquire_gnss_fix(&data);
+        if (err == 0) {
             sensor_data_print(&data);
             sensor_data_adv_update(&data);
 #ifdef CONFIG_SENSOR_BLE_SERVICE
             send_sensor_data_notification(data);
 #endif // CONFIG_SENSOR_BLE_SERVICE
 
+		} else if (err == -EALREADY) {
+            LOG_DBG("GNSS fix inside publish radius, update suppressed");
 		} else {
 		  LOG_ERR("Failed to read sensor data");
 		}
 #ifdef CONFIG_SENSOR_BLE_SERVICE
-        k_sleep(K_SECONDS(sensor_interval_var)); 
+        k_sleep(K_MSEC(sensor_config_sample_period_ms()));
 #else
         k_sleep(SENSOR_READ_INTERVAL);
 #endif // CONFIG_SENSOR_BLE_SERVICE
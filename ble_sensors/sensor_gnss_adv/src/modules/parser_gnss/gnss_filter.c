@@ -0,0 +1,156 @@
+#include "gnss_filter.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_DECLARE(sensor_gnss, CONFIG_PARSER_GNSS_LOG_LEVEL);
+
+// Filter state is kept in Q8 on top of the 1e-7 degree fixed-point coordinates
+#define FILTER_Q            8
+#define GAIN_ONE            256     // Gains are expressed in 1/256
+#define MM_PER_E7_DEG_X100  1113    // 1e-7 degree of latitude ~= 11.13 mm
+
+// cos(latitude) in Q15, 5 degree steps from 0 to 90 degrees
+static const uint16_t cos_q15_table[] = {
+    32767, 32643, 32270, 31651, 30792, 29698, 28378, 26842, 25102, 23170,
+    21063, 18795, 16384, 13848, 11207, 8481, 5690, 2856, 0,
+};
+#define COS_TABLE_STEP_E7   50000000    // 5 degrees in 1e-7 degrees
+
+static bool initialized;
+static volatile bool motion_hint;
+
+static int64_t pos_lat_q;   // Filtered latitude, 1e-7 deg << FILTER_Q
+static int64_t pos_lon_q;   // Filtered longitude, 1e-7 deg << FILTER_Q
+static int64_t vel_lat_q;   // Latitude rate, 1e-7 deg/s << FILTER_Q
+static int64_t vel_lon_q;   // Longitude rate, 1e-7 deg/s << FILTER_Q
+static uint32_t last_timestamp;
+
+static int32_t published_lat;
+static int32_t published_lon;
+static int16_t published_fix;
+static uint32_t published_timestamp;
+
+static uint32_t cos_lat_q15(int32_t lat)
+{
+    uint32_t abs_lat = (lat < 0) ? -(int64_t)lat : lat;
+    uint32_t idx = abs_lat / COS_TABLE_STEP_E7;
+
+    if (idx >= ARRAY_SIZE(cos_q15_table) - 1) {
+        return 0;
+    }
+
+    uint32_t frac = abs_lat % COS_TABLE_STEP_E7;
+    int32_t c0 = cos_q15_table[idx];
+    int32_t c1 = cos_q15_table[idx + 1];
+
+    return c0 + (int32_t)(((int64_t)(c1 - c0) * frac) / COS_TABLE_STEP_E7);
+}
+
+// Squared planar distance in mm² between two positions (equirectangular approximation)
+static int64_t distance_sq_mm(int32_t lat_a, int32_t lon_a, int32_t lat_b, int32_t lon_b)
+{
+    int64_t dy = ((int64_t)lat_a - lat_b) * MM_PER_E7_DEG_X100 / 100;
+    int64_t dx = ((int64_t)lon_a - lon_b) * MM_PER_E7_DEG_X100 / 100;
+
+    dx = (dx * cos_lat_q15(lat_a)) >> 15;
+
+    return dx * dx + dy * dy;
+}
+
+static int32_t q_to_e7(int64_t value_q)
+{
+    return (int32_t)((value_q + (1 << (FILTER_Q - 1))) >> FILTER_Q);
+}
+
+void gnss_filter_reset(void)
+{
+    initialized = false;
+}
+
+void gnss_filter_set_motion_hint(bool moving)
+{
+    motion_hint = moving;
+}
+
+bool gnss_filter_update(int32_t *lat, int32_t *lon, uint32_t timestamp_ms,
+                        int32_t speed_cms, int16_t fix_quality)
+{
+    const int64_t radius_mm = (int64_t)CONFIG_PARSER_GNSS_FILTER_RADIUS_M * 1000;
+    uint32_t dt_ms = timestamp_ms - last_timestamp;
+
+    if (!initialized) {
+        pos_lat_q = (int64_t)*lat << FILTER_Q;
+        pos_lon_q = (int64_t)*lon << FILTER_Q;
+        vel_lat_q = 0;
+        vel_lon_q = 0;
+        last_timestamp = timestamp_ms;
+
+        published_lat = *lat;
+        published_lon = *lon;
+        published_fix = fix_quality;
+        published_timestamp = timestamp_ms;
+        initialized = true;
+        return true;
+    }
+    last_timestamp = timestamp_ms;
+
+    if (dt_ms == 0 || dt_ms > CONFIG_PARSER_GNSS_FILTER_MAX_GAP_S * MSEC_PER_SEC) {
+        // Any velocity estimate is stale, restart the prediction at the raw fix
+        pos_lat_q = (int64_t)*lat << FILTER_Q;
+        pos_lon_q = (int64_t)*lon << FILTER_Q;
+        vel_lat_q = 0;
+        vel_lon_q = 0;
+        dt_ms = 0;
+    }
+
+    // Process noise is gated by the motion state: while stationary the
+    // filter trusts its own estimate and drops the velocity term.
+    bool moving = motion_hint ||
+                  (speed_cms >= CONFIG_PARSER_GNSS_FILTER_SPEED_GATE_CMS);
+    int32_t alpha = moving ? CONFIG_PARSER_GNSS_FILTER_ALPHA_MOVING
+                           : CONFIG_PARSER_GNSS_FILTER_ALPHA_STILL;
+    int32_t beta = moving ? CONFIG_PARSER_GNSS_FILTER_BETA_MOVING : 0;
+
+    if (!moving) {
+        vel_lat_q = 0;
+        vel_lon_q = 0;
+    }
+
+    if (dt_ms > 0) {
+        // Predict
+        pos_lat_q += vel_lat_q * dt_ms / 1000;
+        pos_lon_q += vel_lon_q * dt_ms / 1000;
+
+        // Correct
+        int64_t res_lat = ((int64_t)*lat << FILTER_Q) - pos_lat_q;
+        int64_t res_lon = ((int64_t)*lon << FILTER_Q) - pos_lon_q;
+
+        pos_lat_q += res_lat * alpha / GAIN_ONE;
+        pos_lon_q += res_lon * alpha / GAIN_ONE;
+        vel_lat_q += res_lat * beta * 1000 / ((int64_t)GAIN_ONE * dt_ms);
+        vel_lon_q += res_lon * beta * 1000 / ((int64_t)GAIN_ONE * dt_ms);
+    }
+
+    *lat = q_to_e7(pos_lat_q);
+    *lon = q_to_e7(pos_lon_q);
+
+    int64_t dist_sq = distance_sq_mm(*lat, *lon, published_lat, published_lon);
+    bool publish = (dist_sq >= radius_mm * radius_mm) ||
+                   (fix_quality != published_fix) ||
+                   (timestamp_ms - published_timestamp >=
+                    CONFIG_PARSER_GNSS_FILTER_MAX_SILENCE_S * MSEC_PER_SEC);
+
+    LOG_DBG("Filter: %s | speed %d cm/s | moved %lld mm^2 | %s",
+            moving ? "MOVING" : "STILL", speed_cms, dist_sq,
+            publish ? "publish" : "suppress");
+
+    if (publish) {
+        published_lat = *lat;
+        published_lon = *lon;
+        published_fix = fix_quality;
+        published_timestamp = timestamp_ms;
+    }
+
+    return publish;
+}
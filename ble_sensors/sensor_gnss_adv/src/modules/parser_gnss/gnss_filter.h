@@ -0,0 +1,40 @@
+#ifndef GNSS_FILTER_H
+#define GNSS_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Reset the filter state. The next fix is always published.
+ */
+void gnss_filter_reset(void);
+
+/**
+ * @brief Feed an external motion hint (e.g. MOVING/STILL from an IMU).
+ *
+ * The hint is OR-ed with the GNSS speed gate when selecting the filter gains.
+ *
+ * @param moving true if the worker is known to be moving
+ */
+void gnss_filter_set_motion_hint(bool moving);
+
+/**
+ * @brief Run one alpha-beta update over a raw fix.
+ *
+ * Coordinates are in 1e-7 degrees, as carried by SENSOR_TYPE_GNSS.
+ * On return @p lat and @p lon hold the filtered position.
+ *
+ * @param lat Latitude in 1e-7 degrees (in/out)
+ * @param lon Longitude in 1e-7 degrees (in/out)
+ * @param timestamp_ms Uptime of the fix in milliseconds
+ * @param speed_cms Ground speed in cm/s, or a negative value if unknown
+ * @param fix_quality GGA fix quality of the raw fix
+ *
+ * @return true if the filtered position left the publish radius (or the
+ *         fix quality changed / the silence timeout expired) and should be
+ *         published, false otherwise.
+ */
+bool gnss_filter_update(int32_t *lat, int32_t *lon, uint32_t timestamp_ms,
+                        int32_t speed_cms, int16_t fix_quality);
+
+#endif // GNSS_FILTER_H
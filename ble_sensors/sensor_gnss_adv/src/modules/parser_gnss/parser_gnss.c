@@ -1,8 +1,14 @@
 #include "parser_gnss.h"
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef CONFIG_PARSER_GNSS_FILTER
+#include "gnss_filter.h"
+#endif // CONFIG_PARSER_GNSS_FILTER
+
 LOG_MODULE_REGISTER(sensor_gnss, CONFIG_PARSER_GNSS_LOG_LEVEL);
 
 // Semaphores
@@ -16,97 +22,235 @@ static const struct device *uart = DEVICE_DT_GET(UART_NODE);
 
 static sensor_data_t *global_sensor_data = {0};
 
+// Last ground speed reported by RMC or NAV-PVT, in cm/s (-1 = unknown)
+static int32_t gnss_speed_cms = -1;
+
+// UBX framing: sync chars, 4 byte header (class, id, length) and 2 checksum bytes
+#define UBX_SYNC_1          0xB5
+#define UBX_SYNC_2          0x62
+#define UBX_HEADER_LEN      6
+#define UBX_CHECKSUM_LEN    2
+#define UBX_CLASS_NAV       0x01
+#define UBX_ID_NAV_PVT      0x07
+#define UBX_NAV_PVT_LEN     92
+
+// Counters updated from the UART ISR
+static atomic_t rx_bytes;
+static atomic_t rx_malformed;
+static atomic_t rx_dropped;
+
+// Counters updated from the GNSS thread
+static struct parser_gnss_stats thread_stats;
+
+static uint64_t kernel_clock_ns(void) {
+#ifdef CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+    return k_cyc_to_ns_floor64(k_cycle_get_64());
+#else
+    return k_ticks_to_ns_floor64(k_uptime_ticks());
+#endif // CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+}
+
+static parser_gnss_clock_t parse_clock_ns = kernel_clock_ns;
+
 double encode_nmea_to_double(const char *nmea_coord, char direction) {
     if (nmea_coord == NULL) {
         return 0.0;
     }
+    // NMEA coordinates are ddmm.mmmm (latitude) or dddmm.mmmm (longitude)
     double raw_value = atof(nmea_coord);
-    int degrees;
-    double minutes;
-    double decimal_degrees;
-    if (strlen(nmea_coord) > 9) {
-        degrees = (int)(raw_value / 100);
-        minutes = raw_value - (degrees * 100);
-    } else {
-        degrees = (int)(raw_value / 100);
-        minutes = raw_value - (degrees * 100);
-    }
-    decimal_degrees = degrees + (minutes / 100.0);
+    int degrees = (int)(raw_value / 100);
+    double minutes = raw_value - (degrees * 100);
+    double decimal_degrees = degrees + (minutes / 60.0);
+
     if (direction == 'S' || direction == 'W') {
         decimal_degrees = -decimal_degrees;
     }
     return decimal_degrees;
 }
 
-static void process_nmea_sentence(char *nmea, sensor_data_t *sensor_data) {
-    if (strstr(nmea, "$GNGGA") == NULL) {
+/*
+ * Validate the "*hh" checksum of a NUL terminated NMEA sentence.
+ * Returns 0 if valid, -EBADMSG on checksum mismatch and -EINVAL if the
+ * sentence is not framed as $...*hh.
+ */
+static int nmea_validate(const char *nmea) {
+    uint8_t sum = 0;
+    const char *p = nmea + 1;
+
+    if (nmea[0] != '$') {
+        return -EINVAL;
+    }
+
+    while (*p != '\0' && *p != '*') {
+        sum ^= (uint8_t)*p++;
+    }
+
+    if (*p != '*') {
+        return -EINVAL;
+    }
+
+    char hex[3] = { p[1], p[2], '\0' };
+    char *end;
+    long expected = strtol(hex, &end, 16);
+
+    if (end != &hex[2]) {
+        return -EINVAL;
+    }
+
+    return (expected == sum) ? 0 : -EBADMSG;
+}
+
+/*
+ * Split the next comma separated field in place. Unlike strtok(), empty
+ * fields are preserved so the field index always matches the NMEA layout.
+ */
+static char *nmea_next_field(char **cursor) {
+    char *start = *cursor;
+
+    if (start == NULL) {
+        return NULL;
+    }
+
+    char *end = strpbrk(start, ",*");
+    if (end == NULL) {
+        *cursor = NULL;
+    } else {
+        *cursor = (*end == ',') ? end + 1 : NULL;
+        *end = '\0';
+    }
+    return start;
+}
+
+static void publish_fix(sensor_data_t *sensor_data, int16_t fix_quality,
+                        int32_t lat_fixed, int32_t lon_fixed, int32_t alt_fixed) {
+    if (sensor_data == NULL) {
         return;
     }
 
-    char *token;
-    int field = 0;
-    char *utc_time = NULL;
-    char *lat_str = NULL, *lat_dir = NULL;
-    char *lon_str = NULL, *lon_dir = NULL;
-    char *alt_str = NULL;
-    int fix_quality = 0;
-
-    token = strtok(nmea, ",");
-    while (token != NULL) {
-        switch (field) {
-        case 1:
-            utc_time = token;
-            break;
-        case 2:
-            lat_str = token;
-            break;
-        case 3:
-            lat_dir = token;
-            break;
-        case 4:
-            lon_str = token;
-            break;
-        case 5:
-            lon_dir = token;
-            break;
-        case 6:
-            fix_quality = atoi(token);
-            break;
-        case 9:
-            alt_str = token;
-            break;
-        default:
-            break;
-        }
-        token = strtok(NULL, ",");
-        field++;
+    sensor_data->company_id = COMPANY_ID;
+    sensor_data->type = SENSOR_TYPE_GNSS;
+    sensor_data->timestamp = k_uptime_get_32();
+    sensor_data->values[0] = fix_quality;
+
+    sensor_data->values[1] = (int16_t)(lat_fixed >> 16);
+    sensor_data->values[2] = (int16_t)(lat_fixed & 0xFFFF);
+
+    sensor_data->values[3] = (int16_t)(lon_fixed >> 16);
+    sensor_data->values[4] = (int16_t)(lon_fixed & 0xFFFF);
+
+    sensor_data->values[5] = (int16_t)(alt_fixed >> 16);
+    sensor_data->values[6] = (int16_t)(alt_fixed & 0xFFFF);
+
+    thread_stats.fixes++;
+    k_sem_give(&gnss_fix_done);
+}
+
+// $GNRMC field 2 is the status (A/V), field 7 the speed over ground in knots
+static void process_rmc_sentence(char *nmea) {
+    char *cursor = nmea;
+    char *field[8] = {0};
+
+    for (int i = 0; i < ARRAY_SIZE(field); i++) {
+        field[i] = nmea_next_field(&cursor);
     }
 
-    if (fix_quality > 0 && lat_str && lat_dir && lon_str && lon_dir && alt_str) {
+    if (field[2] && field[2][0] == 'A' && field[7] && field[7][0] != '\0') {
+        // 1 knot = 51.444 cm/s
+        gnss_speed_cms = (int32_t)(atof(field[7]) * 51.444);
+    }
+}
+
+static void process_gga_sentence(char *nmea, sensor_data_t *sensor_data) {
+    char *cursor = nmea;
+    char *field[10] = {0};
+
+    for (int i = 0; i < ARRAY_SIZE(field); i++) {
+        field[i] = nmea_next_field(&cursor);
+    }
+
+    char *lat_str = field[2], *lat_dir = field[3];
+    char *lon_str = field[4], *lon_dir = field[5];
+    char *alt_str = field[9];
+    int fix_quality = field[6] ? atoi(field[6]) : 0;
+
+    if (fix_quality > 0 && lat_str && lat_str[0] && lat_dir && lat_dir[0] &&
+        lon_str && lon_str[0] && lon_dir && lon_dir[0] && alt_str && alt_str[0]) {
         double latitude = encode_nmea_to_double(lat_str, lat_dir[0]);
         double longitude = encode_nmea_to_double(lon_str, lon_dir[0]);
         double altitude = atof(alt_str);
 
-        sensor_data->company_id = COMPANY_ID;
-        sensor_data->type = SENSOR_TYPE_GNSS;
-        sensor_data->timestamp = k_uptime_get_32();
-        sensor_data->values[0] = (int16_t)fix_quality;
+        publish_fix(sensor_data, (int16_t)fix_quality,
+                    (int32_t)(latitude * 1e7),
+                    (int32_t)(longitude * 1e7),
+                    (int32_t)(altitude * 1000.0));
+    } else {
+        LOG_WRN("Sentença NMEA incompleta ou fix inválido.");
+    }
+}
 
-        int32_t lat_fixed = (int32_t)(latitude * 1e7);
-        sensor_data->values[1] = (int16_t)(lat_fixed >> 16);
-        sensor_data->values[2] = (int16_t)(lat_fixed & 0xFFFF);
+static void process_nmea_sentence(char *nmea, sensor_data_t *sensor_data) {
+    int err = nmea_validate(nmea);
 
-        int32_t lon_fixed = (int32_t)(longitude * 1e7);
-        sensor_data->values[3] = (int16_t)(lon_fixed >> 16);
-        sensor_data->values[4] = (int16_t)(lon_fixed & 0xFFFF);
+    if (err == -EBADMSG) {
+        thread_stats.checksum_errors++;
+        LOG_DBG("NMEA checksum error: %s", nmea);
+        return;
+    } else if (err) {
+        thread_stats.malformed++;
+        LOG_DBG("Malformed NMEA sentence: %s", nmea);
+        return;
+    }
+
+    thread_stats.nmea_sentences++;
+
+    if (strncmp(nmea, "$GNRMC,", 7) == 0) {
+        process_rmc_sentence(nmea);
+    } else if (strncmp(nmea, "$GNGGA,", 7) == 0) {
+        process_gga_sentence(nmea, sensor_data);
+    }
+}
+
+static void process_ubx_frame(const uint8_t *frame, sensor_data_t *sensor_data) {
+    uint16_t len = sys_get_le16(&frame[4]);
+    uint8_t ck_a = 0, ck_b = 0;
+
+    // 8-bit Fletcher checksum over class, id, length and payload
+    for (int i = 2; i < UBX_HEADER_LEN + len; i++) {
+        ck_a += frame[i];
+        ck_b += ck_a;
+    }
+
+    if (ck_a != frame[UBX_HEADER_LEN + len] || ck_b != frame[UBX_HEADER_LEN + len + 1]) {
+        thread_stats.checksum_errors++;
+        LOG_DBG("UBX checksum error (class 0x%02x id 0x%02x)", frame[2], frame[3]);
+        return;
+    }
+
+    thread_stats.ubx_frames++;
 
-        int32_t alt_fixed = (int32_t)(altitude * 1000.0);
-        sensor_data->values[5] = (int16_t)(alt_fixed >> 16);
-        sensor_data->values[6] = (int16_t)(alt_fixed & 0xFFFF);
+    if (frame[2] != UBX_CLASS_NAV || frame[3] != UBX_ID_NAV_PVT) {
+        return;
+    }
+
+    if (len != UBX_NAV_PVT_LEN) {
+        thread_stats.malformed++;
+        return;
+    }
+
+    const uint8_t *pvt = &frame[UBX_HEADER_LEN];
+    uint8_t fix_type = pvt[20];
+    uint8_t flags = pvt[21];
+
+    gnss_speed_cms = (int32_t)sys_get_le32(&pvt[60]) / 10;
 
-        k_sem_give(&gnss_fix_done);
+    // Map to GGA fix quality: gnssFixOK with a 2D/3D fix, DGPS if diffSoln
+    if ((flags & BIT(0)) && fix_type >= 2 && fix_type <= 4) {
+        publish_fix(sensor_data, (flags & BIT(1)) ? 2 : 1,
+                    (int32_t)sys_get_le32(&pvt[28]),
+                    (int32_t)sys_get_le32(&pvt[24]),
+                    (int32_t)sys_get_le32(&pvt[36]));
     } else {
-        LOG_WRN("Sentença NMEA incompleta ou fix inválido.");
+        LOG_WRN("UBX NAV-PVT sem fix válido.");
     }
 }
 
@@ -117,13 +261,27 @@ static void gnss_thread(void) {
 
     while (1) {
         if (k_msgq_get(&nmea_msgq, nmea_buffer, K_FOREVER) == 0) {
-            process_nmea_sentence(nmea_buffer, global_sensor_data);
+            uint64_t start = parse_clock_ns();
+
+            if ((uint8_t)nmea_buffer[0] == UBX_SYNC_1) {
+                process_ubx_frame((const uint8_t *)nmea_buffer, global_sensor_data);
+            } else {
+                process_nmea_sentence(nmea_buffer, global_sensor_data);
+            }
+
+            thread_stats.process_ns += parse_clock_ns() - start;
         }
     }
 }
 
 K_THREAD_DEFINE(gnss_thread_id, 1024, gnss_thread, NULL, NULL, NULL, 7, 0, 0);
 
+static void rx_frame_done(char *rx_buf) {
+    if (k_msgq_put(&nmea_msgq, rx_buf, K_NO_WAIT) != 0) {
+        atomic_inc(&rx_dropped);
+    }
+}
+
 static void uart_cb(const struct device *dev, void *user_data) {
     uart_irq_update(dev);
     if (uart_irq_is_pending(dev)) {
@@ -131,17 +289,64 @@ static void uart_cb(const struct device *dev, void *user_data) {
             uint8_t byte;
             static char rx_buf[NMEA_BUFFER_SIZE];
             static int rx_buf_pos = 0;
+            static int ubx_frame_len = 0;
 
             while (uart_irq_rx_ready(dev)) {
-                uart_fifo_read(dev, &byte, 1);
+                if (uart_fifo_read(dev, &byte, 1) != 1) {
+                    break;
+                }
+                atomic_inc(&rx_bytes);
+
+                // Resynchronise on the start of a NMEA sentence or a UBX frame
+                if (byte == '$' || (byte == UBX_SYNC_1 && rx_buf_pos == 0)) {
+                    if (rx_buf_pos > 0 && (uint8_t)rx_buf[0] != UBX_SYNC_1) {
+                        // Previous sentence was cut before its line ending
+                        atomic_inc(&rx_malformed);
+                        rx_buf_pos = 0;
+                    }
+                    if (rx_buf_pos == 0) {
+                        rx_buf[rx_buf_pos++] = byte;
+                        ubx_frame_len = 0;
+                        continue;
+                    }
+                }
+
+                if (rx_buf_pos == 0) {
+                    continue;   // Line endings and noise between frames
+                }
+
+                if ((uint8_t)rx_buf[0] == UBX_SYNC_1) {
+                    rx_buf[rx_buf_pos++] = byte;
+
+                    if (rx_buf_pos == 2 && byte != UBX_SYNC_2) {
+                        atomic_inc(&rx_malformed);
+                        rx_buf_pos = 0;
+                    } else if (rx_buf_pos == UBX_HEADER_LEN) {
+                        ubx_frame_len = UBX_HEADER_LEN + UBX_CHECKSUM_LEN +
+                                        sys_get_le16((uint8_t *)&rx_buf[4]);
+                        if (ubx_frame_len > sizeof(rx_buf)) {
+                            atomic_inc(&rx_malformed);
+                            rx_buf_pos = 0;
+                        }
+                    } else if (ubx_frame_len > 0 && rx_buf_pos == ubx_frame_len) {
+                        rx_frame_done(rx_buf);
+                        rx_buf_pos = 0;
+                    }
+                    continue;
+                }
 
                 if (rx_buf_pos < sizeof(rx_buf) - 1) {
                     rx_buf[rx_buf_pos++] = byte;
+                } else if (byte != '\n') {
+                    // Overlong sentence, drop it and wait for the next '$'
+                    atomic_inc(&rx_malformed);
+                    rx_buf_pos = 0;
+                    continue;
                 }
 
-                if (byte == '\n' && rx_buf_pos > 0) {
+                if (byte == '\n') {
                     rx_buf[rx_buf_pos] = '\0';
-                    k_msgq_put(&nmea_msgq, rx_buf, K_NO_WAIT);
+                    rx_frame_done(rx_buf);
                     rx_buf_pos = 0;
                 }
             }
@@ -175,5 +380,51 @@ int acquire_gnss_fix(sensor_data_t *data) {
     k_sem_give(&gnss_stop_uart_rx);
     uart_irq_rx_disable(uart);
 
+#ifdef CONFIG_PARSER_GNSS_FILTER
+    if (ret == 0) {
+        int32_t lat = ((int32_t)data->values[1] << 16) | (data->values[2] & 0xFFFF);
+        int32_t lon = ((int32_t)data->values[3] << 16) | (data->values[4] & 0xFFFF);
+
+        bool publish = gnss_filter_update(&lat, &lon, data->timestamp,
+                                          gnss_speed_cms, data->values[0]);
+
+        // Replace the raw fix by the filtered position
+        data->values[1] = (int16_t)(lat >> 16);
+        data->values[2] = (int16_t)(lat & 0xFFFF);
+        data->values[3] = (int16_t)(lon >> 16);
+        data->values[4] = (int16_t)(lon & 0xFFFF);
+
+        if (!publish) {
+            return -EALREADY;
+        }
+    }
+#endif // CONFIG_PARSER_GNSS_FILTER
+
     return ret;
+}
+
+void parser_gnss_set_motion_hint(bool moving) {
+#ifdef CONFIG_PARSER_GNSS_FILTER
+    gnss_filter_set_motion_hint(moving);
+#else
+    ARG_UNUSED(moving);
+#endif // CONFIG_PARSER_GNSS_FILTER
+}
+
+void parser_gnss_get_stats(struct parser_gnss_stats *stats) {
+    *stats = thread_stats;
+    stats->bytes = atomic_get(&rx_bytes);
+    stats->malformed += atomic_get(&rx_malformed);
+    stats->dropped = atomic_get(&rx_dropped);
+}
+
+void parser_gnss_reset_stats(void) {
+    memset(&thread_stats, 0, sizeof(thread_stats));
+    atomic_clear(&rx_bytes);
+    atomic_clear(&rx_malformed);
+    atomic_clear(&rx_dropped);
+}
+
+void parser_gnss_set_clock(parser_gnss_clock_t clock_ns) {
+    parse_clock_ns = clock_ns ? clock_ns : kernel_clock_ns;
 }
\ No newline at end of file
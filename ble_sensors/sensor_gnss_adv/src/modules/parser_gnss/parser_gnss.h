@@ -7,10 +7,56 @@
 #include "sensor_common.h"
 
 #define NMEA_BUFFER_SIZE 256  // Buffer for UBX messages
-#define GNSS_FIX_TIMEOUT K_SECONDS(60)  // GNSS timeout period
+#define GNSS_FIX_TIMEOUT K_SECONDS(CONFIG_PARSER_GNSS_FIX_TIMEOUT_S)  // GNSS timeout period
+
+// Parser counters, used to benchmark the parser and to spot bad input
+struct parser_gnss_stats {
+    uint32_t bytes;             // Bytes read from the UART
+    uint32_t nmea_sentences;    // NMEA sentences with a valid checksum
+    uint32_t ubx_frames;        // UBX frames with a valid checksum
+    uint32_t checksum_errors;   // NMEA or UBX frames with a bad checksum
+    uint32_t malformed;         // Truncated, overlong or badly framed input
+    uint32_t dropped;           // Complete frames lost because the queue was full
+    uint32_t fixes;             // Valid fixes decoded (GGA or NAV-PVT)
+    uint64_t process_ns;        // Time spent parsing queued frames, by the parser clock
+};
+
+// Clock timing the parse, in nanoseconds
+typedef uint64_t (*parser_gnss_clock_t)(void);
 
 // Function declarations
 int parser_gnss_init(void);
+
+/**
+ * @brief Wait for a GNSS fix and fill @p data with a SENSOR_TYPE_GNSS sample.
+ *
+ * With CONFIG_PARSER_GNSS_FILTER the position is smoothed and -EALREADY is
+ * returned while the filtered fix stays inside the publish radius.
+ *
+ * @return 0 on a fix to publish, -EALREADY if suppressed by the filter,
+ *         -EAGAIN on timeout.
+ */
 int acquire_gnss_fix(sensor_data_t *data);
 
+/**
+ * @brief Feed the motion state of the worker (e.g. from an IMU) to the filter.
+ */
+void parser_gnss_set_motion_hint(bool moving);
+
+/**
+ * @brief Get a snapshot of the parser counters.
+ */
+void parser_gnss_get_stats(struct parser_gnss_stats *stats);
+
+/**
+ * @brief Clear the parser counters.
+ */
+void parser_gnss_reset_stats(void);
+
+/**
+ * @brief Replace the clock timing the parse, e.g. by the host clock on
+ *        native_sim. NULL restores the kernel clock.
+ */
+void parser_gnss_set_clock(parser_gnss_clock_t clock_ns);
+
 #endif // PARSER_GNSS_H
\ No newline at end of file
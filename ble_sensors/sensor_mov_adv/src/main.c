@@ -12,20 +12,22 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/settings/settings.h>
 
-#include <math.h>
-
 #include "sensor_common.h"
 #include "sensor_ble.h"
+#include "imu_mpu6050.h"
+#include "motion_classifier.h"
+#ifdef CONFIG_ACTIVITY_ENGINE
+#include "activity_engine.h"
+#endif // CONFIG_ACTIVITY_ENGINE
 #ifdef CONFIG_SENSOR_BLE_SERVICE
 #include "sensor_ble_service.h"
 #endif // CONFIG_SENSOR_BLE_SERVICE
+#ifdef CONFIG_IMU_STREAM
+#include "imu_stream.h"
+#endif // CONFIG_IMU_STREAM
 
 
-// Thresholds for detection
-#define ACCEL_THRESHOLD 0.9f      // Acceleration threshold in m/s²
-#define GYRO_THRESHOLD 0.9f       // Gyroscope threshold in rad/s
-#define STANDING_THRESHOLD 8.0f   // Z-axis threshold to consider "standing"
-#define SAMPLE_INTERVAL_MS 500    // Sampling interval in milliseconds
+#define SAMPLE_INTERVAL_MS 500    // Sampling interval in milliseconds (polled mode)
  
 LOG_MODULE_REGISTER(sensor_mov_adv, LOG_LEVEL_INF);
  
@@ -38,10 +40,30 @@ static const struct device *init_sensor(void)
     }
     return dev;
  }
- 
+
+#ifndef CONFIG_ACTIVITY_ENGINE
+static int classify(sensor_data_t *data, uint32_t timestamp) {
+    struct motion_result motion;
+
+    if (motion_classifier_evaluate(&motion) != 0) {
+        return -EAGAIN;
+    }
+
+    // Fill sensor_data_t structure
+    data->company_id = COMPANY_ID;
+    data->type = SENSOR_TYPE_MOTION;
+    data->timestamp = timestamp;
+    data->values[0] = motion.moving ? 1 : 0;
+    data->values[1] = motion.standing ? 1 : 0;
+
+    return 0;
+}
+#endif // CONFIG_ACTIVITY_ENGINE
+
+#ifndef CONFIG_IMU_MPU6050_FIFO
  static int read_sensor_data(const struct device *sensor, sensor_data_t *data) {
     struct sensor_value accel[3], gyro[3];
-    float accel_magnitude, gyro_magnitude;
+    struct imu_sample sample;
     uint32_t timestamp = k_uptime_get_32();
 
     if (sensor_sample_fetch(sensor) < 0) {
@@ -52,37 +74,139 @@ static const struct device *init_sensor(void)
     sensor_channel_get(sensor, SENSOR_CHAN_ACCEL_XYZ, accel);
     sensor_channel_get(sensor, SENSOR_CHAN_GYRO_XYZ, gyro);
 
-    accel_magnitude = sqrtf(
-        powf(sensor_value_to_float(&accel[0]), 2) +
-        powf(sensor_value_to_float(&accel[1]), 2) +
-        powf(sensor_value_to_float(&accel[2]), 2)
-    ) - 9.81f;
+    // Back to raw LSB so the polled and FIFO paths share the same classifier
+    for (int axis = 0; axis < 3; axis++) {
+        sample.accel[axis] = (int16_t)(sensor_value_to_micro(&accel[axis]) *
+                                       imu_mpu6050_accel_lsb_per_g() / SENSOR_G);
+        sample.gyro[axis] = (int16_t)(sensor_value_to_micro(&gyro[axis]) * 180 *
+                                      imu_mpu6050_gyro_lsb_per_10dps() / (SENSOR_PI * 10LL));
+    }
 
-    gyro_magnitude = sqrtf(
-        powf(sensor_value_to_float(&gyro[0]), 2) +
-        powf(sensor_value_to_float(&gyro[1]), 2) +
-        powf(sensor_value_to_float(&gyro[2]), 2)
-    );
+    motion_classifier_push(&sample, 1);
 
-    bool is_moving = (fabsf(accel_magnitude) > ACCEL_THRESHOLD) || 
-                     (gyro_magnitude > GYRO_THRESHOLD);
+    return classify(data, timestamp);
+}
+#endif // CONFIG_IMU_MPU6050_FIFO
 
-    float z_axis = sensor_value_to_float(&accel[2]);
-    bool is_standing = (z_axis > STANDING_THRESHOLD);
+#ifdef CONFIG_IMU_MPU6050_FIFO
+// Room for one late drain on top of the watermark
+static struct imu_sample fifo_samples[CONFIG_IMU_MPU6050_FIFO_WATERMARK * 2];
+
+static int read_sensor_fifo(sensor_data_t *data) {
+    uint32_t timestamp = k_uptime_get_32();
+    int frames = imu_mpu6050_fifo_drain(fifo_samples, ARRAY_SIZE(fifo_samples));
+
+    if (frames <= 0) {
+#ifdef CONFIG_IMU_STREAM
+        if (frames == -EOVERFLOW) {
+            imu_stream_report_overflow();
+        }
+#endif // CONFIG_IMU_STREAM
+        return (frames == 0) ? -EAGAIN : frames;
+    }
+
+#ifdef CONFIG_IMU_STREAM
+    if (imu_stream_active()) {
+        imu_stream_send(fifo_samples, frames, timestamp);
+    }
+#endif // CONFIG_IMU_STREAM
+
+    motion_classifier_push(fifo_samples, frames);
+
+#ifdef CONFIG_ACTIVITY_ENGINE
+    struct motion_result motion;
+    struct activity_result activity;
+
+    activity_engine_push(fifo_samples, frames);
+
+    if (motion_classifier_evaluate(&motion) != 0 ||
+        activity_engine_evaluate(&activity) != 0) {
+        return -EAGAIN;
+    }
 
-    // Fill sensor_data_t structure
     data->company_id = COMPANY_ID;
-    data->type = SENSOR_TYPE_MOTION;
+    data->type = SENSOR_TYPE_ACTIVITY;
     data->timestamp = timestamp;
-    data->values[0] = is_moving ? 1 : 0;
-    data->values[1] = is_standing ? 1 : 0;
-
-    LOG_DBG("Accel magnitude: %.3f | Gyro magnitude: %.3f", 
-            (double)accel_magnitude, (double)gyro_magnitude);
-    LOG_DBG("Z-axis: %.3f", (double)z_axis);
+    data->values[0] = activity.state;
+    data->values[1] = (int16_t)activity.steps;
+    data->values[2] = activity.cadence_spm;
+    data->values[3] = motion.standing ? 1 : 0;
 
     return 0;
+#else
+    return classify(data, timestamp);
+#endif // CONFIG_ACTIVITY_ENGINE
+}
+#endif // CONFIG_IMU_MPU6050_FIFO
+
+static bool should_publish(const sensor_data_t *data, const sensor_data_t *last) {
+#ifdef CONFIG_ACTIVITY_ENGINE
+    // Steps change all the time, they only ride along with a state change or the report interval
+    return data->values[0] != last->values[0] || data->values[3] != last->values[3] ||
+           (data->timestamp - last->timestamp >=
+            CONFIG_ACTIVITY_ENGINE_REPORT_INTERVAL_S * MSEC_PER_SEC);
+#else
+    // Check if MOVING and STANDING values changed from last sample
+    return data->values[0] != last->values[0] || data->values[1] != last->values[1];
+#endif // CONFIG_ACTIVITY_ENGINE
+}
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+#define ADV_INTERVAL_LIMIT_MS 10240     // Longest advertising interval of the spec
+
+// Advertising interval while sampling: the Sensor Config one, which may have
+// been written over GATT and persisted, else the sensor_ble default
+static void active_adv_interval(uint16_t *min_ms, uint16_t *max_ms) {
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+    struct sensor_config config;
+
+    sensor_config_get(&config);
+    *min_ms = config.adv_interval_min_ms;
+    *max_ms = config.adv_interval_max_ms;
+#else
+    *min_ms = BT_GAP_ADV_FAST_INT_MIN_2 * 5 / 8;
+    *max_ms = BT_GAP_ADV_FAST_INT_MAX_2 * 5 / 8;
+#endif // CONFIG_SENSOR_BLE_SERVICE
+}
+
+static bool is_still(const sensor_data_t *data) {
+#ifdef CONFIG_IMU_STREAM
+    // A central recording the raw stream wants every sample, even at rest
+    if (imu_stream_active()) {
+        return false;
+    }
+#endif // CONFIG_IMU_STREAM
+#ifdef CONFIG_ACTIVITY_ENGINE
+    return data->values[0] == ACTIVITY_STATE_STILL;
+#else
+    return data->values[0] == 0;
+#endif // CONFIG_ACTIVITY_ENGINE
+}
+
+// Park the IMU and slow the radio down until the motion interrupt fires
+static void wait_for_motion(void) {
+    uint16_t min_ms, max_ms;
+
+    if (imu_mpu6050_wom_enter() != 0) {
+        return;
+    }
+
+    // Never faster than the configured interval, a slow one stays as it is
+    active_adv_interval(&min_ms, &max_ms);
+    uint16_t idle_min_ms = MAX(CONFIG_SENSOR_MOV_ADV_IDLE_ADV_INTERVAL_MS, max_ms);
+    uint16_t idle_max_ms = MAX(idle_min_ms, MIN(idle_min_ms + idle_min_ms / 2,
+                                                ADV_INTERVAL_LIMIT_MS));
+
+    sensor_ble_adv_set_interval(idle_min_ms, idle_max_ms);
+
+    imu_mpu6050_wom_wait(K_FOREVER);
+
+    imu_mpu6050_wom_exit();
+    // Read again, the config may have been written while parked
+    active_adv_interval(&min_ms, &max_ms);
+    sensor_ble_adv_set_interval(min_ms, max_ms);
 }
+#endif // CONFIG_IMU_MPU6050_WOM
 
  
 /* Main Function */
@@ -91,6 +215,7 @@ int main(void) {
     
     // Zero-initialize the entire struct to avoid garbage values
     memset(&data, 0, sizeof(sensor_data_t));
+    memset(&last, 0, sizeof(sensor_data_t));
 
     LOG_INF("Sensor Temp BLE\n");
 
@@ -111,15 +236,40 @@ int main(void) {
         return -1;  // Exit if the sensor is not found
     }
 
+    if (imu_mpu6050_init(sensor) != 0) {
+        return -1;
+    }
+    motion_classifier_init(imu_mpu6050_accel_lsb_per_g(), imu_mpu6050_gyro_lsb_per_10dps());
+#ifdef CONFIG_ACTIVITY_ENGINE
+    activity_engine_init(imu_mpu6050_accel_lsb_per_g(), CONFIG_IMU_MPU6050_FIFO_ODR_HZ);
+#endif // CONFIG_ACTIVITY_ENGINE
+
+#ifdef CONFIG_IMU_MPU6050_FIFO
+    if (imu_mpu6050_fifo_start() != 0) {
+        return -1;
+    }
+#endif // CONFIG_IMU_MPU6050_FIFO
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+    uint32_t still_since = k_uptime_get_32();
+#endif // CONFIG_IMU_MPU6050_WOM
+
 	while (1) {
 		// Read sensor data
-        read_sensor_data(sensor, &data);
+#ifdef CONFIG_IMU_MPU6050_FIFO
+        imu_mpu6050_fifo_wait(K_FOREVER);
+        err = read_sensor_fifo(&data);
+#else
+        k_sleep(K_MSEC(SAMPLE_INTERVAL_MS));
+        err = read_sensor_data(sensor, &data);
+#endif // CONFIG_IMU_MPU6050_FIFO
+        if (err) {
+            continue;
+        }
 
-        // Check if MOVING and STANDING values changed from last sample
-        if (data.values[0] != last.values[0] || data.values[1] != last.values[1]) {
+        if (should_publish(&data, &last)) {
             // Update the last values
-            last.values[0] = data.values[0];
-            last.values[1] = data.values[1];
+            last = data;
             sensor_data_print(&data);
 			LOG_HEXDUMP_DBG(&data, sizeof(sensor_data_t), "Sensor Data");
 			sensor_data_adv_update(&data);
@@ -130,7 +280,15 @@ int main(void) {
 		} else {
 		  //LOG_ERR("Failed to read sensor data");
 		}
-        k_sleep(K_MSEC(SAMPLE_INTERVAL_MS)); 
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+        if (!is_still(&data)) {
+            still_since = data.timestamp;
+        } else if (data.timestamp - still_since >= CONFIG_IMU_MPU6050_WOM_IDLE_S * MSEC_PER_SEC) {
+            wait_for_motion();
+            still_since = k_uptime_get_32();
+        }
+#endif // CONFIG_IMU_MPU6050_WOM
     }
     return 0;
 }
\ No newline at end of file
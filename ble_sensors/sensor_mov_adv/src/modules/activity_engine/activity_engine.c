@@ -0,0 +1,220 @@
+#include "activity_engine.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(activity_engine, CONFIG_ACTIVITY_ENGINE_LOG_LEVEL);
+
+#define WINDOW      CONFIG_ACTIVITY_ENGINE_WINDOW
+#define ONE_G_MG    1000
+
+// Sliding window in mg, ordered by sample index modulo WINDOW
+static int16_t win_x[WINDOW], win_y[WINDOW], win_z[WINDOW];
+static uint16_t win_jerk[WINDOW];      // L1 difference to the previous sample (mg)
+static uint8_t win_step[WINDOW];       // 1 if a step was detected at this sample
+
+// Running sums over the window
+static int64_t sum_x, sum_y, sum_z;
+static int64_t sum_xx, sum_yy, sum_zz;
+static uint32_t sum_jerk;
+static uint32_t steps_in_window;
+
+static int32_t accel_lsb_per_g;
+static uint32_t odr;
+static uint32_t sample_index;          // Total samples pushed
+
+// Step detector
+static int64_t step_hi_sq;
+static uint32_t step_min_samples;
+static uint32_t last_step_index;
+static bool above_step;
+static uint16_t step_count;
+
+// Fall detector
+static int64_t impact_sq;
+static int64_t still_var;
+static int32_t fall_cos_q10_sq;        // cos^2(fall angle) in Q10
+static uint32_t fall_confirm_samples;
+static bool impact_pending;
+static uint32_t impact_index;
+static bool fall_latched;
+static int32_t ref_x, ref_y, ref_z;    // Last stable orientation (window mean)
+
+void activity_engine_init(int32_t lsb_per_g, uint32_t odr_hz) {
+    const float fall_angle = CONFIG_ACTIVITY_ENGINE_FALL_ANGLE_DEG * 3.14159265f / 180.0f;
+    const int64_t step_hi = ONE_G_MG + CONFIG_ACTIVITY_ENGINE_STEP_THRESHOLD_MG;
+
+    accel_lsb_per_g = lsb_per_g;
+    odr = odr_hz;
+
+    step_hi_sq = step_hi * step_hi;
+    step_min_samples = CONFIG_ACTIVITY_ENGINE_STEP_MIN_INTERVAL_MS * odr_hz / MSEC_PER_SEC;
+    impact_sq = (int64_t)CONFIG_ACTIVITY_ENGINE_FALL_IMPACT_MG * CONFIG_ACTIVITY_ENGINE_FALL_IMPACT_MG;
+    still_var = (int64_t)CONFIG_ACTIVITY_ENGINE_STILL_MG * CONFIG_ACTIVITY_ENGINE_STILL_MG;
+    fall_cos_q10_sq = (int32_t)(cosf(fall_angle) * cosf(fall_angle) * 1024.0f);
+    // The window must no longer hold the impact itself when the stillness is checked
+    fall_confirm_samples = MAX(CONFIG_ACTIVITY_ENGINE_FALL_CONFIRM_MS * odr_hz / MSEC_PER_SEC,
+                               WINDOW);
+
+    memset(win_x, 0, sizeof(win_x));
+    memset(win_y, 0, sizeof(win_y));
+    memset(win_z, 0, sizeof(win_z));
+    memset(win_jerk, 0, sizeof(win_jerk));
+    memset(win_step, 0, sizeof(win_step));
+    sum_x = sum_y = sum_z = 0;
+    sum_xx = sum_yy = sum_zz = 0;
+    sum_jerk = 0;
+    steps_in_window = 0;
+    sample_index = 0;
+
+    above_step = false;
+    step_count = 0;
+    last_step_index = 0;
+    impact_pending = false;
+    fall_latched = false;
+    ref_x = ref_y = 0;
+    ref_z = ONE_G_MG;
+}
+
+static void push_sample(const struct imu_sample *sample) {
+    uint32_t slot = sample_index % WINDOW;
+    uint32_t prev = (sample_index + WINDOW - 1) % WINDOW;
+    int32_t x = sample->accel[0] * ONE_G_MG / accel_lsb_per_g;
+    int32_t y = sample->accel[1] * ONE_G_MG / accel_lsb_per_g;
+    int32_t z = sample->accel[2] * ONE_G_MG / accel_lsb_per_g;
+
+    // Drop the sample leaving the window
+    if (sample_index >= WINDOW) {
+        sum_x -= win_x[slot];
+        sum_y -= win_y[slot];
+        sum_z -= win_z[slot];
+        sum_xx -= (int32_t)win_x[slot] * win_x[slot];
+        sum_yy -= (int32_t)win_y[slot] * win_y[slot];
+        sum_zz -= (int32_t)win_z[slot] * win_z[slot];
+        sum_jerk -= win_jerk[slot];
+        steps_in_window -= win_step[slot];
+    }
+
+    uint32_t jerk = 0;
+    if (sample_index > 0) {
+        jerk = abs(x - win_x[prev]) + abs(y - win_y[prev]) + abs(z - win_z[prev]);
+    }
+
+    // Steps: rising edge above 1 g + threshold, re-armed once back under 1 g
+    int64_t mag_sq = (int64_t)x * x + (int64_t)y * y + (int64_t)z * z;
+    uint8_t step = 0;
+
+    if (!above_step && mag_sq > step_hi_sq &&
+        (step_count == 0 || sample_index - last_step_index >= step_min_samples)) {
+        above_step = true;
+        last_step_index = sample_index;
+        step_count++;
+        step = 1;
+    } else if (above_step && mag_sq < (int64_t)ONE_G_MG * ONE_G_MG) {
+        above_step = false;
+    }
+
+    // Falls: a hard impact opens a confirmation period
+    if (!impact_pending && mag_sq > impact_sq) {
+        impact_pending = true;
+        impact_index = sample_index;
+        LOG_DBG("Impact at sample %u", sample_index);
+    }
+
+    win_x[slot] = x;
+    win_y[slot] = y;
+    win_z[slot] = z;
+    win_jerk[slot] = MIN(jerk, UINT16_MAX);
+    win_step[slot] = step;
+
+    sum_x += x;
+    sum_y += y;
+    sum_z += z;
+    sum_xx += x * x;
+    sum_yy += y * y;
+    sum_zz += z * z;
+    sum_jerk += win_jerk[slot];
+    steps_in_window += step;
+
+    sample_index++;
+}
+
+void activity_engine_push(const struct imu_sample *samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        push_sample(&samples[i]);
+    }
+}
+
+// True if the angle between the two gravity vectors exceeds the fall angle.
+// Compares dot^2 with cos^2 * |a|^2 * |b|^2, no square root or division.
+static bool orientation_changed(int32_t ax, int32_t ay, int32_t az,
+                                int32_t bx, int32_t by, int32_t bz) {
+    int64_t dot = (int64_t)ax * bx + (int64_t)ay * by + (int64_t)az * bz;
+    int64_t norm_a = (int64_t)ax * ax + (int64_t)ay * ay + (int64_t)az * az;
+    int64_t norm_b = (int64_t)bx * bx + (int64_t)by * by + (int64_t)bz * bz;
+
+    if (dot <= 0) {
+        return true;    // 90 degrees or more
+    }
+    return dot * dot < ((norm_a * norm_b) >> 10) * fall_cos_q10_sq;
+}
+
+int activity_engine_evaluate(struct activity_result *result) {
+    if (sample_index < WINDOW) {
+        return -EAGAIN;
+    }
+
+    const int64_t n = WINDOW;
+    int32_t mean_x = sum_x / n, mean_y = sum_y / n, mean_z = sum_z / n;
+
+    // Features
+    int64_t var = (sum_xx - sum_x * sum_x / n) / n +
+                  (sum_yy - sum_y * sum_y / n) / n +
+                  (sum_zz - sum_z * sum_z / n) / n;
+    uint32_t jerk_mg_s = (uint32_t)((uint64_t)sum_jerk * odr / (n - 1));
+    uint32_t cadence = steps_in_window * 60 * odr / n;
+
+    if (impact_pending && sample_index - impact_index >= fall_confirm_samples) {
+        // Lying still in a new orientation after the impact
+        impact_pending = false;
+        if (var < still_var &&
+            orientation_changed(ref_x, ref_y, ref_z, mean_x, mean_y, mean_z)) {
+            fall_latched = true;
+            LOG_WRN("Fall detected");
+        }
+    }
+
+    // A fall stays reported until the worker moves again
+    if (fall_latched && var >= still_var) {
+        fall_latched = false;
+    }
+
+    if (fall_latched) {
+        result->state = ACTIVITY_STATE_FALL;
+    } else if (var < still_var || steps_in_window == 0) {
+        result->state = ACTIVITY_STATE_STILL;
+    } else if (cadence >= CONFIG_ACTIVITY_ENGINE_RUN_CADENCE_SPM ||
+               jerk_mg_s >= CONFIG_ACTIVITY_ENGINE_RUN_JERK_MG_S) {
+        result->state = ACTIVITY_STATE_RUNNING;
+    } else {
+        result->state = ACTIVITY_STATE_WALKING;
+    }
+
+    // Track the orientation outside of falls as the reference for the next impact
+    if (!impact_pending && !fall_latched) {
+        ref_x = mean_x;
+        ref_y = mean_y;
+        ref_z = mean_z;
+    }
+
+    result->steps = step_count;
+    result->cadence_spm = cadence;
+
+    LOG_DBG("var %lld mg^2 | jerk %u mg/s | cadence %u spm | steps %u | state %d",
+            var, jerk_mg_s, cadence, step_count, result->state);
+
+    return 0;
+}
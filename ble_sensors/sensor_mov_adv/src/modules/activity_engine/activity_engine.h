@@ -0,0 +1,35 @@
+#ifndef ACTIVITY_ENGINE_H
+#define ACTIVITY_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "imu_mpu6050.h"
+#include "sensor_common.h"
+
+struct activity_result {
+    activity_state_t state;
+    uint16_t steps;         // Total steps since boot (wraps)
+    uint16_t cadence_spm;   // Steps per minute over the window
+};
+
+/**
+ * @brief Reset the engine for a given accelerometer range and output data rate.
+ */
+void activity_engine_init(int32_t accel_lsb_per_g, uint32_t odr_hz);
+
+/**
+ * @brief Append samples to the sliding window.
+ *
+ * Steps and fall impacts are detected sample by sample, the window
+ * features are kept as running sums so evaluation is O(1).
+ */
+void activity_engine_push(const struct imu_sample *samples, size_t count);
+
+/**
+ * @brief Classify the current window.
+ *
+ * @return 0 on success, -EAGAIN until the window is full.
+ */
+int activity_engine_evaluate(struct activity_result *result);
+
+#endif // ACTIVITY_ENGINE_H
@@ -0,0 +1,315 @@
+#include "imu_mpu6050.h"
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(imu_mpu6050, CONFIG_IMU_MPU6050_LOG_LEVEL);
+
+// MPU6050 registers not covered by the Zephyr sensor driver
+#define MPU6050_REG_SMPLRT_DIV      0x19
+#define MPU6050_REG_CONFIG          0x1A
+#define MPU6050_REG_GYRO_CONFIG     0x1B
+#define MPU6050_REG_ACCEL_CONFIG    0x1C
+#define MPU6050_REG_MOT_THR         0x1F
+#define MPU6050_REG_MOT_DUR         0x20
+#define MPU6050_REG_FIFO_EN         0x23
+#define MPU6050_REG_INT_PIN_CFG     0x37
+#define MPU6050_REG_INT_ENABLE      0x38
+#define MPU6050_REG_INT_STATUS      0x3A
+#define MPU6050_REG_MOT_DETECT_CTRL 0x69
+#define MPU6050_REG_USER_CTRL       0x6A
+#define MPU6050_REG_PWR_MGMT_1      0x6B
+#define MPU6050_REG_PWR_MGMT_2      0x6C
+#define MPU6050_REG_FIFO_COUNTH     0x72
+#define MPU6050_REG_FIFO_R_W        0x74
+
+#define MPU6050_FS_SEL_SHIFT        3
+#define MPU6050_FS_SEL_MASK         0x03
+#define MPU6050_DLPF_CFG_44HZ       3       // Gyro output rate drops to 1 kHz with the DLPF on
+#define MPU6050_GYRO_RATE_HZ        1000
+#define MPU6050_FIFO_EN_XYZG_ACCEL  0x78    // XG, YG, ZG and ACCEL (no temperature)
+#define MPU6050_USER_CTRL_FIFO_EN   BIT(6)
+#define MPU6050_USER_CTRL_FIFO_RST  BIT(2)
+#define MPU6050_INT_FIFO_OFLOW      BIT(4)
+#define MPU6050_INT_MOT             BIT(6)
+#define MPU6050_INT_PIN_LATCH       0x30    // Latched until any register read
+#define MPU6050_ACCEL_HPF_5HZ       0x01    // Motion detection runs on the high-passed accel
+#define MPU6050_ACCEL_HPF_MASK      0x07
+#define MPU6050_MOT_DETECT_DELAY    0x15    // 1 ms accel on-delay, default counters
+#define MPU6050_PWR1_CYCLE          BIT(5)
+#define MPU6050_PWR1_TEMP_DIS       BIT(3)
+#define MPU6050_PWR2_STBY_GYRO      0x07
+#define MPU6050_PWR2_LP_WAKE_SHIFT  6
+#define MPU6050_MOT_THR_MG_PER_LSB  2
+
+#define MPU6050_FIFO_SIZE           1024
+#define MPU6050_FRAME_LEN           12      // Accel XYZ + gyro XYZ, 16 bit big-endian
+
+static const struct i2c_dt_spec imu_i2c = I2C_DT_SPEC_GET(DT_ALIAS(sensor_imu));
+
+static int32_t accel_lsb_per_g = 16384;
+static int32_t gyro_lsb_per_10dps = 1310;
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+
+static const struct gpio_dt_spec imu_int = GPIO_DT_SPEC_GET(DT_ALIAS(sensor_imu), int_gpios);
+static struct gpio_callback imu_int_cb;
+
+K_SEM_DEFINE(wom_sem, 0, 1);
+
+static void imu_int_handler(const struct device *port, struct gpio_callback *cb,
+                            gpio_port_pins_t pins) {
+    k_sem_give(&wom_sem);
+}
+
+static int wom_gpio_init(void) {
+    int err;
+
+    if (!gpio_is_ready_dt(&imu_int)) {
+        LOG_ERR("MPU6050 interrupt GPIO not ready");
+        return -ENODEV;
+    }
+
+    err = gpio_pin_configure_dt(&imu_int, GPIO_INPUT);
+    if (err) {
+        return err;
+    }
+
+    gpio_init_callback(&imu_int_cb, imu_int_handler, BIT(imu_int.pin));
+    return gpio_add_callback(imu_int.port, &imu_int_cb);
+}
+
+#endif // CONFIG_IMU_MPU6050_WOM
+
+int imu_mpu6050_init(const struct device *dev) {
+    uint8_t accel_cfg, gyro_cfg;
+
+    if (!device_is_ready(dev) || !i2c_is_ready_dt(&imu_i2c)) {
+        LOG_ERR("MPU6050 not ready");
+        return -ENODEV;
+    }
+
+    // Read back the ranges selected by the driver to scale raw samples
+    if (i2c_reg_read_byte_dt(&imu_i2c, MPU6050_REG_ACCEL_CONFIG, &accel_cfg) ||
+        i2c_reg_read_byte_dt(&imu_i2c, MPU6050_REG_GYRO_CONFIG, &gyro_cfg)) {
+        LOG_ERR("Failed to read MPU6050 full-scale configuration");
+        return -EIO;
+    }
+
+    accel_lsb_per_g = 16384 >> ((accel_cfg >> MPU6050_FS_SEL_SHIFT) & MPU6050_FS_SEL_MASK);
+    gyro_lsb_per_10dps = 1310 >> ((gyro_cfg >> MPU6050_FS_SEL_SHIFT) & MPU6050_FS_SEL_MASK);
+
+    LOG_INF("MPU6050: accel %d LSB/g | gyro %d LSB/(10 deg/s)",
+            accel_lsb_per_g, gyro_lsb_per_10dps);
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+    if (wom_gpio_init() != 0) {
+        LOG_ERR("Failed to configure MPU6050 interrupt pin");
+        return -EIO;
+    }
+#endif // CONFIG_IMU_MPU6050_WOM
+
+    return 0;
+}
+
+int32_t imu_mpu6050_accel_lsb_per_g(void) {
+    return accel_lsb_per_g;
+}
+
+int32_t imu_mpu6050_gyro_lsb_per_10dps(void) {
+    return gyro_lsb_per_10dps;
+}
+
+#ifdef CONFIG_IMU_MPU6050_FIFO
+
+#define FIFO_WATERMARK_MS \
+    ((CONFIG_IMU_MPU6050_FIFO_WATERMARK * MSEC_PER_SEC) / CONFIG_IMU_MPU6050_FIFO_ODR_HZ)
+
+BUILD_ASSERT(CONFIG_IMU_MPU6050_FIFO_WATERMARK * MPU6050_FRAME_LEN < MPU6050_FIFO_SIZE,
+             "FIFO watermark does not fit in the MPU6050 FIFO");
+
+K_SEM_DEFINE(fifo_watermark_sem, 0, 1);
+
+static uint8_t fifo_buf[MPU6050_FIFO_SIZE];
+static uint32_t fifo_overflows;
+
+static void fifo_watermark_timer_handler(struct k_timer *timer) {
+    k_sem_give(&fifo_watermark_sem);
+}
+
+K_TIMER_DEFINE(fifo_watermark_timer, fifo_watermark_timer_handler, NULL);
+
+static int fifo_reset(void) {
+    int err = i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_USER_CTRL, 0);
+
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RST);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN);
+
+    return err ? -EIO : 0;
+}
+
+int imu_mpu6050_fifo_start(void) {
+    uint8_t smplrt_div = (MPU6050_GYRO_RATE_HZ / CONFIG_IMU_MPU6050_FIFO_ODR_HZ) - 1;
+    int err;
+
+    err = i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_CONFIG, MPU6050_DLPF_CFG_44HZ);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_SMPLRT_DIV, smplrt_div);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_XYZG_ACCEL);
+    if (err) {
+        LOG_ERR("Failed to configure MPU6050 FIFO");
+        return -EIO;
+    }
+
+    err = fifo_reset();
+    if (err) {
+        LOG_ERR("Failed to enable MPU6050 FIFO");
+        return err;
+    }
+
+    k_sem_reset(&fifo_watermark_sem);
+    k_timer_start(&fifo_watermark_timer, K_MSEC(FIFO_WATERMARK_MS), K_MSEC(FIFO_WATERMARK_MS));
+
+    LOG_INF("MPU6050 FIFO: %d Hz | %d frames per drain (%d ms)",
+            CONFIG_IMU_MPU6050_FIFO_ODR_HZ, CONFIG_IMU_MPU6050_FIFO_WATERMARK,
+            FIFO_WATERMARK_MS);
+
+    return 0;
+}
+
+int imu_mpu6050_fifo_wait(k_timeout_t timeout) {
+    return k_sem_take(&fifo_watermark_sem, timeout);
+}
+
+int imu_mpu6050_fifo_drain(struct imu_sample *samples, size_t max_samples) {
+    uint8_t status;
+    uint8_t count_buf[2];
+
+    // INT_STATUS is cleared on read, the overflow flag is latched until then
+    if (i2c_reg_read_byte_dt(&imu_i2c, MPU6050_REG_INT_STATUS, &status) ||
+        i2c_burst_read_dt(&imu_i2c, MPU6050_REG_FIFO_COUNTH, count_buf, sizeof(count_buf))) {
+        LOG_ERR("Failed to read MPU6050 FIFO status");
+        return -EIO;
+    }
+
+    uint16_t count = sys_get_be16(count_buf);
+
+    if ((status & MPU6050_INT_FIFO_OFLOW) || count >= MPU6050_FIFO_SIZE) {
+        // Frame alignment is lost once the FIFO wraps, start over
+        fifo_overflows++;
+        LOG_WRN("MPU6050 FIFO overflow (%u), resetting", fifo_overflows);
+        fifo_reset();
+        return -EOVERFLOW;
+    }
+
+    size_t frames = MIN(count / MPU6050_FRAME_LEN, max_samples);
+    if (frames == 0) {
+        return 0;
+    }
+
+    // FIFO_R_W does not auto-increment, one burst read returns consecutive bytes
+    if (i2c_burst_read_dt(&imu_i2c, MPU6050_REG_FIFO_R_W, fifo_buf,
+                          frames * MPU6050_FRAME_LEN)) {
+        LOG_ERR("Failed to read MPU6050 FIFO");
+        return -EIO;
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        const uint8_t *frame = &fifo_buf[i * MPU6050_FRAME_LEN];
+
+        for (int axis = 0; axis < 3; axis++) {
+            samples[i].accel[axis] = (int16_t)sys_get_be16(&frame[axis * 2]);
+            samples[i].gyro[axis] = (int16_t)sys_get_be16(&frame[6 + axis * 2]);
+        }
+    }
+
+    LOG_DBG("Drained %d frames (%d bytes queued)", frames, count);
+
+    return frames;
+}
+
+#endif // CONFIG_IMU_MPU6050_FIFO
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+
+int imu_mpu6050_wom_enter(void) {
+    uint8_t status;
+    int err;
+
+#ifdef CONFIG_IMU_MPU6050_FIFO
+    k_timer_stop(&fifo_watermark_timer);
+#endif // CONFIG_IMU_MPU6050_FIFO
+
+    err = i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_USER_CTRL, 0);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_FIFO_EN, 0);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_INT_PIN_CFG, MPU6050_INT_PIN_LATCH);
+    err |= i2c_reg_update_byte_dt(&imu_i2c, MPU6050_REG_ACCEL_CONFIG,
+                                  MPU6050_ACCEL_HPF_MASK, MPU6050_ACCEL_HPF_5HZ);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_MOT_THR,
+                                 CONFIG_IMU_MPU6050_WOM_THRESHOLD_MG / MPU6050_MOT_THR_MG_PER_LSB);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_MOT_DUR,
+                                 CONFIG_IMU_MPU6050_WOM_DURATION_MS);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_MOT_DETECT_CTRL, MPU6050_MOT_DETECT_DELAY);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_INT_ENABLE, MPU6050_INT_MOT);
+    if (err) {
+        LOG_ERR("Failed to arm MPU6050 motion detection");
+        return -EIO;
+    }
+
+    // Clear anything latched before arming the pin interrupt
+    i2c_reg_read_byte_dt(&imu_i2c, MPU6050_REG_INT_STATUS, &status);
+    k_sem_reset(&wom_sem);
+    gpio_pin_interrupt_configure_dt(&imu_int, GPIO_INT_EDGE_TO_ACTIVE);
+
+    // The pin is latched: motion since the status read holds it active with
+    // no edge left to see, so take it as a wakeup right away
+    if (gpio_pin_get_dt(&imu_int) > 0) {
+        k_sem_give(&wom_sem);
+    }
+
+    // Gyro in standby, accel cycling at the low-power wake-up rate
+    err = i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_PWR_MGMT_2,
+                                (CONFIG_IMU_MPU6050_WOM_LP_WAKE_CTRL << MPU6050_PWR2_LP_WAKE_SHIFT) |
+                                MPU6050_PWR2_STBY_GYRO);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_PWR_MGMT_1,
+                                 MPU6050_PWR1_CYCLE | MPU6050_PWR1_TEMP_DIS);
+    if (err) {
+        LOG_ERR("Failed to enter MPU6050 low-power cycling");
+        return -EIO;
+    }
+
+    LOG_INF("MPU6050 wake-on-motion armed (%d mg)", CONFIG_IMU_MPU6050_WOM_THRESHOLD_MG);
+    return 0;
+}
+
+int imu_mpu6050_wom_wait(k_timeout_t timeout) {
+    return k_sem_take(&wom_sem, timeout);
+}
+
+int imu_mpu6050_wom_exit(void) {
+    uint8_t status;
+    int err;
+
+    gpio_pin_interrupt_configure_dt(&imu_int, GPIO_INT_DISABLE);
+
+    // Back to the state left by the Zephyr driver: awake, all axes on, HPF off
+    err = i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_PWR_MGMT_1, 0);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_PWR_MGMT_2, 0);
+    err |= i2c_reg_write_byte_dt(&imu_i2c, MPU6050_REG_INT_ENABLE, 0);
+    err |= i2c_reg_update_byte_dt(&imu_i2c, MPU6050_REG_ACCEL_CONFIG, MPU6050_ACCEL_HPF_MASK, 0);
+    err |= i2c_reg_read_byte_dt(&imu_i2c, MPU6050_REG_INT_STATUS, &status);
+    if (err) {
+        LOG_ERR("Failed to leave MPU6050 low-power cycling");
+        return -EIO;
+    }
+
+    LOG_INF("MPU6050 motion detected, resuming sampling");
+
+#ifdef CONFIG_IMU_MPU6050_FIFO
+    return imu_mpu6050_fifo_start();
+#else
+    return 0;
+#endif // CONFIG_IMU_MPU6050_FIFO
+}
+
+#endif // CONFIG_IMU_MPU6050_WOM
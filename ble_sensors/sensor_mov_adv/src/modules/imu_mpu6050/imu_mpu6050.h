@@ -0,0 +1,76 @@
+#ifndef IMU_MPU6050_H
+#define IMU_MPU6050_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+// One FIFO frame, raw big-endian registers already converted to host order
+struct imu_sample {
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+/**
+ * @brief Check the MPU6050 and read back its full-scale configuration.
+ *
+ * The Zephyr driver still owns the chip initialization, this module only
+ * adds the FIFO configuration on top of it.
+ */
+int imu_mpu6050_init(const struct device *dev);
+
+/**
+ * @brief Accelerometer sensitivity in LSB per g for the configured range.
+ */
+int32_t imu_mpu6050_accel_lsb_per_g(void);
+
+/**
+ * @brief Gyroscope sensitivity in LSB per 10 deg/s for the configured range.
+ */
+int32_t imu_mpu6050_gyro_lsb_per_10dps(void);
+
+#ifdef CONFIG_IMU_MPU6050_FIFO
+/**
+ * @brief Configure the sample rate and start filling the FIFO with accel and gyro frames.
+ */
+int imu_mpu6050_fifo_start(void);
+
+/**
+ * @brief Sleep until the FIFO holds CONFIG_IMU_MPU6050_FIFO_WATERMARK frames.
+ *
+ * The MPU6050 has no FIFO watermark interrupt, so the wakeup is timed from
+ * the configured output data rate.
+ */
+int imu_mpu6050_fifo_wait(k_timeout_t timeout);
+
+/**
+ * @brief Drain the complete frames in the FIFO with burst I2C reads.
+ *
+ * @param samples Destination buffer
+ * @param max_samples Capacity of @p samples
+ *
+ * @return Number of frames read, or a negative error code. -EOVERFLOW is
+ *         returned (and the FIFO reset) if frames were lost.
+ */
+int imu_mpu6050_fifo_drain(struct imu_sample *samples, size_t max_samples);
+#endif // CONFIG_IMU_MPU6050_FIFO
+
+#ifdef CONFIG_IMU_MPU6050_WOM
+/**
+ * @brief Arm the motion-detection interrupt and drop to low-power accel cycling.
+ *
+ * Gyro and FIFO are stopped until imu_mpu6050_wom_exit().
+ */
+int imu_mpu6050_wom_enter(void);
+
+/**
+ * @brief Sleep until the motion-detection interrupt fires.
+ */
+int imu_mpu6050_wom_wait(k_timeout_t timeout);
+
+/**
+ * @brief Leave low-power cycling and restore full-rate sampling.
+ */
+int imu_mpu6050_wom_exit(void);
+#endif // CONFIG_IMU_MPU6050_WOM
+
+#endif // IMU_MPU6050_H
@@ -0,0 +1,125 @@
+#include "imu_stream.h"
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(imu_stream, CONFIG_IMU_STREAM_LOG_LEVEL);
+
+// Largest notification payload the stack can carry (ATT MTU - 3)
+#define PACKET_MAX          (CONFIG_BT_L2CAP_TX_MTU - 3)
+#define SAMPLES_MAX         ((PACKET_MAX - sizeof(struct imu_stream_header)) / sizeof(struct imu_sample))
+
+BUILD_ASSERT(SAMPLES_MAX >= 1, "CONFIG_BT_L2CAP_TX_MTU too small for one IMU sample");
+
+static uint8_t packet[PACKET_MAX];
+static struct bt_conn *stream_conn;
+static bool notify_enabled;
+static uint16_t seq;
+static bool overflow;
+
+// Totals for the current subscription
+static uint32_t packets_sent;
+static uint32_t packets_failed;
+static uint32_t samples_sent;
+
+static void imu_stream_ccc_change(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("IMU Stream notifications %s", notify_enabled ? "enabled" : "disabled");
+
+    if (notify_enabled) {
+        packets_sent = packets_failed = samples_sent = 0;
+    } else {
+        LOG_INF("Stream stopped: %u packets | %u failed | %u samples",
+                packets_sent, packets_failed, samples_sent);
+    }
+}
+
+BT_GATT_SERVICE_DEFINE(imu_stream_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_128(IMU_STREAM_SERVICE_UUID)),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(IMU_STREAM_CHAR_UUID),
+                           BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE,
+                           NULL, NULL, NULL),
+    BT_GATT_CCC(imu_stream_ccc_change, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
+);
+
+// The MTU is per connection, so the stream follows the first central only
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (!err && !stream_conn) {
+        stream_conn = bt_conn_ref(conn);
+    }
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    if (conn == stream_conn) {
+        bt_conn_unref(stream_conn);
+        stream_conn = NULL;
+        notify_enabled = false;
+    }
+}
+
+BT_CONN_CB_DEFINE(imu_stream_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+};
+
+bool imu_stream_active(void) {
+    return stream_conn && notify_enabled;
+}
+
+void imu_stream_report_overflow(void) {
+    overflow = true;
+}
+
+int imu_stream_send(const struct imu_sample *samples, size_t count, uint32_t timestamp) {
+    struct imu_stream_header *header = (struct imu_stream_header *)packet;
+    const struct bt_gatt_attr *attr = &imu_stream_svc.attrs[2];
+    int ret = 0;
+
+    if (!imu_stream_active()) {
+        return -EACCES;
+    }
+
+    // Fit as many samples as the negotiated MTU allows
+    size_t per_packet = MIN((bt_gatt_get_mtu(stream_conn) - 3 - sizeof(*header)) /
+                            sizeof(struct imu_sample), SAMPLES_MAX);
+    // Samples are evenly spaced at the ODR, the last one was just read
+    uint32_t first_ms = timestamp - (uint32_t)((count - 1) * MSEC_PER_SEC /
+                                               CONFIG_IMU_MPU6050_FIFO_ODR_HZ);
+
+    for (size_t pos = 0; pos < count; pos += per_packet) {
+        size_t n = MIN(per_packet, count - pos);
+        size_t len = sizeof(*header) + n * sizeof(struct imu_sample);
+
+        header->seq = sys_cpu_to_le16(seq);
+        header->count = n;
+        header->flags = overflow ? IMU_STREAM_FLAG_OVERFLOW : 0;
+        header->timestamp = sys_cpu_to_le32(first_ms + (uint32_t)(pos * MSEC_PER_SEC /
+                                            CONFIG_IMU_MPU6050_FIFO_ODR_HZ));
+        memcpy(&packet[sizeof(*header)], &samples[pos], n * sizeof(struct imu_sample));
+
+        // The sequence advances even on failure so the receiver sees the gap
+        seq++;
+
+        int err = bt_gatt_notify(stream_conn, attr, packet, len);
+        if (err) {
+            packets_failed++;
+            ret = err;
+            LOG_DBG("Notify failed (err %d)", err);
+            continue;
+        }
+
+        overflow = false;
+        packets_sent++;
+        samples_sent += n;
+    }
+
+    return ret;
+}
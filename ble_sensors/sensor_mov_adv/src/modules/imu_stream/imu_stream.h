@@ -0,0 +1,48 @@
+#ifndef IMU_STREAM_H
+#define IMU_STREAM_H
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include "imu_mpu6050.h"
+
+// Service UUID
+#define IMU_STREAM_SERVICE_UUID BT_UUID_128_ENCODE(0x7297d0d4, 0x0b32, 0x41f8, 0xb04c, 0xdf38349df30b)
+
+// IMU Stream characteristic
+#define IMU_STREAM_CHAR_UUID BT_UUID_128_ENCODE(0x7344a36a, 0x727a, 0x4d88, 0x8628, 0xd8df9926900e)
+
+#define IMU_STREAM_FLAG_OVERFLOW BIT(0)    // FIFO samples were lost before this notification
+
+// Notification header, followed by count struct imu_sample (little-endian)
+struct imu_stream_header {
+    uint16_t seq;           // Incremented on every notification, sent or not
+    uint8_t count;          // Samples in this notification
+    uint8_t flags;          // IMU_STREAM_FLAG_*
+    uint32_t timestamp;     // Uptime of the first sample (ms)
+} __packed;
+
+/**
+ * @brief True while a central is connected with stream notifications enabled.
+ */
+bool imu_stream_active(void);
+
+/**
+ * @brief Send a FIFO drain as raw notifications.
+ *
+ * The samples are split in as few notifications as the current ATT MTU
+ * allows. The call may block while the controller TX buffers are full.
+ *
+ * @param samples Samples in FIFO order
+ * @param count Number of samples
+ * @param timestamp Uptime of the last sample (ms)
+ *
+ * @return 0 on success, -EACCES if the stream is not active, or the last
+ *         bt_gatt_notify() error.
+ */
+int imu_stream_send(const struct imu_sample *samples, size_t count, uint32_t timestamp);
+
+/**
+ * @brief Flag the next notification as following a FIFO overflow.
+ */
+void imu_stream_report_overflow(void);
+
+#endif // IMU_STREAM_H
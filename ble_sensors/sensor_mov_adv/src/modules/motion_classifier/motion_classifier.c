@@ -0,0 +1,156 @@
+#include "motion_classifier.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#ifdef CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+#include <arm_math.h>
+#endif // CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+
+LOG_MODULE_REGISTER(motion_classifier, CONFIG_MOTION_CLASSIFIER_LOG_LEVEL);
+
+#define WINDOW  CONFIG_MOTION_CLASSIFIER_WINDOW
+
+// Samples are kept de-interleaved per axis so each statistic runs over a
+// contiguous q15 vector. Mean, variance and power do not depend on sample
+// order, so the ring never needs to be linearized.
+static int16_t accel_x[WINDOW], accel_y[WINDOW], accel_z[WINDOW];
+static int16_t gyro_x[WINDOW], gyro_y[WINDOW], gyro_z[WINDOW];
+static uint32_t window_head;
+static uint32_t window_count;
+
+// Thresholds in raw sensor units (squared where compared against energy)
+static int64_t accel_var_enter, accel_var_leave;
+static int64_t gyro_power_enter, gyro_power_leave;
+static int32_t standing_enter, standing_leave;
+
+static struct motion_result state;
+
+/* ---------- Window statistics ---------- */
+
+static int32_t window_mean(const int16_t *x, uint32_t n) {
+#ifdef CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+    q15_t mean;
+
+    arm_mean_q15(x, n, &mean);
+    return mean;
+#else
+    int32_t sum = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        sum += x[i];
+    }
+    return sum / (int32_t)n;
+#endif // CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+}
+
+// Sample variance in raw^2
+static int64_t window_var(const int16_t *x, uint32_t n) {
+#ifdef CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+    q15_t var;
+
+    // q15 result, one LSB is 2^15 raw^2
+    arm_var_q15(x, n, &var);
+    return (int64_t)var << 15;
+#else
+    int64_t sum = 0, sum_sq = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        sum += x[i];
+        sum_sq += (int32_t)x[i] * x[i];
+    }
+    return (sum_sq - (sum * sum) / n) / (n - 1);
+#endif // CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+}
+
+// Sum of squares in raw^2
+static int64_t window_power(const int16_t *x, uint32_t n) {
+#ifdef CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+    q63_t power;
+
+    // 34.30 accumulator, i.e. the exact sum of raw * raw
+    arm_power_q15(x, n, &power);
+    return power;
+#else
+    int64_t sum_sq = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        sum_sq += (int32_t)x[i] * x[i];
+    }
+    return sum_sq;
+#endif // CONFIG_MOTION_CLASSIFIER_CMSIS_DSP
+}
+
+/* ---------- API ---------- */
+
+void motion_classifier_init(int32_t accel_lsb_per_g, int32_t gyro_lsb_per_10dps) {
+    const int64_t keep = 100 - CONFIG_MOTION_CLASSIFIER_HYSTERESIS_PCT;
+
+    // mm/s^2 -> raw: raw = mms2 * LSB/g / 9807 mm/s^2
+    int64_t accel_raw = (int64_t)CONFIG_MOTION_CLASSIFIER_ACCEL_THRESHOLD_MMS2 *
+                        accel_lsb_per_g / 9807;
+    int64_t standing_raw = (int64_t)CONFIG_MOTION_CLASSIFIER_STANDING_THRESHOLD_MMS2 *
+                           accel_lsb_per_g / 9807;
+    // mrad/s -> raw: raw = mrads * 180 * LSB/(10 deg/s) / (10000 * pi)
+    int64_t gyro_raw = (int64_t)CONFIG_MOTION_CLASSIFIER_GYRO_THRESHOLD_MRADS * 180 *
+                       gyro_lsb_per_10dps / 31416;
+
+    accel_var_enter = accel_raw * accel_raw;
+    accel_var_leave = accel_var_enter * keep * keep / 10000;
+    gyro_power_enter = gyro_raw * gyro_raw;
+    gyro_power_leave = gyro_power_enter * keep * keep / 10000;
+    standing_enter = (int32_t)standing_raw;
+    standing_leave = (int32_t)(standing_raw * keep / 100);
+
+    window_head = 0;
+    window_count = 0;
+    state.moving = false;
+    state.standing = false;
+
+    LOG_INF("Thresholds (raw): accel %lld | gyro %lld | standing %d",
+            accel_raw, gyro_raw, standing_enter);
+}
+
+void motion_classifier_push(const struct imu_sample *samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        accel_x[window_head] = samples[i].accel[0];
+        accel_y[window_head] = samples[i].accel[1];
+        accel_z[window_head] = samples[i].accel[2];
+        gyro_x[window_head] = samples[i].gyro[0];
+        gyro_y[window_head] = samples[i].gyro[1];
+        gyro_z[window_head] = samples[i].gyro[2];
+
+        window_head = (window_head + 1) % WINDOW;
+        window_count = MIN(window_count + 1, WINDOW);
+    }
+}
+
+int motion_classifier_evaluate(struct motion_result *result) {
+    uint32_t n = window_count;
+
+    if (n < 2) {
+        return -EAGAIN;
+    }
+
+    // Dynamic acceleration energy: gravity is the per-axis mean and drops out
+    int64_t accel_var = window_var(accel_x, n) + window_var(accel_y, n) +
+                        window_var(accel_z, n);
+    // Mean squared angular rate
+    int64_t gyro_power = (window_power(gyro_x, n) + window_power(gyro_y, n) +
+                          window_power(gyro_z, n)) / n;
+    int32_t z_mean = window_mean(accel_z, n);
+
+    if (state.moving) {
+        state.moving = (accel_var > accel_var_leave) || (gyro_power > gyro_power_leave);
+    } else {
+        state.moving = (accel_var > accel_var_enter) || (gyro_power > gyro_power_enter);
+    }
+
+    state.standing = z_mean > (state.standing ? standing_leave : standing_enter);
+
+    LOG_DBG("n %u | accel var %lld | gyro power %lld | z mean %d",
+            n, accel_var, gyro_power, z_mean);
+
+    *result = state;
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef MOTION_CLASSIFIER_H
+#define MOTION_CLASSIFIER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "imu_mpu6050.h"
+
+// Classifier output, maps to SENSOR_TYPE_MOTION values[0] and values[1]
+struct motion_result {
+    bool moving;
+    bool standing;
+};
+
+/**
+ * @brief Convert the Kconfig thresholds to squared raw sensor units.
+ *
+ * @param accel_lsb_per_g Accelerometer sensitivity in LSB per g
+ * @param gyro_lsb_per_10dps Gyroscope sensitivity in LSB per 10 deg/s
+ */
+void motion_classifier_init(int32_t accel_lsb_per_g, int32_t gyro_lsb_per_10dps);
+
+/**
+ * @brief Append raw samples to the classification window.
+ *
+ * The window is a ring of the last CONFIG_MOTION_CLASSIFIER_WINDOW samples.
+ */
+void motion_classifier_push(const struct imu_sample *samples, size_t count);
+
+/**
+ * @brief Classify the current window.
+ *
+ * MOVING compares the accel variance and the gyro mean power against the
+ * squared thresholds, STANDING compares the mean Z acceleration. No square
+ * root is taken.
+ *
+ * @return 0 on success, -EAGAIN until the window holds at least two samples.
+ */
+int motion_classifier_evaluate(struct motion_result *result);
+
+#endif // MOTION_CLASSIFIER_H
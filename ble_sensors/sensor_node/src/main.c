@@ -0,0 +1,114 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2015-2016 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "sensor_common.h"
+#include "sensor_ble.h"
+#include "node_scheduler.h"
+#include "node_sources.h"
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+#include "sensor_ble_service.h"
+#endif // CONFIG_SENSOR_BLE_SERVICE
+
+LOG_MODULE_REGISTER(sensor_node, LOG_LEVEL_INF);
+
+// Sources selected by Kconfig, in scheduling order
+static const struct node_source *const sources[] = {
+#ifdef CONFIG_SENSOR_NODE_SOURCE_BMP180
+    &source_bmp180,
+#endif // CONFIG_SENSOR_NODE_SOURCE_BMP180
+#ifdef CONFIG_SENSOR_NODE_SOURCE_BH1750
+    &source_bh1750,
+#endif // CONFIG_SENSOR_NODE_SOURCE_BH1750
+#ifdef CONFIG_SENSOR_NODE_SOURCE_MPU6050
+    &source_mpu6050,
+#endif // CONFIG_SENSOR_NODE_SOURCE_MPU6050
+#ifdef CONFIG_SENSOR_NODE_SOURCE_GNSS
+    &source_gnss,
+#endif // CONFIG_SENSOR_NODE_SOURCE_GNSS
+};
+
+BUILD_ASSERT(ARRAY_SIZE(sources) > 0, "No sensor source enabled");
+
+static uint32_t report_interval_ms(void) {
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+    return sensor_config_sample_period_ms();
+#else
+    return CONFIG_SENSOR_NODE_INTERVAL_S * MSEC_PER_SEC;
+#endif // CONFIG_SENSOR_BLE_SERVICE
+}
+
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+// Configuration written over GATT, applied without waiting for the next wakeup
+static void config_changed(const struct sensor_config *config) {
+    node_scheduler_set_interval(config->sample_period_ms);
+    node_scheduler_set_deadband(config->deadband);
+}
+#endif // CONFIG_SENSOR_BLE_SERVICE
+
+// First reading of the next advertisement when a batch does not fit in one
+static size_t adv_start;
+
+static void publish(const sensor_data_t *samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        sensor_data_print(&samples[i]);
+        LOG_HEXDUMP_DBG(&samples[i], sizeof(sensor_data_t), "Sensor Data");
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+        send_sensor_data_notification(samples[i]);
+#endif // CONFIG_SENSOR_BLE_SERVICE
+    }
+
+    // Whole batch in one composite advertisement; the readings left out take
+    // the lead on the next wakeup so no source is starved
+    sensor_data_t ordered[CONFIG_NODE_SCHEDULER_MAX_SOURCES];
+    size_t start = adv_start % count;
+
+    for (size_t i = 0; i < count; i++) {
+        ordered[i] = samples[(start + i) % count];
+    }
+
+    int packed = sensor_data_adv_update_multi(ordered, count);
+    adv_start = (packed > 0 && (size_t)packed < count) ? start + packed : 0;
+}
+
+/* Main Function */
+int main(void) {
+    LOG_INF("Sensor Node BLE\n");
+
+    int err = init_ble();
+    if (err) {
+        LOG_ERR("Failed to Init BLE");
+        return -1;
+    }
+#ifdef CONFIG_BT_SMP
+    settings_load();
+    bt_ready(err);
+#endif // CONFIG_BT_SMP
+
+    node_scheduler_set_interval(report_interval_ms());
+#ifdef CONFIG_SENSOR_BLE_SERVICE
+    struct sensor_config config;
+
+    sensor_config_get(&config);
+    node_scheduler_set_deadband(config.deadband);
+    sensor_config_set_callback(config_changed);
+#endif // CONFIG_SENSOR_BLE_SERVICE
+
+    if (node_scheduler_init(sources, ARRAY_SIZE(sources)) < 0) {
+        LOG_ERR("No sensor source available");
+        return -1;
+    }
+
+    node_scheduler_run(publish);
+
+    return 0;
+}
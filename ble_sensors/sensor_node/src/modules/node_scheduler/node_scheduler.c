@@ -0,0 +1,164 @@
+#include "node_scheduler.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+#include <stdlib.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(node_scheduler, CONFIG_NODE_SCHEDULER_LOG_LEVEL);
+
+struct source_slot {
+    const struct node_source *source;
+    int64_t next_due;       // Uptime (ms) of the next sample
+    sensor_data_t last;     // Last published reading, for the deadband
+    uint8_t skipped;        // Readings dropped by the deadband since then
+};
+
+static struct source_slot slots[CONFIG_NODE_SCHEDULER_MAX_SOURCES];
+static size_t slot_count;
+static uint32_t report_interval_ms = 10 * MSEC_PER_SEC;
+static uint16_t deadband;
+static atomic_t interval_changed;
+
+// Given on an interval change. The scheduler waits on it instead of being
+// k_wakeup()'ed, which would also cut the sleeps inside the sensor drivers.
+static K_SEM_DEFINE(reschedule_sem, 0, 1);
+
+// Readings gathered in one wakeup
+static sensor_data_t batch[CONFIG_NODE_SCHEDULER_MAX_SOURCES];
+
+static uint32_t source_period(const struct node_source *source) {
+    return source->period_ms ? source->period_ms : report_interval_ms;
+}
+
+int node_scheduler_init(const struct node_source *const *sources, size_t count) {
+    int64_t now = k_uptime_get();
+
+    slot_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (slot_count == ARRAY_SIZE(slots)) {
+            LOG_ERR("Too many sources, %s skipped", sources[i]->name);
+            continue;
+        }
+
+        if (sources[i]->init && sources[i]->init() != 0) {
+            LOG_ERR("Source %s failed to initialize", sources[i]->name);
+            continue;
+        }
+
+        slots[slot_count].source = sources[i];
+        slots[slot_count].next_due = now;
+        slot_count++;
+
+        LOG_INF("Source %s every %u ms", sources[i]->name, source_period(sources[i]));
+    }
+
+    return slot_count ? (int)slot_count : -ENODEV;
+}
+
+void node_scheduler_set_interval(uint32_t interval_ms) {
+    interval_ms = MAX(interval_ms, 1);
+    if (interval_ms == report_interval_ms) {
+        return;
+    }
+    report_interval_ms = interval_ms;
+    atomic_set(&interval_changed, 1);
+    k_sem_give(&reschedule_sem);
+}
+
+void node_scheduler_set_deadband(uint16_t value) {
+    deadband = value;
+}
+
+// Same type and every value within the deadband of the last published reading
+static bool within_deadband(struct source_slot *slot, const sensor_data_t *data) {
+    int len;
+
+    if (deadband == 0 || slot->last.type != data->type ||
+        slot->skipped >= CONFIG_NODE_SCHEDULER_DEADBAND_MAX_SKIP) {
+        return false;
+    }
+
+    switch (data->type) {
+        case SENSOR_TYPE_TEMP:
+        case SENSOR_TYPE_PRESSURE:
+        case SENSOR_TYPE_LIGHT:
+        case SENSOR_TYPE_ENVIRONMENTAL:
+        case SENSOR_TYPE_ACCEL:
+        case SENSOR_TYPE_GYRO:
+            break;
+        default:
+            // States and split fixed-point values publish on their own rules
+            return false;
+    }
+
+    len = sensor_data_values_len(data->type) / sizeof(int16_t);
+    for (int i = 0; i < len; i++) {
+        if (abs(data->values[i] - slot->last.values[i]) >= deadband) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void node_scheduler_run(node_publish_t publish) {
+    while (1) {
+        int64_t wake = INT64_MAX;
+
+        // Sources on the report interval move to the new period right away
+        if (atomic_clear(&interval_changed)) {
+            int64_t now = k_uptime_get();
+
+            for (size_t i = 0; i < slot_count; i++) {
+                if (slots[i].source->period_ms == 0) {
+                    slots[i].next_due = MIN(slots[i].next_due, now + report_interval_ms);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < slot_count; i++) {
+            wake = MIN(wake, slots[i].next_due);
+        }
+
+        // One wakeup for every source due around the same time, or earlier
+        // to reschedule on an interval change
+        if (k_sem_take(&reschedule_sem, K_TIMEOUT_ABS_MS(wake)) == 0) {
+            continue;
+        }
+
+        int64_t now = k_uptime_get();
+        size_t count = 0;
+
+        for (size_t i = 0; i < slot_count; i++) {
+            struct source_slot *slot = &slots[i];
+
+            if (slot->next_due > now + CONFIG_NODE_SCHEDULER_MERGE_WINDOW_MS) {
+                continue;
+            }
+
+            memset(&batch[count], 0, sizeof(batch[count]));
+            int err = slot->source->sample(&batch[count]);
+            if (err == 0 && within_deadband(slot, &batch[count])) {
+                slot->skipped++;
+            } else if (err == 0) {
+                slot->last = batch[count];
+                slot->skipped = 0;
+                count++;
+            } else if (err != -EAGAIN && err != -EALREADY) {
+                LOG_WRN("Source %s failed (err %d)", slot->source->name, err);
+            }
+
+            // Keep the phase, but never try to catch up after a long block
+            slot->next_due += source_period(slot->source);
+            if (slot->next_due <= now) {
+                slot->next_due = now + source_period(slot->source);
+            }
+        }
+
+        if (count > 0) {
+            publish(batch, count);
+        }
+    }
+}
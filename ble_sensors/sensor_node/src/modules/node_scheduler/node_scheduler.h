@@ -0,0 +1,51 @@
+#ifndef NODE_SCHEDULER_H
+#define NODE_SCHEDULER_H
+
+#include <zephyr/kernel.h>
+#include "sensor_common.h"
+
+// One sensor behind the node scheduler
+struct node_source {
+    const char *name;
+    uint32_t period_ms;     // 0 follows the node report interval
+    int (*init)(void);
+    /**
+     * Fill @p data with a new reading. Return 0 to publish it, -EAGAIN or
+     * -EALREADY when there is nothing new, or another negative error code.
+     */
+    int (*sample)(sensor_data_t *data);
+};
+
+/**
+ * @brief Called once per wakeup with every reading that is ready.
+ */
+typedef void (*node_publish_t)(const sensor_data_t *samples, size_t count);
+
+/**
+ * @brief Initialize the sources. A source that fails to initialize is skipped.
+ *
+ * @return Number of active sources, or -ENODEV if none could be initialized.
+ */
+int node_scheduler_init(const struct node_source *const *sources, size_t count);
+
+/**
+ * @brief Set the report interval of the sources without their own period.
+ *
+ * Takes effect right away: a waiting scheduler reschedules at once, a
+ * sampling one once it is done. Safe from any thread.
+ */
+void node_scheduler_set_interval(uint32_t interval_ms);
+
+/**
+ * @brief Drop readings that moved less than @p deadband raw units on every value.
+ *
+ * Only applies to scalar sensor types; 0 publishes every reading.
+ */
+void node_scheduler_set_deadband(uint16_t deadband);
+
+/**
+ * @brief Sample the sources as they become due. Does not return.
+ */
+void node_scheduler_run(node_publish_t publish);
+
+#endif // NODE_SCHEDULER_H
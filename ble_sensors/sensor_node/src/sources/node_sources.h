@@ -0,0 +1,22 @@
+#ifndef NODE_SOURCES_H
+#define NODE_SOURCES_H
+
+#include "node_scheduler.h"
+
+#ifdef CONFIG_SENSOR_NODE_SOURCE_BMP180
+extern const struct node_source source_bmp180;
+#endif // CONFIG_SENSOR_NODE_SOURCE_BMP180
+
+#ifdef CONFIG_SENSOR_NODE_SOURCE_BH1750
+extern const struct node_source source_bh1750;
+#endif // CONFIG_SENSOR_NODE_SOURCE_BH1750
+
+#ifdef CONFIG_SENSOR_NODE_SOURCE_MPU6050
+extern const struct node_source source_mpu6050;
+#endif // CONFIG_SENSOR_NODE_SOURCE_MPU6050
+
+#ifdef CONFIG_SENSOR_NODE_SOURCE_GNSS
+extern const struct node_source source_gnss;
+#endif // CONFIG_SENSOR_NODE_SOURCE_GNSS
+
+#endif // NODE_SOURCES_H
@@ -0,0 +1,45 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/sensor.h>
+#include "node_sources.h"
+
+LOG_MODULE_DECLARE(sensor_node);
+
+static const struct device *const bh1750 = DEVICE_DT_GET_ONE(rohm_bh1750);
+
+static int bh1750_init(void) {
+    if (!device_is_ready(bh1750)) {
+        LOG_ERR("BH1750 not found or not ready");
+        return -ENODEV;
+    }
+    return 0;
+}
+
+static int bh1750_sample(sensor_data_t *data) {
+    struct sensor_value light;
+    uint32_t timestamp = k_uptime_get_32();
+
+    if (sensor_sample_fetch(bh1750) < 0) {
+        LOG_ERR("Failed to fetch BH1750 sample");
+        return -EIO;
+    }
+
+    if (sensor_channel_get(bh1750, SENSOR_CHAN_LIGHT, &light) < 0) {
+        LOG_ERR("Failed to read BH1750 channels");
+        return -EIO;
+    }
+
+    data->company_id = COMPANY_ID;
+    data->type = SENSOR_TYPE_LIGHT;
+    data->timestamp = timestamp;
+    data->values[0] = (int16_t)(sensor_value_to_double(&light) * LIGHT_SCALING_FACTOR);
+
+    return 0;
+}
+
+const struct node_source source_bh1750 = {
+    .name = "bh1750",
+    .period_ms = CONFIG_SENSOR_NODE_SOURCE_BH1750_PERIOD_S * MSEC_PER_SEC,
+    .init = bh1750_init,
+    .sample = bh1750_sample,
+};
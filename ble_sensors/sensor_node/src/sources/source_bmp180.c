@@ -0,0 +1,47 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/sensor.h>
+#include "node_sources.h"
+
+LOG_MODULE_DECLARE(sensor_node);
+
+static const struct device *const bmp180 = DEVICE_DT_GET_ONE(bosch_bmp180);
+
+static int bmp180_init(void) {
+    if (!device_is_ready(bmp180)) {
+        LOG_ERR("BMP180 not found or not ready");
+        return -ENODEV;
+    }
+    return 0;
+}
+
+static int bmp180_sample(sensor_data_t *data) {
+    struct sensor_value pressure, temp;
+    uint32_t timestamp = k_uptime_get_32();
+
+    if (sensor_sample_fetch(bmp180) < 0) {
+        LOG_ERR("Failed to fetch BMP180 sample");
+        return -EIO;
+    }
+
+    if (sensor_channel_get(bmp180, SENSOR_CHAN_PRESS, &pressure) < 0 ||
+        sensor_channel_get(bmp180, SENSOR_CHAN_DIE_TEMP, &temp) < 0) {
+        LOG_ERR("Failed to read BMP180 channels");
+        return -EIO;
+    }
+
+    data->company_id = COMPANY_ID;
+    data->type = SENSOR_TYPE_ENVIRONMENTAL;
+    data->timestamp = timestamp;
+    data->values[0] = (int16_t)(sensor_value_to_double(&temp) * TEMP_SCALING_FACTOR);
+    data->values[1] = (int16_t)(sensor_value_to_double(&pressure) * PRESSURE_SCALING_FACTOR);
+
+    return 0;
+}
+
+const struct node_source source_bmp180 = {
+    .name = "bmp180",
+    .period_ms = CONFIG_SENSOR_NODE_SOURCE_BMP180_PERIOD_S * MSEC_PER_SEC,
+    .init = bmp180_init,
+    .sample = bmp180_sample,
+};
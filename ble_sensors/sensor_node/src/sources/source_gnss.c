@@ -0,0 +1,18 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "parser_gnss.h"
+#include "node_sources.h"
+
+LOG_MODULE_DECLARE(sensor_node);
+
+// acquire_gnss_fix() blocks the scheduler for up to CONFIG_PARSER_GNSS_FIX_TIMEOUT_S
+static int gnss_sample(sensor_data_t *data) {
+    return acquire_gnss_fix(data);
+}
+
+const struct node_source source_gnss = {
+    .name = "gnss",
+    .period_ms = CONFIG_SENSOR_NODE_SOURCE_GNSS_PERIOD_S * MSEC_PER_SEC,
+    .init = parser_gnss_init,
+    .sample = gnss_sample,
+};
@@ -0,0 +1,102 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "imu_mpu6050.h"
+#include "motion_classifier.h"
+#ifdef CONFIG_ACTIVITY_ENGINE
+#include "activity_engine.h"
+#endif // CONFIG_ACTIVITY_ENGINE
+#include "node_sources.h"
+
+LOG_MODULE_DECLARE(sensor_node);
+
+// One drain per watermark, the pace imu_mpu6050_fifo_wait() would give
+#define DRAIN_PERIOD_MS (CONFIG_IMU_MPU6050_FIFO_WATERMARK * MSEC_PER_SEC / \
+                         CONFIG_IMU_MPU6050_FIFO_ODR_HZ)
+
+// Room for one late drain on top of the watermark
+static struct imu_sample fifo_samples[CONFIG_IMU_MPU6050_FIFO_WATERMARK * 2];
+static sensor_data_t last;
+
+static int mpu6050_init(void) {
+    const struct device *dev = DEVICE_DT_GET(DT_ALIAS(sensor_imu));
+
+    if (!device_is_ready(dev)) {
+        LOG_ERR("IMU sensor not found!");
+        return -ENODEV;
+    }
+
+    if (imu_mpu6050_init(dev) != 0) {
+        return -EIO;
+    }
+    motion_classifier_init(imu_mpu6050_accel_lsb_per_g(), imu_mpu6050_gyro_lsb_per_10dps());
+#ifdef CONFIG_ACTIVITY_ENGINE
+    activity_engine_init(imu_mpu6050_accel_lsb_per_g(), CONFIG_IMU_MPU6050_FIFO_ODR_HZ);
+#endif // CONFIG_ACTIVITY_ENGINE
+
+    memset(&last, 0, sizeof(last));
+
+    return imu_mpu6050_fifo_start();
+}
+
+// Same publish rules as sensor_mov_adv: state changes or the report interval
+static bool should_publish(const sensor_data_t *data) {
+#ifdef CONFIG_ACTIVITY_ENGINE
+    return data->values[0] != last.values[0] || data->values[3] != last.values[3] ||
+           (data->timestamp - last.timestamp >=
+            CONFIG_ACTIVITY_ENGINE_REPORT_INTERVAL_S * MSEC_PER_SEC);
+#else
+    return data->values[0] != last.values[0] || data->values[1] != last.values[1];
+#endif // CONFIG_ACTIVITY_ENGINE
+}
+
+static int mpu6050_sample(sensor_data_t *data) {
+    struct motion_result motion;
+    uint32_t timestamp = k_uptime_get_32();
+    int frames = imu_mpu6050_fifo_drain(fifo_samples, ARRAY_SIZE(fifo_samples));
+
+    if (frames <= 0) {
+        return (frames == 0) ? -EAGAIN : frames;
+    }
+
+    motion_classifier_push(fifo_samples, frames);
+    if (motion_classifier_evaluate(&motion) != 0) {
+        return -EAGAIN;
+    }
+
+    data->company_id = COMPANY_ID;
+    data->timestamp = timestamp;
+
+#ifdef CONFIG_ACTIVITY_ENGINE
+    struct activity_result activity;
+
+    activity_engine_push(fifo_samples, frames);
+    if (activity_engine_evaluate(&activity) != 0) {
+        return -EAGAIN;
+    }
+
+    data->type = SENSOR_TYPE_ACTIVITY;
+    data->values[0] = activity.state;
+    data->values[1] = (int16_t)activity.steps;
+    data->values[2] = activity.cadence_spm;
+    data->values[3] = motion.standing ? 1 : 0;
+#else
+    data->type = SENSOR_TYPE_MOTION;
+    data->values[0] = motion.moving ? 1 : 0;
+    data->values[1] = motion.standing ? 1 : 0;
+#endif // CONFIG_ACTIVITY_ENGINE
+
+    if (!should_publish(data)) {
+        return -EALREADY;
+    }
+
+    last = *data;
+    return 0;
+}
+
+const struct node_source source_mpu6050 = {
+    .name = "mpu6050",
+    .period_ms = DRAIN_PERIOD_MS,
+    .init = mpu6050_init,
+    .sample = mpu6050_sample,
+};
@@ -0,0 +1,103 @@
+import argparse
+import math
+import random
+import struct
+
+# Ponto de partida (Manaus) e parâmetros da trajetória sintética
+START_LAT = -3.1190
+START_LON = -60.0217
+ALT_MSL_M = 35.0
+STILL_EPOCHS = 60       # Trabalhador parado (apenas jitter do receptor)
+WALK_EPOCHS = 60        # Caminhando para leste
+WALK_SPEED_MS = 1.4
+JITTER_M = 3.0
+
+M_PER_DEG_LAT = 111320.0
+
+
+def nmea(body):
+    """Monta uma sentença NMEA com checksum e CRLF"""
+    checksum = 0
+    for ch in body:
+        checksum ^= ord(ch)
+    return f"${body}*{checksum:02X}\r\n"
+
+
+def nmea_coord(value, is_lat):
+    """Converte graus decimais para ddmm.mmmm / dddmm.mmmm"""
+    hemisphere = ("N" if value >= 0 else "S") if is_lat else ("E" if value >= 0 else "W")
+    value = abs(value)
+    degrees = int(value)
+    minutes = (value - degrees) * 60.0
+    width = 2 if is_lat else 3
+    return f"{degrees:0{width}d}{minutes:07.4f}", hemisphere
+
+
+def ubx(msg_class, msg_id, payload):
+    """Monta um frame UBX com checksum Fletcher de 8 bits"""
+    body = struct.pack("<BBH", msg_class, msg_id, len(payload)) + payload
+    ck_a = ck_b = 0
+    for b in body:
+        ck_a = (ck_a + b) & 0xFF
+        ck_b = (ck_b + ck_a) & 0xFF
+    return b"\xb5\x62" + body + bytes([ck_a, ck_b])
+
+
+def nav_pvt(epoch, lat, lon, speed_ms):
+    """Payload UBX-NAV-PVT (92 bytes) com fix 3D"""
+    itow = 43200000 + epoch * 1000
+    sec = epoch % 60
+    minute = epoch // 60
+    return struct.pack(
+        "<IHBBBBBBIiBBBBiiiiIIiiiiiIIHH4siHH",
+        itow, 2026, 10, 18, 12, minute, sec, 0x07,
+        50, 0,
+        3, 0x01, 0, 12,
+        int(round(lon * 1e7)), int(round(lat * 1e7)),
+        int((ALT_MSL_M - 12.0) * 1000), int(ALT_MSL_M * 1000),
+        2500, 4000,
+        0, int(speed_ms * 1000), 0, int(speed_ms * 1000),
+        9000000, 500, 1000000,
+        120, 0, b"\x00" * 4, 0, 0, 0)
+
+
+def track():
+    random.seed(1234)
+    east_m = 0.0
+    for epoch in range(STILL_EPOCHS + WALK_EPOCHS):
+        speed = 0.0 if epoch < STILL_EPOCHS else WALK_SPEED_MS
+        east_m += speed
+        jitter_n = random.uniform(-JITTER_M, JITTER_M)
+        jitter_e = random.uniform(-JITTER_M, JITTER_M)
+        lat = START_LAT + jitter_n / M_PER_DEG_LAT
+        lon = START_LON + (east_m + jitter_e) / (M_PER_DEG_LAT * math.cos(math.radians(START_LAT)))
+        yield epoch, lat, lon, speed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Gera logs NMEA/UBX sintéticos para o gnss_replay")
+    parser.add_argument("--nmea", default="nmea_walk.nmea", help="Arquivo NMEA de saída")
+    parser.add_argument("--ubx", default="ubx_walk.ubx", help="Arquivo UBX de saída")
+    args = parser.parse_args()
+
+    with open(args.nmea, "w", newline="") as nmea_file, open(args.ubx, "wb") as ubx_file:
+        for epoch, lat, lon, speed in track():
+            utc = f"12{epoch // 60:02d}{epoch % 60:02d}.00"
+            lat_str, lat_dir = nmea_coord(lat, True)
+            lon_str, lon_dir = nmea_coord(lon, False)
+            knots = speed / 0.514444
+
+            nmea_file.write(nmea(f"GNRMC,{utc},A,{lat_str},{lat_dir},{lon_str},{lon_dir},"
+                                 f"{knots:.3f},,181026,,,A"))
+            nmea_file.write(nmea(f"GNVTG,,T,,M,{knots:.3f},N,{speed * 3.6:.3f},K,A"))
+            nmea_file.write(nmea(f"GNGGA,{utc},{lat_str},{lat_dir},{lon_str},{lon_dir},"
+                                 f"1,12,0.8,{ALT_MSL_M:.1f},M,-12.0,M,,"))
+            nmea_file.write(nmea("GNGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.4,0.8,1.2,1"))
+
+            ubx_file.write(ubx(0x01, 0x07, nav_pvt(epoch, lat, lon, speed)))
+
+    print(f"✅ Logs gerados: {args.nmea}, {args.ubx}")
+
+
+if __name__ == "__main__":
+    main()
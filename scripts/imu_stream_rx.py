@@ -0,0 +1,152 @@
+import argparse
+import asyncio
+import csv
+import time
+from struct import unpack_from
+
+from bleak import BleakClient, BleakScanner
+
+# UUIDs
+IMU_STREAM_SERVICE_UUID = "7297d0d4-0b32-41f8-b04c-df38349df30b"
+IMU_STREAM_CHAR_UUID = "7344a36a-727a-4d88-8628-d8df9926900e"
+
+# Cabeçalho: seq (2) + count (1) + flags (1) + timestamp (4) = 8 bytes
+HEADER_FORMAT = "<HBBI"
+HEADER_SIZE = 8
+# Amostra: accel XYZ + gyro XYZ, int16 cada = 12 bytes
+SAMPLE_FORMAT = "<6h"
+SAMPLE_SIZE = 12
+FLAG_OVERFLOW = 0x01
+
+
+class StreamStats:
+    def __init__(self, writer=None):
+        self.writer = writer
+        self.start = None
+        self.expected_seq = None
+        self.packets = 0
+        self.lost = 0
+        self.overflows = 0
+        self.samples = 0
+        self.bytes = 0
+        self.window_start = None
+        self.window_bytes = 0
+        self.window_samples = 0
+
+    def handle(self, data: bytes):
+        now = time.monotonic()
+        if self.start is None:
+            self.start = self.window_start = now
+
+        if len(data) < HEADER_SIZE:
+            print(f"⚠️  Pacote curto: {len(data)} bytes")
+            return
+
+        seq, count, flags, timestamp = unpack_from(HEADER_FORMAT, data)
+        if len(data) != HEADER_SIZE + count * SAMPLE_SIZE:
+            print(f"⚠️  Tamanho inconsistente: {len(data)} bytes para {count} amostras")
+            return
+
+        # Sequência de 16 bits, com wrap-around
+        if self.expected_seq is not None and seq != self.expected_seq:
+            gap = (seq - self.expected_seq) & 0xFFFF
+            self.lost += gap
+            print(f"❌ {gap} pacote(s) perdido(s) antes do seq {seq}")
+        self.expected_seq = (seq + 1) & 0xFFFF
+
+        if flags & FLAG_OVERFLOW:
+            self.overflows += 1
+            print(f"⚠️  FIFO do sensor transbordou antes do seq {seq}")
+
+        self.packets += 1
+        self.samples += count
+        self.bytes += len(data)
+        self.window_bytes += len(data)
+        self.window_samples += count
+
+        if self.writer:
+            for i in range(count):
+                ax, ay, az, gx, gy, gz = unpack_from(SAMPLE_FORMAT, data, HEADER_SIZE + i * SAMPLE_SIZE)
+                self.writer.writerow([seq, timestamp, i, ax, ay, az, gx, gy, gz])
+
+        if now - self.window_start >= 1.0:
+            elapsed = now - self.window_start
+            print(f"📈 {self.window_bytes / elapsed / 1000:.1f} kB/s | "
+                  f"{self.window_samples / elapsed:.0f} amostras/s | "
+                  f"{count} amostras/pacote | perdidos {self.lost}")
+            self.window_start = now
+            self.window_bytes = 0
+            self.window_samples = 0
+
+    def summary(self):
+        if not self.start:
+            print("Nenhum pacote recebido.")
+            return
+        elapsed = time.monotonic() - self.start
+        total = self.packets + self.lost
+        print("\n📊 Resumo")
+        print(f"  ⏱️  Duração: {elapsed:.1f} s")
+        print(f"  📦 Pacotes: {self.packets} recebidos, {self.lost} perdidos "
+              f"({100.0 * self.lost / total if total else 0:.2f}%)")
+        print(f"  🧮 Amostras: {self.samples} ({self.samples / elapsed:.0f}/s)")
+        print(f"  🚀 Vazão sustentada: {self.bytes / elapsed / 1000:.2f} kB/s")
+        print(f"  ⚠️  Overflows de FIFO: {self.overflows}")
+
+
+async def main():
+    parser = argparse.ArgumentParser(description="Recebe o stream IMU bruto do sensor_mov_adv e mede a vazão")
+    parser.add_argument("-a", "--address", help="Endereço do sensor (padrão: procura pelo serviço IMU Stream)")
+    parser.add_argument("-t", "--time", type=float, default=0, help="Duração da captura em segundos (0 = até Ctrl+C)")
+    parser.add_argument("-o", "--output", help="Arquivo CSV para salvar as amostras")
+    args = parser.parse_args()
+
+    if args.address:
+        device = await BleakScanner.find_device_by_address(args.address)
+    else:
+        print("🔍 Procurando o sensor...")
+        device = await BleakScanner.find_device_by_filter(
+            lambda d, adv: IMU_STREAM_SERVICE_UUID.lower() in [s.lower() for s in adv.service_uuids]
+            or (d.name or "").startswith("Sensor Mov")
+        )
+
+    if not device:
+        print("❌ Sensor não encontrado.")
+        return
+
+    print(f"✅ Sensor: {device.name or '(sem nome)'} ({device.address})")
+
+    csv_file = open(args.output, "w", newline="") if args.output else None
+    writer = csv.writer(csv_file) if csv_file else None
+    if writer:
+        writer.writerow(["seq", "timestamp_ms", "index", "ax", "ay", "az", "gx", "gy", "gz"])
+
+    stats = StreamStats(writer)
+
+    try:
+        async with BleakClient(device) as client:
+            print(f"🔗 Conectado. MTU {client.mtu_size} bytes")
+
+            await client.start_notify(IMU_STREAM_CHAR_UUID, lambda _, data: stats.handle(data))
+            print("📡 Recebendo (Ctrl+C para sair)...")
+
+            try:
+                if args.time > 0:
+                    await asyncio.sleep(args.time)
+                else:
+                    while True:
+                        await asyncio.sleep(1)
+            except asyncio.CancelledError:
+                pass
+
+            await client.stop_notify(IMU_STREAM_CHAR_UUID)
+    finally:
+        stats.summary()
+        if csv_file:
+            csv_file.close()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -37,8 +37,8 @@ def format_advertisement_data(advertisement_data):
             # Parse sensor data structure
             if len(value) >= 8:  # Minimum size for type (2 bytes) + timestamp (4 bytes) + at least 1 value (2 bytes)
                 try:
-                    # Extract sensor type (2 bytes)
-                    sensor_type = int.from_bytes(value[0:2], byteorder='little')
+                    # Extract sensor type (1 byte; the next byte is padding, or the record count of a composite)
+                    sensor_type = value[0]
                     
                     # Extract timestamp (4 bytes)
                     timestamp = int.from_bytes(value[2:6], byteorder='little')
@@ -103,6 +103,25 @@ def format_advertisement_data(advertisement_data):
                                 altitude = ((values[5] << 16) | (values[6] & 0xFFFF)) / 1000.0  # Altitude in meters
                                 formatted_data.append(f"   🔹 GNSS: Fix Type: {fix_type} | Latitude: {latitude:.7f}° | Longitude: {longitude:.7f}° | Altitude: {altitude:.2f} m")
                         
+                        elif sensor_type == 9:  # SENSOR_TYPE_ACTIVITY
+                            if len(values) >= 4:
+                                states = {0: "STILL", 1: "WALKING", 2: "RUNNING", 3: "FALL"}
+                                steps = values[1] & 0xFFFF
+                                posture = "STANDING" if values[3] else "NON_STANDING"
+                                formatted_data.append(f"   🔹 Activity: {states.get(values[0], 'UNKNOWN')} | Steps: {steps} | Cadence: {values[2]} spm | Posture: {posture}")
+
+                        elif sensor_type == 10:  # SENSOR_TYPE_COMPOSITE
+                            # Records [type (1 byte)][len (1 byte)][values] after the header
+                            formatted_data.append(f"   🔹 Composite: {value[1]} registros")
+                            pos = 6
+                            while pos + 2 <= len(value):
+                                rec_type, rec_len = value[pos], value[pos + 1]
+                                rec = value[pos + 2:pos + 2 + rec_len]
+                                rec_values = [int.from_bytes(rec[i:i+2], byteorder='little', signed=True)
+                                              for i in range(0, len(rec) - 1, 2)]
+                                formatted_data.append(f"      ▪ Tipo {rec_type}: {rec_values}")
+                                pos += 2 + rec_len
+
                         else:
                             formatted_data.append("   🔹 Unknown Sensor Type")
                 
@@ -0,0 +1,44 @@
+import argparse
+import secrets
+from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
+
+
+def derive_node_key(master_key: bytes, key_id: int) -> bytes:
+    """ Chave do nó = AES-128(chave mestre, [key_id, 0 x 15]), igual ao sensor_auth.c """
+    block = bytes([key_id]) + bytes(15)
+    encryptor = Cipher(algorithms.AES(master_key), modes.ECB()).encryptor()
+    return encryptor.update(block) + encryptor.finalize()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="Gera a chave mestre e deriva as chaves dos nós para CONFIG_SENSOR_AUTH",
+        formatter_class=argparse.ArgumentDefaultsHelpFormatter
+    )
+    parser.add_argument("-m", type=str, metavar="master_key",
+                        help="Chave mestre em hexadecimal (32 dígitos). Se não informada, uma nova é gerada")
+    parser.add_argument("-i", type=int, nargs="+", metavar="key_id", default=[0],
+                        help="Key ID dos nós (0-255)")
+    args = parser.parse_args()
+
+    if args.m:
+        master = bytes.fromhex(args.m)
+        if len(master) != 16:
+            parser.error("A chave mestre deve ter 32 dígitos hexadecimais")
+    else:
+        master = secrets.token_bytes(16)
+        print("🔑 Nova chave mestre gerada")
+
+    print("\n# Concentrador (prj.conf)")
+    print("CONFIG_SENSOR_AUTH=y")
+    print("CONFIG_SENSOR_AUTH_VERIFY=y")
+    print(f'CONFIG_SENSOR_AUTH_MASTER_KEY="{master.hex()}"')
+
+    for key_id in args.i:
+        if not 0 <= key_id <= 255:
+            parser.error(f"Key ID inválido: {key_id}")
+        print(f"\n# Nó {key_id} (prj.conf)")
+        print("CONFIG_SENSOR_AUTH=y")
+        print("CONFIG_SENSOR_AUTH_SEAL=y")
+        print(f"CONFIG_SENSOR_AUTH_KEY_ID={key_id}")
+        print(f'CONFIG_SENSOR_AUTH_NODE_KEY="{derive_node_key(master, key_id).hex()}"')
@@ -6,9 +6,11 @@ from struct import unpack
 WORKER_SHADOW_SERVICE_UUID = "5facdc62-df9e-4403-a258-6f590aea3440"
 WORKER_SHADOW_CHAR_UUID = "485ec8f4-c56c-4534-9ba3-d850bf804877"
 
-# Struct format: 24 bytes com padding
-# 4 + 2 + 2 + 4 + 4 + 1 + 1 + 1 + 1(pad) + 2 + 2(pad) = 24
-STRUCT_FORMAT = "<IhHiiBBBxhxx"
+# Struct format: 24 bytes
+# 4 + 2 + 2 + 4 + 4 + 1 + 1 + 1 + 1 + 2 + 2 = 24
+STRUCT_FORMAT = "<IhHiiBBBBhH"
+
+ACTIVITY_STATES = {0: "STILL", 1: "WALKING", 2: "RUNNING", 3: "FALL"}
 
 def parse_shadow(data: bytes):
     print(f"\n📦 Raw data ({len(data)} bytes): {data.hex(' ')}")
@@ -26,8 +28,10 @@ def parse_shadow(data: bytes):
         fix_type,
         movement,
         posture,
-        light
-    ) = unpack("<IhHiiBBBxhxx", data)
+        activity,
+        light,
+        steps
+    ) = unpack(STRUCT_FORMAT, data)
 
     print(f"\n🛰️  Worker Shadow Update")
     print(f"  ⏱️  Timestamp: {timestamp} ms (0x{timestamp:08X})")
@@ -38,6 +42,7 @@ def parse_shadow(data: bytes):
     print(f"  📡 Fix Type: {fix_type} (0x{fix_type:02X})")
     print(f"  🚶 Movement: {'MOVING' if movement else 'STILL'} (0x{movement:02X})")
     print(f"  🧍 Posture: {'STANDING' if posture else 'NON-STANDING'} (0x{posture:02X})")
+    print(f"  🏃 Activity: {ACTIVITY_STATES.get(activity, 'UNKNOWN')} (0x{activity:02X}) | Steps: {steps}")
     print(f"  💡 Light: {light} lx (0x{light & 0xFFFF:04X})")
 
 async def main():
@@ -0,0 +1,283 @@
+import argparse
+import math
+import sys
+from struct import pack, unpack_from
+
+# Frame binário dos shadows publicado pelo gateway (CONFIG_SHADOW_FRAME),
+# mesmo layout de ble_sensors/gateway/src/modules/shadow_frame/shadow_frame.h
+FRAME_VERSION = 1
+FRAME_VERSION_BATCH = 2         # CONFIG_SHADOW_BATCH: todos os shadows, cada um com a idade
+HEADER_FORMAT = "<BBI"          # versão, número de registros, uptime do gateway (s)
+HEADER_LEN = 6
+ADDR_LEN = 7                    # tipo + 6 bytes, byte menos significativo primeiro
+SHADOW_FORMAT = "<IhHiiBBBBhH"  # concentrator_shadow_t, igual ao shadow_client.py
+SHADOW_LEN = 24
+RECORD_LEN = ADDR_LEN + SHADOW_LEN
+SAMPLE_LEN = RECORD_LEN + 4     # idade em ms antes do shadow
+AGE_UNKNOWN = 0xFFFFFFFF        # lote da flash de um boot anterior, sem hora da rede
+
+SHADOW_FIELDS = ("concentrator_timestamp", "temperature", "pressure", "latitude", "longitude",
+                 "fix_type", "movement", "posture", "activity", "light", "steps")
+
+
+def addr_to_str(addr_type: int, addr: bytes) -> str:
+    """ Mesmo formato do bt_addr_le_to_str() """
+    kind = {0: "public", 1: "random"}.get(addr_type, f"0x{addr_type:02x}")
+    return ":".join(f"{b:02X}" for b in reversed(addr)) + f" ({kind})"
+
+
+def decode_shadow(frame: bytes, offset: int) -> dict:
+    shadow = dict(zip(SHADOW_FIELDS, unpack_from(SHADOW_FORMAT, frame, offset)))
+
+    # Mesmas escalas do JSON publicado no shadow
+    shadow["temperature"] /= 100.0
+    shadow["pressure"] /= 10.0
+    shadow["latitude"] /= 1e7
+    shadow["longitude"] /= 1e7
+    return shadow
+
+
+def decode(frame: bytes) -> dict:
+    """ Snapshot: {"uptime", "concentrators": {addr: shadow}}
+        Lote: {"uptime", "samples": [{"addr", "age_ms", "time_ms", "shadow"}]}, do mais antigo ao mais novo,
+        age_ms e time_ms None se a idade foi perdida """
+    if len(frame) < HEADER_LEN:
+        raise ValueError(f"Frame curto demais: {len(frame)} bytes")
+
+    version, count, uptime = unpack_from(HEADER_FORMAT, frame)
+    if version not in (FRAME_VERSION, FRAME_VERSION_BATCH):
+        raise ValueError(f"Versão desconhecida: {version}")
+    record_len = RECORD_LEN if version == FRAME_VERSION else SAMPLE_LEN
+    if len(frame) != HEADER_LEN + count * record_len:
+        raise ValueError(f"Tamanho {len(frame)} não corresponde a {count} registros")
+
+    concentrators = {}
+    samples = []
+    for i in range(count):
+        offset = HEADER_LEN + i * record_len
+        addr = addr_to_str(frame[offset], frame[offset + 1:offset + ADDR_LEN])
+        offset += ADDR_LEN
+
+        if version == FRAME_VERSION:
+            concentrators[addr] = decode_shadow(frame, offset)
+        else:
+            (age_ms,) = unpack_from("<I", frame, offset)
+            if age_ms == AGE_UNKNOWN:
+                age_ms = None
+            samples.append({
+                "addr": addr,
+                "age_ms": age_ms,
+                # Uptime do gateway na recepção (o cabeçalho tem resolução de 1 s);
+                # negativo num lote da flash recebido antes do boot atual
+                "time_ms": None if age_ms is None else uptime * 1000 - age_ms,
+                "shadow": decode_shadow(frame, offset + 4),
+            })
+
+    if version == FRAME_VERSION:
+        return {"uptime": uptime, "concentrators": concentrators}
+    return {"uptime": uptime, "samples": samples}
+
+
+def encode(uptime: int, records: list) -> bytes:
+    """ Referência para os vetores de teste: records = [(addr_type, addr_lsb_first, campos)] """
+    frame = pack(HEADER_FORMAT, FRAME_VERSION, len(records), uptime)
+    for addr_type, addr, fields in records:
+        frame += bytes([addr_type]) + bytes(addr) + pack(SHADOW_FORMAT, *fields)
+    return frame
+
+
+def encode_batch(uptime: int, samples: list) -> bytes:
+    """ Referência para os vetores de teste: samples = [(addr_type, addr_lsb_first, age_ms, campos)] """
+    frame = pack(HEADER_FORMAT, FRAME_VERSION_BATCH, len(samples), uptime)
+    for addr_type, addr, age_ms, fields in samples:
+        frame += bytes([addr_type]) + bytes(addr) + pack("<I", age_ms) + pack(SHADOW_FORMAT, *fields)
+    return frame
+
+
+# Vetores de teste: frames como o gateway envia e o resultado esperado
+TEST_VECTORS = [
+    {
+        "name": "sem concentradores",
+        "hex": "010000000000",
+        "expected": {"uptime": 0, "concentrators": {}},
+    },
+    {
+        "name": "um concentrador, GNSS e atividade",
+        "hex": "01013c000000"
+               "01665544332211"
+               "3930000059085527fd1224fe1e6939dc03010102f4019a02",
+        "expected": {
+            "uptime": 60,
+            "concentrators": {
+                "11:22:33:44:55:66 (random)": {
+                    "concentrator_timestamp": 12345, "temperature": 21.37, "pressure": 1006.9,
+                    "latitude": -3.1190275, "longitude": -60.0217314, "fix_type": 3,
+                    "movement": 1, "posture": 1, "activity": 2, "light": 500, "steps": 666,
+                },
+            },
+        },
+    },
+    {
+        "name": "dois concentradores, valores negativos e extremos",
+        "hex": "0102ffffffff"
+               "00060504030201"
+               "ffffffff18fcffff00e1f505002eb69400000000ff7f0000"
+               "01ab00000000c0"
+               "000000000000000000000000000000000000000000000000",
+        "expected": {
+            "uptime": 0xFFFFFFFF,
+            "concentrators": {
+                "01:02:03:04:05:06 (public)": {
+                    "concentrator_timestamp": 0xFFFFFFFF, "temperature": -10.0, "pressure": 6553.5,
+                    "latitude": 10.0, "longitude": -180.0, "fix_type": 0,
+                    "movement": 0, "posture": 0, "activity": 0, "light": 32767, "steps": 0,
+                },
+                "C0:00:00:00:00:AB (random)": {
+                    "concentrator_timestamp": 0, "temperature": 0.0, "pressure": 0.0,
+                    "latitude": 0.0, "longitude": 0.0, "fix_type": 0,
+                    "movement": 0, "posture": 0, "activity": 0, "light": 0, "steps": 0,
+                },
+            },
+        },
+    },
+    {
+        "name": "lote com dois shadows do mesmo concentrador",
+        "hex": "020278000000"
+               "016655443322116ce80000"
+               "3930000059085527fd1224fe1e6939dc03010102f4019a02"
+               "016655443322113c730000"
+               "69a5000000fe5627f81224fe2c6939dc03010101e001bd02",
+        "expected": {
+            "uptime": 120,
+            "samples": [
+                {
+                    "addr": "11:22:33:44:55:66 (random)", "age_ms": 59500, "time_ms": 60500,
+                    "shadow": {
+                        "concentrator_timestamp": 12345, "temperature": 21.37, "pressure": 1006.9,
+                        "latitude": -3.1190275, "longitude": -60.0217314, "fix_type": 3,
+                        "movement": 1, "posture": 1, "activity": 2, "light": 500, "steps": 666,
+                    },
+                },
+                {
+                    "addr": "11:22:33:44:55:66 (random)", "age_ms": 29500, "time_ms": 90500,
+                    "shadow": {
+                        "concentrator_timestamp": 42345, "temperature": -5.12, "pressure": 1007.0,
+                        "latitude": -3.119028, "longitude": -60.02173, "fix_type": 3,
+                        "movement": 1, "posture": 1, "activity": 1, "light": 480, "steps": 701,
+                    },
+                },
+            ],
+        },
+    },
+    {
+        "name": "lote da flash, uma hora guardado, recebido antes do boot atual",
+        "hex": "02011e000000"
+               "01665544332211b0633700"
+               "070000006400102700000000000000000000000000000300",
+        "expected": {
+            "uptime": 30,
+            "samples": [
+                {
+                    "addr": "11:22:33:44:55:66 (random)", "age_ms": 3630000, "time_ms": -3600000,
+                    "shadow": {
+                        "concentrator_timestamp": 7, "temperature": 1.0, "pressure": 1000.0,
+                        "latitude": 0.0, "longitude": 0.0, "fix_type": 0,
+                        "movement": 0, "posture": 0, "activity": 0, "light": 0, "steps": 3,
+                    },
+                },
+            ],
+        },
+    },
+    {
+        "name": "lote da flash de um boot anterior, idade desconhecida",
+        "hex": "020105000000"
+               "00060504030201ffffffff"
+               "070000006400102700000000000000000000000000000300",
+        "expected": {
+            "uptime": 5,
+            "samples": [
+                {
+                    "addr": "01:02:03:04:05:06 (public)", "age_ms": None, "time_ms": None,
+                    "shadow": {
+                        "concentrator_timestamp": 7, "temperature": 1.0, "pressure": 1000.0,
+                        "latitude": 0.0, "longitude": 0.0, "fix_type": 0,
+                        "movement": 0, "posture": 0, "activity": 0, "light": 0, "steps": 3,
+                    },
+                },
+            ],
+        },
+    },
+]
+
+
+def matches(result, expected) -> bool:
+    """ Igualdade, com tolerância nos campos em ponto flutuante """
+    if isinstance(expected, float):
+        return isinstance(result, float) and math.isclose(result, expected, abs_tol=1e-9)
+    if isinstance(expected, dict):
+        return (isinstance(result, dict) and result.keys() == expected.keys() and
+                all(matches(result[k], expected[k]) for k in expected))
+    if isinstance(expected, list):
+        return (isinstance(result, list) and len(result) == len(expected) and
+                all(matches(r, e) for r, e in zip(result, expected)))
+    return result == expected
+
+
+def selftest() -> int:
+    failures = 0
+    for vector in TEST_VECTORS:
+        frame = bytes.fromhex(vector["hex"])
+        try:
+            result = decode(frame)
+        except ValueError as e:
+            result = str(e)
+        ok = matches(result, vector["expected"])
+        failures += not ok
+        print(f"{'✅' if ok else '❌'} {vector['name']} ({len(frame)} bytes)")
+        if not ok:
+            print(f"   esperado: {vector['expected']}\n   obtido:   {result}")
+
+    # Frames malformados devem ser rejeitados
+    for name, frame in (("versão errada", "030000000000"), ("truncado", "01013c000000ff"),
+                        ("lote truncado", "020178000000016655443322116ce800")):
+        try:
+            decode(bytes.fromhex(frame))
+            print(f"❌ {name} aceito")
+            failures += 1
+        except ValueError:
+            print(f"✅ {name} rejeitado")
+
+    return failures
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Decodifica o frame binário dos shadows do gateway")
+    parser.add_argument("frame", nargs="?", help="Frame em hexadecimal")
+    parser.add_argument("-f", type=str, metavar="file", help="Arquivo com o payload MQTT binário")
+    parser.add_argument("--selftest", action="store_true", help="Confere o decodificador com os vetores de teste")
+    args = parser.parse_args()
+
+    if args.selftest:
+        sys.exit(1 if selftest() else 0)
+
+    if args.f:
+        with open(args.f, "rb") as f:
+            data = f.read()
+    elif args.frame:
+        data = bytes.fromhex(args.frame)
+    else:
+        parser.error("Informe o frame em hexadecimal, -f ou --selftest")
+
+    decoded = decode(data)
+    print(f"⏱️  Uptime do gateway: {decoded['uptime']} s, {len(data)} bytes")
+    for addr, shadow in decoded.get("concentrators", {}).items():
+        print(f"\n🛰️  {addr}")
+        for field, value in shadow.items():
+            print(f"  {field}: {value}")
+    for sample in decoded.get("samples", []):
+        if sample["age_ms"] is None:
+            print(f"\n🛰️  {sample['addr']} em horário desconhecido")
+        else:
+            print(f"\n🛰️  {sample['addr']} há {sample['age_ms']} ms (uptime {sample['time_ms']} ms)")
+        for field, value in sample["shadow"].items():
+            print(f"  {field}: {value}")